@@ -0,0 +1,743 @@
+#include "EngineBenchmarks.h"
+#include "../../Source/PlayerAudio.h"
+#include "../../Source/DeckMixEngine.h"
+#include "../../Source/PolyphaseResamplingSource.h"
+#include "../../Source/WaveformPyramid.h"
+#include "../../Source/MixKernel.h"
+#include <iostream>
+
+namespace
+{
+    constexpr double syntheticSeconds = 60.0;
+    constexpr double settleSeconds = 0.25;          // rendered untimed before each case
+    constexpr int thdnSamples = 1 << 16;
+
+    const char* const stretchQualityNames[] = { "fast", "balanced", "high" };
+    const char* const resamplerQualityNames[] = { "low", "medium", "high" };
+
+    // ============ Sine Source ============
+    // Full-scale-ish sine at a fixed number of cycles per input sample, on every channel
+    class SineSource : public juce::AudioSource
+    {
+    public:
+        explicit SineSource(double cycles) : cyclesPerSample(cycles) {}
+
+        void prepareToPlay(int, double) override {}
+        void releaseResources() override {}
+
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+        {
+            for (int i = 0; i < bufferToFill.numSamples; ++i)
+            {
+                const float value = 0.5f * (float)std::sin(juce::MathConstants<double>::twoPi * phase);
+                phase = std::fmod(phase + cyclesPerSample, 1.0);
+
+                for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+                    bufferToFill.buffer->setSample(channel, bufferToFill.startSample + i, value);
+            }
+        }
+
+    private:
+        const double cyclesPerSample;
+        double phase = 0.0;
+    };
+
+    // Everything but a sine of known frequency, relative to that sine, in dB. The sine's
+    // amplitude and phase come from a least-squares fit, so no window or FFT is involved.
+    double measureThdPlusNoise(const float* samples, int numSamples, double cyclesPerSample)
+    {
+        const double omega = juce::MathConstants<double>::twoPi * cyclesPerSample;
+        double ss = 0.0, cc = 0.0, sc = 0.0, xs = 0.0, xc = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double s = std::sin(omega * i), c = std::cos(omega * i);
+            ss += s * s;
+            cc += c * c;
+            sc += s * c;
+            xs += samples[i] * s;
+            xc += samples[i] * c;
+        }
+
+        const double determinant = ss * cc - sc * sc;
+        if (determinant <= 0.0)
+            return 0.0;
+
+        const double a = (xs * cc - xc * sc) / determinant;
+        const double b = (xc * ss - xs * sc) / determinant;
+        double signal = 0.0, residual = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double fit = a * std::sin(omega * i) + b * std::cos(omega * i);
+            signal += fit * fit;
+            residual += (samples[i] - fit) * (samples[i] - fit);
+        }
+
+        return 10.0 * std::log10(juce::jmax(1.0e-30, residual) / juce::jmax(1.0e-30, signal));
+    }
+
+    juce::Array<int> getBlockSizes(bool quick)
+    {
+        if (quick)
+            return { 64, 512, 4096 };
+
+        return { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    }
+}
+
+// ============ EngineBenchmarks Implementation ============
+EngineBenchmarks::EngineBenchmarks(const BenchmarkOptions& o) : options(o)
+{
+    workDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+        .getChildFile("AudioEngineBenchmarks-" + juce::String::toHexString(juce::Random::getSystemRandom().nextInt()));
+    workDirectory.createDirectory();
+}
+
+EngineBenchmarks::~EngineBenchmarks()
+{
+    workDirectory.deleteRecursively();
+}
+
+void EngineBenchmarks::log(const juce::String& message)
+{
+    std::cerr << message << std::endl;
+}
+
+juce::var EngineBenchmarks::run()
+{
+    const auto synthetic = writeSyntheticFile("synthetic", syntheticSeconds, 44100.0);
+
+    if (synthetic.existsAsFile())
+        sourceFiles.add(synthetic);
+    else
+        log("Could not write the synthetic file to " + workDirectory.getFullPathName());
+
+    for (const auto& file : options.files)
+    {
+        if (file.existsAsFile())
+            sourceFiles.add(file);
+        else
+            log("Skipping missing file " + file.getFullPathName());
+    }
+
+    // Every file is decoded into the track cache and analysed first, as it would be on a
+    // loaded deck, so background jobs don't run while the cases are timed
+    for (const auto& file : sourceFiles)
+        if (!warmUp(file))
+            log("Warning: " + file.getFileName() + " still had background work running after warm-up");
+
+    for (const auto& file : sourceFiles)
+    {
+        if (options.suites.contains("deck"))
+            runDeckSuite(file);
+
+        if (options.suites.contains("mix"))
+            runMixSuite(file);
+    }
+
+    if (options.suites.contains("resampler"))
+        runResamplerSuite();
+
+    if (options.suites.contains("waveform"))
+        runWaveformSuite();
+
+    if (options.suites.contains("kernels"))
+        runKernelSuite();
+
+    auto* settings = new juce::DynamicObject();
+    settings->setProperty("secondsPerCase", options.secondsPerCase);
+    settings->setProperty("waveformMinutes", options.waveformMinutes);
+    settings->setProperty("quick", options.quick);
+    settings->setProperty("suites", options.suites.joinIntoString(","));
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("benchmark", "AudioEngineBenchmarks");
+    root->setProperty("formatVersion", 1);
+    root->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+    root->setProperty("machine", describeMachine());
+    root->setProperty("options", juce::var(settings));
+    root->setProperty("results", results);
+    return juce::var(root);
+}
+
+juce::var EngineBenchmarks::describeMachine()
+{
+    auto* machine = new juce::DynamicObject();
+    machine->setProperty("cpuModel", juce::SystemStats::getCpuModel());
+    machine->setProperty("cpuVendor", juce::SystemStats::getCpuVendor());
+    machine->setProperty("cpuSpeedMHz", juce::SystemStats::getCpuSpeedInMegahertz());
+    machine->setProperty("logicalCpus", juce::SystemStats::getNumCpus());
+    machine->setProperty("physicalCpus", juce::SystemStats::getNumPhysicalCpus());
+    machine->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    machine->setProperty("juce", juce::SystemStats::getJUCEVersion());
+    machine->setProperty("sse2", juce::SystemStats::hasSSE2());
+    machine->setProperty("avx", juce::SystemStats::hasAVX());
+    machine->setProperty("avx2", juce::SystemStats::hasAVX2());
+    machine->setProperty("neon", juce::SystemStats::hasNeon());
+   #if JUCE_DEBUG
+    machine->setProperty("build", "debug");
+   #else
+    machine->setProperty("build", "release");
+   #endif
+    return juce::var(machine);
+}
+
+template <typename RenderFunction>
+EngineBenchmarks::Timing EngineBenchmarks::timeBlocks(RenderFunction&& render, int blockSize, double sampleRate, double audioSeconds)
+{
+    const int numBlocks = juce::jmax(1, juce::roundToInt(audioSeconds * sampleRate / blockSize));
+    const double blockSeconds = blockSize / sampleRate;
+    juce::int64 totalTicks = 0;
+    Timing timing;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        render();
+        const auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+        totalTicks += ticks;
+        timing.worstBlockLoad = juce::jmax(timing.worstBlockLoad, juce::Time::highResolutionTicksToSeconds(ticks) / blockSeconds);
+    }
+
+    timing.seconds = juce::Time::highResolutionTicksToSeconds(totalTicks);
+    timing.numSamples = (juce::int64)numBlocks * blockSize;
+    return timing;
+}
+
+void EngineBenchmarks::addResult(juce::DynamicObject* result, const Timing& timing)
+{
+    const double sampleRate = result->getProperty("sampleRate");
+    const double nanoseconds = timing.seconds * 1.0e9;
+
+    result->setProperty("samples", timing.numSamples);
+    result->setProperty("seconds", timing.seconds);
+    result->setProperty("nsPerSample", timing.numSamples > 0 ? nanoseconds / (double)timing.numSamples : 0.0);
+
+    if (sampleRate > 0.0)
+    {
+        result->setProperty("realtimeFactor", timing.seconds > 0.0 ? (double)timing.numSamples / sampleRate / timing.seconds : 0.0);
+        result->setProperty("worstBlockLoad", timing.worstBlockLoad);
+    }
+
+    results.add(juce::var(result));
+}
+
+juce::File EngineBenchmarks::writeSyntheticFile(const juce::String& name, double seconds, double sampleRate)
+{
+    const auto file = workDirectory.getChildFile(name + ".wav");
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+
+    if (stream == nullptr || stream->failedToOpen())
+        return {};
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, 2, 16, {}, 0));
+
+    if (writer == nullptr)
+        return {};
+
+    stream.release();
+
+    // Something like music: a 120 BPM kick, a moving bass line, a chord and a little noise,
+    // so the beat grid, loudness and waveform analyses all have something to find
+    constexpr int chunkSize = 65536;
+    const double twoPi = juce::MathConstants<double>::twoPi;
+    const double beatSamples = sampleRate * 0.5;
+    const auto totalSamples = (juce::int64)(seconds * sampleRate);
+    const double bassSteps[] = { 0.0, 3.0, 5.0, 7.0 };
+    juce::AudioBuffer<float> buffer(2, chunkSize);
+    juce::Random random(0x5eed);
+
+    for (juce::int64 start = 0; start < totalSamples; start += chunkSize)
+    {
+        const int numSamples = (int)juce::jmin((juce::int64)chunkSize, totalSamples - start);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double t = (double)(start + i) / sampleRate;
+            const double sinceBeat = std::fmod((double)(start + i), beatSamples) / sampleRate;
+            const double kick = std::exp(-sinceBeat * 18.0)
+                * std::sin(twoPi * (50.0 + 80.0 * std::exp(-sinceBeat * 30.0)) * sinceBeat);
+            const double bassHz = 55.0 * std::pow(2.0, bassSteps[(int)(t / 2.0) % 4] / 12.0);
+            const double bass = 0.2 * std::sin(twoPi * bassHz * t);
+            const double chord = 0.06 * (std::sin(twoPi * 440.0 * t) + std::sin(twoPi * 554.37 * t)
+                + std::sin(twoPi * 659.26 * t + 0.5));
+
+            buffer.setSample(0, i, (float)(0.5 * kick + bass + chord) + 0.02f * (random.nextFloat() - 0.5f));
+            buffer.setSample(1, i, (float)(0.5 * kick + bass - chord) + 0.02f * (random.nextFloat() - 0.5f));
+        }
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+            return {};
+    }
+
+    return file;
+}
+
+bool EngineBenchmarks::warmUp(const juce::File& file)
+{
+    log("Warming up " + file.getFileName());
+
+    PlayerAudio deck;
+    deck.prepareToPlay(512, 48000.0);
+
+    if (!deck.loadFile(file))
+        return false;
+
+    const auto deadline = juce::Time::getMillisecondCounter() + 300000;
+    LoudnessInfo loudness;
+    BeatGrid grid;
+
+    while (juce::Time::getMillisecondCounter() < deadline)
+    {
+        if (deck.getTrackCache().find(file) != nullptr
+            && deck.getTrackAnalyzer().findLoudness(file, loudness)
+            && deck.getTrackAnalyzer().findBeatGrid(file, grid))
+            return true;
+
+        juce::Thread::sleep(50);
+    }
+
+    return false;
+}
+
+void EngineBenchmarks::runDeckSuite(const juce::File& file)
+{
+    log("Deck suite: " + file.getFileName());
+
+    const auto blockSizes = getBlockSizes(options.quick);
+    const juce::Array<double> sampleRates = options.quick ? juce::Array<double>{ 48000.0 }
+                                                          : juce::Array<double>{ 44100.0, 48000.0, 96000.0 };
+    const juce::Array<float> speeds = options.quick ? juce::Array<float>{ 0.92f, 1.5f }
+                                                    : juce::Array<float>{ 0.5f, 0.92f, 1.08f, 1.5f, 2.0f };
+
+    // Block size and device rate, at normal speed and key-locked off it
+    for (auto sampleRate : sampleRates)
+    {
+        for (auto blockSize : blockSizes)
+        {
+            DeckSetup setup;
+            setup.blockSize = blockSize;
+            setup.sampleRate = sampleRate;
+            runDeckCase(file, setup);
+
+            setup.speed = 1.08f;
+            setup.keyLock = true;
+            runDeckCase(file, setup);
+        }
+    }
+
+    // Speed through each resampler quality, then key-locked through each stretch quality, at every
+    // block size: the stretcher's hop and the resampler's history cost differ most at the small ones
+    for (auto blockSize : blockSizes)
+    {
+        for (auto speed : speeds)
+        {
+            for (int quality = 0; quality < 3; ++quality)
+            {
+                DeckSetup setup;
+                setup.blockSize = blockSize;
+                setup.speed = speed;
+                setup.resamplerQuality = quality;
+                runDeckCase(file, setup);
+
+                setup.resamplerQuality = 1;
+                setup.keyLock = true;
+                setup.stretchQuality = quality;
+                runDeckCase(file, setup);
+            }
+        }
+    }
+
+    // Loop modes: none, the whole track wrapping, a two-second A-B loop and a one-beat loop
+    for (const auto* loop : { "none", "track", "ab", "beat" })
+    {
+        for (auto speed : { 1.0f, 1.08f })
+        {
+            DeckSetup setup;
+            setup.speed = speed;
+            setup.loop = loop;
+            runDeckCase(file, setup);
+        }
+    }
+}
+
+void EngineBenchmarks::runDeckCase(const juce::File& file, const DeckSetup& setup)
+{
+    PlayerAudio deck;
+    deck.prepareToPlay(setup.blockSize, setup.sampleRate);
+
+    if (!deck.loadFile(file))
+    {
+        log("Could not load " + file.getFullPathName());
+        return;
+    }
+
+    deck.setResamplerQuality((ResamplerQuality)setup.resamplerQuality);
+    deck.setStretchQuality((StretchQuality)setup.stretchQuality);
+    deck.setKeyLock(setup.keyLock);
+    deck.setSpeed(setup.speed);
+
+    // Loops start a second before they wrap, so every case crosses the loop end
+    const double length = deck.getLength();
+    const double loopStart = juce::jmin(20.0, length * 0.25);
+    BeatGrid grid;
+
+    if (setup.loop == "track")
+    {
+        deck.setLooping(true);
+        deck.setPosition(juce::jmax(0.0, length - 1.0));
+    }
+    else if (setup.loop == "ab")
+    {
+        deck.setPosition(loopStart);
+        deck.setABLoop(loopStart, loopStart + 2.0);
+    }
+    else if (setup.loop == "beat")
+    {
+        const double beat = deck.getBeatGrid(grid) && grid.isValid() ? grid.getBeatLengthSeconds() : 0.5;
+        deck.setPosition(loopStart);
+        deck.setABLoop(loopStart, loopStart + beat);
+    }
+
+    deck.play();
+
+    juce::AudioBuffer<float> buffer(2, setup.blockSize);
+    auto render = [&]()
+        {
+            deck.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, setup.blockSize));
+        };
+
+    // Lets the queued commands land and primes the stretcher and resampler
+    timeBlocks(render, setup.blockSize, setup.sampleRate, settleSeconds);
+    deck.resetUnderrunCount();
+    const auto timing = timeBlocks(render, setup.blockSize, setup.sampleRate, options.secondsPerCase);
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("suite", "deck");
+    result->setProperty("file", file.getFileName());
+    result->setProperty("decks", 1);
+    result->setProperty("blockSize", setup.blockSize);
+    result->setProperty("sampleRate", setup.sampleRate);
+    result->setProperty("speed", setup.speed);
+    result->setProperty("keyLock", setup.keyLock);
+    result->setProperty("stretchQuality", stretchQualityNames[setup.stretchQuality]);
+    result->setProperty("resamplerQuality", resamplerQualityNames[setup.resamplerQuality]);
+    result->setProperty("loop", setup.loop);
+    result->setProperty("memoryResident", deck.isTrackMemoryResident());
+    result->setProperty("underruns", (int)deck.getUnderrunCount());
+    addResult(result, timing);
+}
+
+void EngineBenchmarks::runMixSuite(const juce::File& file)
+{
+    log("Mix suite: " + file.getFileName());
+
+    // Deck count against block size, with the engine's own choice of render threads
+    for (int numDecks : { 1, 2, 4, 8, 16 })
+        for (auto blockSize : getBlockSizes(options.quick))
+            runMixCase(file, numDecks, blockSize, -1);
+
+    // Eight decks on one to eight threads
+    const int maxWorkers = juce::jmin(7, juce::SystemStats::getNumCpus() - 1);
+
+    for (int numWorkers = 0; numWorkers <= maxWorkers; ++numWorkers)
+        runMixCase(file, 8, 512, numWorkers);
+}
+
+void EngineBenchmarks::runMixCase(const juce::File& file, int numDecks, int blockSize, int numWorkers)
+{
+    constexpr double sampleRate = 48000.0;
+
+    // Declared before the engine, which releases them when it goes
+    juce::OwnedArray<PlayerAudio> decks;
+    DeckMixEngine engine;
+    engine.setNumRenderWorkers(numWorkers);
+
+    for (int i = 0; i < numDecks; ++i)
+        engine.addDeck(*decks.add(new PlayerAudio()),
+            i % 2 == 0 ? DeckMixEngine::CrossfadeSide::a : DeckMixEngine::CrossfadeSide::b);
+
+    engine.prepareToPlay(blockSize, sampleRate, 2);
+
+    // Every deck a little off the others in speed and position, as in a real mix
+    for (int i = 0; i < numDecks; ++i)
+    {
+        auto* deck = decks.getUnchecked(i);
+
+        if (!deck->loadFile(file))
+        {
+            log("Could not load " + file.getFullPathName());
+            return;
+        }
+
+        deck->setSpeed(1.0f + 0.01f * (float)(i % 5 - 2));
+        deck->setPosition(std::fmod(i * 1.7, juce::jmax(1.0, deck->getLength() * 0.5)));
+        deck->play();
+    }
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    auto render = [&]()
+        {
+            engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, blockSize));
+        };
+
+    timeBlocks(render, blockSize, sampleRate, settleSeconds);
+    const auto timing = timeBlocks(render, blockSize, sampleRate, options.secondsPerCase);
+
+    auto* result = new juce::DynamicObject();
+    result->setProperty("suite", "mix");
+    result->setProperty("file", file.getFileName());
+    result->setProperty("decks", numDecks);
+    result->setProperty("threads", engine.getNumRenderThreads());
+    result->setProperty("blockSize", blockSize);
+    result->setProperty("sampleRate", sampleRate);
+    result->setProperty("nsPerDeckSample", timing.seconds * 1.0e9 / (double)juce::jmax((juce::int64)1, timing.numSamples * numDecks));
+    addResult(result, timing);
+}
+
+void EngineBenchmarks::runResamplerSuite()
+{
+    log("Resampler suite");
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    struct Conversion
+    {
+        const char* name;
+        double ratio;               // input samples per output sample
+        double inputHz;
+        double inputRate;
+    };
+
+    const Conversion conversions[] = {
+        { "44.1k to 48k", 44100.0 / 48000.0, 997.0, 44100.0 },
+        { "varispeed 0.92", 0.92, 997.0, 48000.0 },
+        { "varispeed 1.08", 1.08, 997.0, 48000.0 },
+        { "varispeed 1.08, 15 kHz", 1.08, 15000.0, 48000.0 },
+        { "varispeed 2.0", 2.0, 997.0, 48000.0 }
+    };
+
+    for (const auto& conversion : conversions)
+    {
+        for (int quality = 0; quality < 3; ++quality)
+        {
+            const double cyclesIn = conversion.inputHz / conversion.inputRate;
+            SineSource sine(cyclesIn);
+            PolyphaseResamplingSource resampler(&sine, false, 2);
+            resampler.setQuality((ResamplerQuality)quality);
+            resampler.setResamplingRatio(conversion.ratio);
+            resampler.prepareToPlay(blockSize, sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            auto render = [&]()
+                {
+                    resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, blockSize));
+                };
+
+            // Quality: past the start-up transient, one long capture of the output
+            timeBlocks(render, blockSize, sampleRate, settleSeconds);
+            juce::AudioBuffer<float> capture(2, thdnSamples);
+            for (int start = 0; start < thdnSamples; start += blockSize)
+                resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(&capture, start, blockSize));
+
+            const double thdn = measureThdPlusNoise(capture.getReadPointer(0), thdnSamples, cyclesIn * conversion.ratio);
+
+            const auto timing = timeBlocks(render, blockSize, sampleRate, options.secondsPerCase);
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty("suite", "resampler");
+            result->setProperty("conversion", conversion.name);
+            result->setProperty("ratio", conversion.ratio);
+            result->setProperty("resamplerQuality", resamplerQualityNames[quality]);
+            result->setProperty("blockSize", blockSize);
+            result->setProperty("sampleRate", sampleRate);
+            result->setProperty("channels", 2);
+            result->setProperty("thdPlusNoiseDb", juce::roundToInt(thdn * 10.0) / 10.0);
+            addResult(result, timing);
+        }
+    }
+}
+
+void EngineBenchmarks::runWaveformSuite()
+{
+    const double minutes = options.quick ? juce::jmin(2.0, options.waveformMinutes) : options.waveformMinutes;
+    log("Waveform suite: writing a " + juce::String(minutes, 1) + " minute file");
+
+    const auto file = writeSyntheticFile("waveform", minutes * 60.0, 44100.0);
+    if (!file.existsAsFile())
+        return;
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    // One untimed build, so every run reads from the OS file cache rather than the disk
+    WaveformBuilder::buildNow(formatManager, file, juce::SystemStats::getNumCpus());
+
+    juce::Array<int> threadCounts;
+    for (int threads = 1; threads < juce::SystemStats::getNumCpus(); threads *= 2)
+        threadCounts.add(threads);
+
+    threadCounts.add(juce::SystemStats::getNumCpus());
+    double singleThreadSeconds = 0.0;
+
+    for (auto threads : threadCounts)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        auto pyramid = WaveformBuilder::buildNow(formatManager, file, threads);
+        const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        if (pyramid == nullptr)
+        {
+            log("Waveform build failed");
+            break;
+        }
+
+        if (threads == 1)
+            singleThreadSeconds = seconds;
+
+        Timing timing;
+        timing.seconds = seconds;
+        timing.numSamples = pyramid->getLengthInSamples();
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("suite", "waveform");
+        result->setProperty("file", file.getFileName());
+        result->setProperty("minutes", minutes);
+        result->setProperty("threads", threads);
+        result->setProperty("sampleRate", pyramid->getSampleRate());
+        result->setProperty("speedup", seconds > 0.0 && singleThreadSeconds > 0.0 ? singleThreadSeconds / seconds : 1.0);
+        addResult(result, timing);
+    }
+
+    file.deleteFile();
+}
+
+void EngineBenchmarks::runKernelSuite()
+{
+    log("Kernel suite");
+
+    constexpr int blockSize = 512;
+    constexpr int numChannels = 2;
+    const double targetSeconds = juce::jmax(0.1, options.secondsPerCase * 0.2);
+    juce::Random random(1);
+
+    auto fill = [&random](juce::AudioBuffer<float>& buffer)
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    buffer.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+        };
+
+    // Repeats one call until targetSeconds have passed; samplesPerCall is what one call processes
+    auto measure = [targetSeconds](const char* kernel, int samplesPerCall, auto&& call)
+        {
+            Timing timing;
+            juce::int64 ticks = 0;
+            int calls = 0;
+
+            while (juce::Time::highResolutionTicksToSeconds(ticks) < targetSeconds)
+            {
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int i = 0; i < 256; ++i)
+                    call();
+
+                ticks += juce::Time::getHighResolutionTicks() - start;
+                calls += 256;
+            }
+
+            timing.seconds = juce::Time::highResolutionTicksToSeconds(ticks);
+            timing.numSamples = (juce::int64)calls * samplesPerCall;
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty("suite", "kernels");
+            result->setProperty("kernel", kernel);
+            result->setProperty("blockSize", blockSize);
+            return std::make_pair(result, timing);
+        };
+
+    for (int numSources : { 2, 8, 16 })
+    {
+        juce::OwnedArray<juce::AudioBuffer<float>> sources;
+        const juce::AudioBuffer<float>* sourcePointers[16];
+        float startGains[16], endGains[16];
+
+        for (int i = 0; i < numSources; ++i)
+        {
+            fill(*sources.add(new juce::AudioBuffer<float>(numChannels, blockSize)));
+            sourcePointers[i] = sources.getLast();
+            startGains[i] = 0.5f;
+            endGains[i] = 0.6f;
+        }
+
+        juce::AudioBuffer<float> dest(numChannels, blockSize);
+
+        // The mixer's loop before MixKernel: per channel, per sample, one fixed gain per source
+        auto [referenceResult, referenceTiming] = measure("mixScalarReference", blockSize * numChannels, [&]()
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    auto* outputData = dest.getWritePointer(channel);
+                    const float* inputData[16];
+
+                    for (int source = 0; source < numSources; ++source)
+                        inputData[source] = sourcePointers[source]->getReadPointer(channel);
+
+                    for (int sample = 0; sample < blockSize; ++sample)
+                    {
+                        float sum = 0.0f;
+
+                        for (int source = 0; source < numSources; ++source)
+                            sum += inputData[source][sample] * startGains[source];
+
+                        outputData[sample] = sum;
+                    }
+                }
+            });
+
+        referenceResult->setProperty("sources", numSources);
+        addResult(referenceResult, referenceTiming);
+
+        auto [result, timing] = measure("mixBuses", blockSize * numChannels, [&]()
+            {
+                MixKernel::mixBuses(dest, 0, sourcePointers, startGains, endGains, numSources, numChannels, blockSize);
+            });
+
+        // Time per sample of the reference over the kernel's; the kernel ramps its gains as well
+        const double referenceNs = referenceTiming.seconds / (double)juce::jmax((juce::int64)1, referenceTiming.numSamples);
+        const double kernelNs = timing.seconds / (double)juce::jmax((juce::int64)1, timing.numSamples);
+
+        result->setProperty("sources", numSources);
+        result->setProperty("speedup", kernelNs > 0.0 ? referenceNs / kernelNs : 1.0);
+        addResult(result, timing);
+    }
+
+    juce::AudioBuffer<float> signal(2, blockSize);
+    fill(signal);
+    float low = 0.0f, high = 0.0f, sumSquares = 0.0f, dot = 0.0f;
+
+    auto [peaksResult, peaksTiming] = measure("findPeaks", blockSize, [&]()
+        {
+            MixKernel::findPeaks(signal.getReadPointer(0), blockSize, low, high, sumSquares);
+        });
+    addResult(peaksResult, peaksTiming);
+
+    auto [dotResult, dotTiming] = measure("dotProduct", blockSize, [&]()
+        {
+            dot += MixKernel::dotProduct(signal.getReadPointer(0), signal.getReadPointer(1), blockSize);
+        });
+    addResult(dotResult, dotTiming);
+
+    auto [rampResult, rampTiming] = measure("addWithRamp", blockSize, [&]()
+        {
+            MixKernel::addWithRamp(signal.getWritePointer(1), signal.getReadPointer(0), 0.25f, 0.5f, blockSize);
+        });
+    addResult(rampResult, rampTiming);
+
+    // Keeps the results alive, so the calls can't be optimised away
+    if (low > high || std::isnan(dot))
+        log("Unexpected kernel results");
+}
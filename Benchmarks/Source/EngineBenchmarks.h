@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Benchmark Options ============
+struct BenchmarkOptions
+{
+    juce::Array<juce::File> files;          // real files rendered alongside the synthetic one
+    juce::StringArray suites{ "deck", "mix", "resampler", "waveform", "kernels" };
+    double secondsPerCase = 5.0;            // audio rendered and timed per case
+    double waveformMinutes = 10.0;          // length of the file the waveform build is timed on
+    bool quick = false;                     // fewer block sizes and rates, shorter cases
+};
+
+// ============ Engine Benchmarks ============
+// Renders the player and mixer code of the app with no window or audio device:
+// decks (PlayerAudio) across block sizes, device rates, speeds, key lock, resampler
+// quality and loop modes; the mix engine across deck counts and render threads;
+// resampler quality (THD+N) and throughput; the multi-threaded waveform build;
+// and the MixKernel inner loops, next to the scalar mix loop they replaced. Every
+// case becomes one JSON object with its parameters, ns per output sample and the
+// realtime factor.
+class EngineBenchmarks
+{
+public:
+    explicit EngineBenchmarks(const BenchmarkOptions& options);
+    ~EngineBenchmarks();
+
+    // Runs the selected suites on the calling thread, which must be the message thread;
+    // progress goes to stderr
+    juce::var run();
+
+private:
+    struct Timing
+    {
+        double seconds = 0.0;
+        double worstBlockLoad = 0.0;        // slowest block's time over the time it lasts
+        juce::int64 numSamples = 0;
+    };
+
+    struct DeckSetup
+    {
+        int blockSize = 512;
+        double sampleRate = 48000.0;
+        float speed = 1.0f;
+        bool keyLock = false;
+        int stretchQuality = 1;
+        int resamplerQuality = 1;
+        juce::String loop = "none";         // none, track, ab, beat
+    };
+
+    const BenchmarkOptions options;
+    juce::File workDirectory;
+    juce::Array<juce::File> sourceFiles;
+    juce::Array<juce::var> results;
+
+    void runDeckSuite(const juce::File& file);
+    void runMixSuite(const juce::File& file);
+    void runResamplerSuite();
+    void runWaveformSuite();
+    void runKernelSuite();
+
+    void runDeckCase(const juce::File& file, const DeckSetup& setup);
+    void runMixCase(const juce::File& file, int numDecks, int blockSize, int numWorkers);
+
+    juce::File writeSyntheticFile(const juce::String& name, double seconds, double sampleRate);
+    bool warmUp(const juce::File& file);
+    void addResult(juce::DynamicObject* result, const Timing& timing);
+
+    template <typename RenderFunction>
+    Timing timeBlocks(RenderFunction&& render, int blockSize, double sampleRate, double audioSeconds);
+
+    static juce::var describeMachine();
+    static void log(const juce::String& message);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EngineBenchmarks)
+};
@@ -0,0 +1,99 @@
+#include <JuceHeader.h>
+#include "EngineBenchmarks.h"
+#include <iostream>
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "AudioEngineBenchmarks [options]\n"
+                     "  --file <path>         also render this audio file (repeatable)\n"
+                     "  --suites <list>       comma-separated: deck,mix,resampler,waveform,kernels (default: all)\n"
+                     "  --seconds <n>         audio seconds timed per case (default 5)\n"
+                     "  --waveform-minutes <n> length of the waveform build file (default 10; 120 for a 2-hour run)\n"
+                     "  --quick               fewer block sizes, rates and speeds, 1 s cases\n"
+                     "  --output <path>       write the JSON here instead of to stdout\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // The analyzers post change messages, so there has to be a message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    BenchmarkOptions options;
+    juce::File output;
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const auto& arg = args[i];
+        const bool hasValue = i + 1 < args.size();
+
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+
+        if (arg == "--quick")
+        {
+            options.quick = true;
+            options.secondsPerCase = 1.0;
+        }
+        else if (arg == "--file" && hasValue)
+        {
+            options.files.add(juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]));
+        }
+        else if (arg == "--suites" && hasValue)
+        {
+            options.suites = juce::StringArray::fromTokens(args[++i], ",", {});
+            options.suites.trim();
+            options.suites.removeEmptyStrings();
+        }
+        else if (arg == "--seconds" && hasValue)
+        {
+            options.secondsPerCase = juce::jmax(0.1, args[++i].getDoubleValue());
+        }
+        else if (arg == "--waveform-minutes" && hasValue)
+        {
+            options.waveformMinutes = juce::jmax(0.1, args[++i].getDoubleValue());
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            output = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << "\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    juce::var report;
+
+    {
+        EngineBenchmarks benchmarks(options);
+        report = benchmarks.run();
+    }
+
+    const auto json = juce::JSON::toString(report);
+
+    if (output == juce::File())
+    {
+        std::cout << json << std::endl;
+        return 0;
+    }
+
+    if (!output.replaceWithText(json + "\n"))
+    {
+        std::cerr << "Could not write " << output.getFullPathName() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
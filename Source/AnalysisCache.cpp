@@ -0,0 +1,331 @@
+#include "AnalysisCache.h"
+#include "WaveformPyramid.h"
+#include "LoudnessAnalyzer.h"
+#include "BeatGridAnalyzer.h"
+#include "Mp3SeekIndex.h"
+#include <cstring>
+
+namespace
+{
+    constexpr int peaksMagic = 0x534b5057;       // "WPKS"
+    constexpr int analysisMagic = 0x5a4c4e41;    // "ANLZ"
+    constexpr int recordVersion = 1;
+
+    constexpr int loudnessTag = 0x44554f4c;      // "LOUD"
+    constexpr int beatGridTag = 0x54414542;      // "BEAT"
+
+    // magic, version, size, date, content hash, path length, reserved; then the path padded to 8 bytes
+    constexpr size_t fixedHeaderSize = 40;
+    constexpr size_t peaksInfoSize = 24;
+    constexpr juce::int64 hashBlockSize = 65536;
+
+    size_t padTo8(size_t size)
+    {
+        return (size + 7) & ~(size_t)7;
+    }
+
+    juce::int64 readInt64(const juce::uint8* data)
+    {
+        return (juce::int64)juce::ByteOrder::littleEndianInt64(data);
+    }
+
+    int readInt(const juce::uint8* data)
+    {
+        return (int)juce::ByteOrder::littleEndianInt(data);
+    }
+
+    // Calls visit(tag, data, size) for every complete chunk from offset on
+    template <typename Visitor>
+    void forEachChunk(const juce::uint8* data, size_t size, size_t offset, Visitor&& visit)
+    {
+        while (offset + 8 <= size)
+        {
+            const int tag = readInt(data + offset);
+            const auto chunkSize = (size_t)(juce::uint32)readInt(data + offset + 4);
+            offset += 8;
+
+            if (offset + chunkSize > size)
+                break;
+
+            visit(tag, data + offset, chunkSize);
+            offset += chunkSize;
+        }
+    }
+}
+
+// ============ AnalysisCache Implementation ============
+AnalysisCache::AnalysisCache()
+{
+}
+
+AnalysisCache::~AnalysisCache()
+{
+}
+
+juce::File AnalysisCache::getRecordFile(const juce::File& file, const char* extension)
+{
+    return Mp3SeekIndex::getAnalysisCacheDirectory().getChildFile(
+        juce::String::toHexString(file.getFullPathName().hashCode64()) + extension);
+}
+
+juce::int64 AnalysisCache::computeContentHash(const juce::File& file)
+{
+    juce::FileInputStream in(file);
+
+    if (in.failedToOpen())
+        return 0;
+
+    const auto size = in.getTotalLength();
+    juce::uint64 hash = 0xcbf29ce484222325ull;
+
+    auto mix = [&hash](const juce::uint8* bytes, size_t numBytes)
+        {
+            for (size_t i = 0; i < numBytes; ++i)
+                hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        };
+
+    juce::uint8 sizeBytes[8];
+    for (int i = 0; i < 8; ++i)
+        sizeBytes[i] = (juce::uint8)((juce::uint64)size >> (8 * i));
+
+    mix(sizeBytes, sizeof(sizeBytes));
+
+    juce::HeapBlock<juce::uint8> block((size_t)hashBlockSize);
+
+    for (auto start : { (juce::int64)0, size / 2 - hashBlockSize / 2, size - hashBlockSize })
+    {
+        start = juce::jlimit((juce::int64)0, juce::jmax((juce::int64)0, size - hashBlockSize), start);
+
+        if (!in.setPosition(start))
+            return 0;
+
+        const int numRead = in.read(block.get(), (int)juce::jmin(hashBlockSize, size));
+        mix(block.get(), (size_t)juce::jmax(0, numRead));
+    }
+
+    return (juce::int64)hash;
+}
+
+AnalysisCache::Identity AnalysisCache::getIdentity(const juce::File& file)
+{
+    Identity identity;
+    identity.fileSize = file.getSize();
+    identity.modificationTime = file.getLastModificationTime().toMilliseconds();
+    identity.contentHash = computeContentHash(file);
+    return identity;
+}
+
+bool AnalysisCache::matches(const juce::File& file, const juce::uint8* header, size_t size, int magic, size_t& dataOffset)
+{
+    if (header == nullptr || size < fixedHeaderSize || readInt(header) != magic || readInt(header + 4) != recordVersion)
+        return false;
+
+    // The name is a hash of the path, so check the path itself too
+    const auto pathBytes = (size_t)(juce::uint32)readInt(header + 32);
+    dataOffset = fixedHeaderSize + padTo8(pathBytes);
+
+    if (dataOffset > size
+        || juce::String::fromUTF8((const char*)header + fixedHeaderSize, (int)pathBytes) != file.getFullPathName())
+        return false;
+
+    if (readInt64(header + 8) != file.getSize())
+        return false;
+
+    // Same size but a new date: still ours if the content is the same
+    return readInt64(header + 16) == file.getLastModificationTime().toMilliseconds()
+        || readInt64(header + 24) == computeContentHash(file);
+}
+
+void AnalysisCache::writeHeader(juce::OutputStream& out, const juce::File& file, const Identity& identity, int magic)
+{
+    const auto path = file.getFullPathName().toRawUTF8();
+    const auto pathBytes = std::strlen(path);
+
+    out.writeInt(magic);
+    out.writeInt(recordVersion);
+    out.writeInt64(identity.fileSize);
+    out.writeInt64(identity.modificationTime);
+    out.writeInt64(identity.contentHash);
+    out.writeInt((int)pathBytes);
+    out.writeInt(0);
+    out.write(path, pathBytes);
+    out.writeRepeatedByte(0, padTo8(pathBytes) - pathBytes);
+}
+
+juce::ReferenceCountedObjectPtr<WaveformPyramid> AnalysisCache::loadWaveform(const juce::File& file)
+{
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(getRecordFile(file, ".peaks"), juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const juce::uint8*>(mapped->getData());
+    const auto size = mapped->getSize();
+    size_t offset = 0;
+
+    if (!matches(file, data, size, peaksMagic, offset) || offset + peaksInfoSize > size)
+        return nullptr;
+
+    const int numChannels = readInt(data + offset);
+    const auto rateBits = (juce::uint64)readInt64(data + offset + 8);
+    const auto lengthInSamples = readInt64(data + offset + 16);
+
+    double sampleRate = 0.0;
+    std::memcpy(&sampleRate, &rateBits, sizeof(sampleRate));
+
+    if (sampleRate <= 0.0)
+        return nullptr;
+
+    // The pyramid keeps the mapping; its bins are read straight out of it
+    return WaveformPyramid::createMapped(std::move(mapped), offset + peaksInfoSize, numChannels, sampleRate, lengthInSamples);
+}
+
+bool AnalysisCache::storeWaveform(const juce::File& file, const WaveformPyramid& pyramid)
+{
+    jassert(pyramid.isComplete());
+
+    const auto identity = getIdentity(file);
+    const auto target = getRecordFile(file, ".peaks");
+
+    const juce::ScopedLock sl(writeLock);
+
+    if (!target.getParentDirectory().createDirectory())
+        return false;
+
+    // Written aside and swapped in, like the seek indexes
+    juce::TemporaryFile temp(target);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen())
+            return false;
+
+        writeHeader(out, file, identity, peaksMagic);
+        out.writeInt(pyramid.getNumChannels());
+        out.writeInt(0);
+        out.writeDouble(pyramid.getSampleRate());
+        out.writeInt64(pyramid.getLengthInSamples());
+        out.write(pyramid.getRawData(), pyramid.getRawDataSize());
+        out.flush();
+
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool AnalysisCache::loadChunk(const juce::File& file, int tag, juce::MemoryBlock& result)
+{
+    juce::MemoryMappedFile mapped(getRecordFile(file, ".analysis"), juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const juce::uint8*>(mapped.getData());
+    size_t offset = 0;
+
+    if (!matches(file, data, mapped.getSize(), analysisMagic, offset))
+        return false;
+
+    bool found = false;
+    forEachChunk(data, mapped.getSize(), offset, [&](int chunkTag, const juce::uint8* chunk, size_t chunkSize)
+        {
+            if (chunkTag == tag)
+            {
+                result.replaceAll(chunk, chunkSize);
+                found = true;
+            }
+        });
+
+    return found;
+}
+
+bool AnalysisCache::storeChunk(const juce::File& file, int tag, const juce::MemoryBlock& chunk)
+{
+    const auto identity = getIdentity(file);
+    const auto target = getRecordFile(file, ".analysis");
+
+    const juce::ScopedLock sl(writeLock);
+
+    if (!target.getParentDirectory().createDirectory())
+        return false;
+
+    // Keep the other results already stored for this file, unless the file has changed since
+    juce::MemoryOutputStream otherChunks;
+
+    {
+        juce::MemoryMappedFile mapped(target, juce::MemoryMappedFile::readOnly);
+        auto* data = static_cast<const juce::uint8*>(mapped.getData());
+        size_t offset = 0;
+
+        if (matches(file, data, mapped.getSize(), analysisMagic, offset))
+        {
+            forEachChunk(data, mapped.getSize(), offset, [&](int chunkTag, const juce::uint8* existing, size_t chunkSize)
+                {
+                    if (chunkTag == tag)
+                        return;
+
+                    otherChunks.writeInt(chunkTag);
+                    otherChunks.writeInt((int)chunkSize);
+                    otherChunks.write(existing, chunkSize);
+                });
+        }
+    }
+
+    juce::TemporaryFile temp(target);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen())
+            return false;
+
+        writeHeader(out, file, identity, analysisMagic);
+        out.write(otherChunks.getData(), otherChunks.getDataSize());
+        out.writeInt(tag);
+        out.writeInt((int)chunk.getSize());
+        out.write(chunk.getData(), chunk.getSize());
+        out.flush();
+
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool AnalysisCache::loadLoudness(const juce::File& file, LoudnessInfo& result)
+{
+    juce::MemoryBlock chunk;
+
+    if (!loadChunk(file, loudnessTag, chunk) || chunk.getSize() < 3 * sizeof(double))
+        return false;
+
+    juce::MemoryInputStream in(chunk, false);
+    result.integratedLufs = in.readDouble();
+    result.loudnessRange = in.readDouble();
+    result.truePeakDb = in.readDouble();
+    return true;
+}
+
+bool AnalysisCache::storeLoudness(const juce::File& file, const LoudnessInfo& info)
+{
+    juce::MemoryOutputStream out;
+    out.writeDouble(info.integratedLufs);
+    out.writeDouble(info.loudnessRange);
+    out.writeDouble(info.truePeakDb);
+    return storeChunk(file, loudnessTag, out.getMemoryBlock());
+}
+
+bool AnalysisCache::loadBeatGrid(const juce::File& file, BeatGrid& result)
+{
+    juce::MemoryBlock chunk;
+
+    if (!loadChunk(file, beatGridTag, chunk) || chunk.getSize() < 2 * sizeof(double))
+        return false;
+
+    juce::MemoryInputStream in(chunk, false);
+    result.bpm = in.readDouble();
+    result.firstBeatSeconds = in.readDouble();
+    return true;
+}
+
+bool AnalysisCache::storeBeatGrid(const juce::File& file, const BeatGrid& grid)
+{
+    juce::MemoryOutputStream out;
+    out.writeDouble(grid.bpm);
+    out.writeDouble(grid.firstBeatSeconds);
+    return storeChunk(file, beatGridTag, out.getMemoryBlock());
+}
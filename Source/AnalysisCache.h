@@ -0,0 +1,56 @@
+#pragma once
+#include <JuceHeader.h>
+
+class WaveformPyramid;
+struct LoudnessInfo;
+struct BeatGrid;
+
+// ============ Analysis Cache ============
+// Waveform peaks and analysis results of every file seen, persisted in the
+// analysis cache directory next to the MP3 seek indexes. A record is named
+// after its file's path and holds the file's size, date and a hash of its
+// content: a record whose date doesn't match still counts if the size and
+// content hash do (a copied or touched file). Two files per audio file:
+//  - <hash>.peaks: a fixed header then every pyramid level as raw 8-bit
+//    bins, memory-mapped and read in place, so nothing is decoded or copied
+//  - <hash>.analysis: loudness and beat grid, as tagged chunks
+// Analyzers and the waveform builder share it through juce::SharedResourcePointer.
+class AnalysisCache
+{
+public:
+    AnalysisCache();
+    ~AnalysisCache();
+
+    // Any thread; the loads return false (or nullptr) when nothing valid is stored
+    juce::ReferenceCountedObjectPtr<WaveformPyramid> loadWaveform(const juce::File& file);
+    bool loadLoudness(const juce::File& file, LoudnessInfo& result);
+    bool loadBeatGrid(const juce::File& file, BeatGrid& result);
+
+    // Any thread, but they hash and write, so they belong on worker threads
+    bool storeWaveform(const juce::File& file, const WaveformPyramid& pyramid);
+    bool storeLoudness(const juce::File& file, const LoudnessInfo& info);
+    bool storeBeatGrid(const juce::File& file, const BeatGrid& grid);
+
+    // FNV-1a over the size and the first, middle and last 64 KB
+    static juce::int64 computeContentHash(const juce::File& file);
+
+private:
+    struct Identity
+    {
+        juce::int64 fileSize = 0;
+        juce::int64 modificationTime = 0;
+        juce::int64 contentHash = 0;
+    };
+
+    juce::CriticalSection writeLock;
+
+    static juce::File getRecordFile(const juce::File& file, const char* extension);
+    static Identity getIdentity(const juce::File& file);
+    static bool matches(const juce::File& file, const juce::uint8* header, size_t size, int magic, size_t& dataOffset);
+    static void writeHeader(juce::OutputStream& out, const juce::File& file, const Identity& identity, int magic);
+
+    bool loadChunk(const juce::File& file, int tag, juce::MemoryBlock& data);
+    bool storeChunk(const juce::File& file, int tag, const juce::MemoryBlock& data);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisCache)
+};
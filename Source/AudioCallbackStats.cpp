@@ -0,0 +1,230 @@
+#include "AudioCallbackStats.h"
+#include "Mp3SeekIndex.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <sys/resource.h>
+#endif
+
+namespace
+{
+    juce::var makeLoad(double load)
+    {
+        return juce::roundToInt(load * 10000.0) / 10000.0;
+    }
+
+    // User and kernel time every thread of the process has used so far
+    double getProcessCpuSeconds()
+    {
+       #if JUCE_WINDOWS
+        FILETIME creation, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+            return 0.0;
+
+        auto toSeconds = [](const FILETIME& time)
+            {
+                return (double)(((juce::uint64)time.dwHighDateTime << 32) | time.dwLowDateTime) * 1.0e-7;
+            };
+
+        return toSeconds(kernel) + toSeconds(user);
+       #else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0.0;
+
+        return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+            + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6;
+       #endif
+    }
+}
+
+// ============ AudioCallbackStats Implementation ============
+double AudioCallbackStats::Snapshot::getLoad(juce::int64 ticks, juce::uint64 samples, double sampleRate)
+{
+    if (samples == 0 || sampleRate <= 0.0)
+        return 0.0;
+
+    return juce::Time::highResolutionTicksToSeconds(ticks) / ((double)samples / sampleRate);
+}
+
+void AudioCallbackStats::prepare(double sampleRate, int blockSize, int numDecks)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = blockSize;
+    numPreparedDecks = juce::jlimit(0, maxDecks, numDecks);
+
+    // The device is about to restart, so the first callback's gap means nothing
+    lastCallbackStart = 0;
+    lastCallbackPeriod = 0;
+}
+
+void AudioCallbackStats::addCallback(juce::int64 startTicks, juce::int64 endTicks, int samples)
+{
+    if (samples <= 0)
+        return;
+
+    const double rate = currentSampleRate.load(std::memory_order_relaxed);
+    const auto ticks = endTicks - startTicks;
+    const auto period = (juce::int64)((double)samples / rate * (double)juce::Time::getHighResolutionTicksPerSecond());
+    const float load = (float)Snapshot::getLoad(ticks, (juce::uint64)samples, rate);
+
+    accumulate(numCallbacks, (juce::uint64)1);
+    accumulate(numSamples, (juce::uint64)samples);
+    accumulate(callbackTicks, ticks);
+
+    const int bucket = juce::jlimit(0, numLoadBuckets - 1, (int)(load / loadBucketWidth));
+    accumulate(loadHistogram[(size_t)bucket], (juce::uint32)1);
+
+    if (load > maxLoad.load(std::memory_order_relaxed))
+        maxLoad.store(load, std::memory_order_relaxed);
+
+    if (load > 1.0f)
+        accumulate(overruns, (juce::uint32)1);
+
+    // The device waited over two buffers for us: something was dropped, even if it doesn't say so
+    if (lastCallbackStart != 0 && startTicks - lastCallbackStart > 2 * lastCallbackPeriod)
+        accumulate(lateCallbacks, (juce::uint32)1);
+
+    lastCallbackStart = startTicks;
+    lastCallbackPeriod = period;
+}
+
+void AudioCallbackStats::addMixTicks(juce::int64 ticks)
+{
+    accumulate(mixTicks, ticks);
+}
+
+void AudioCallbackStats::addDeckTicks(int deckIndex, const DeckStageTicks& ticks)
+{
+    if (deckIndex < 0 || deckIndex >= maxDecks)
+        return;
+
+    auto* stages = deckTicks[deckIndex];
+    accumulate(stages[decode], ticks.decode);
+    accumulate(stages[loop], ticks.loop);
+    accumulate(stages[resample], ticks.resample);
+}
+
+void AudioCallbackStats::pollDevice(juce::AudioDeviceManager& deviceManager)
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        deviceXruns = device->getXRunCount();
+}
+
+AudioCallbackStats::Snapshot AudioCallbackStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.sampleRate = currentSampleRate.load(std::memory_order_relaxed);
+    snapshot.blockSize = currentBlockSize.load(std::memory_order_relaxed);
+    snapshot.numDecks = numPreparedDecks.load(std::memory_order_relaxed);
+
+    // Counters are read one by one, so a snapshot can straddle a callback; over an interval that washes out
+    snapshot.numCallbacks = numCallbacks.load(std::memory_order_relaxed);
+    snapshot.numSamples = numSamples.load(std::memory_order_relaxed);
+    snapshot.callbackTicks = callbackTicks.load(std::memory_order_relaxed);
+    snapshot.mixTicks = mixTicks.load(std::memory_order_relaxed);
+
+    for (int deck = 0; deck < maxDecks; ++deck)
+        for (int stage = 0; stage < numDeckStages; ++stage)
+            snapshot.deckTicks[deck][stage] = deckTicks[deck][stage].load(std::memory_order_relaxed);
+
+    snapshot.maxLoad = maxLoad.load(std::memory_order_relaxed);
+    snapshot.overruns = overruns.load(std::memory_order_relaxed);
+    snapshot.lateCallbacks = lateCallbacks.load(std::memory_order_relaxed);
+    snapshot.deviceXruns = deviceXruns.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < loadHistogram.size(); ++i)
+        snapshot.loadHistogram[i] = loadHistogram[i].load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+// ============ CallbackStatsLogger Implementation ============
+CallbackStatsLogger::CallbackStatsLogger(AudioCallbackStats& s, juce::AudioDeviceManager& manager,
+    const juce::File& file, int intervalSeconds)
+    : stats(s), deviceManager(manager), logFile(file)
+{
+    logFile.getParentDirectory().createDirectory();
+    previous = stats.getSnapshot();
+    previousCpuSeconds = getProcessCpuSeconds();
+    previousWallSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    startTimer(juce::jmax(1, intervalSeconds) * 1000);
+}
+
+CallbackStatsLogger::~CallbackStatsLogger()
+{
+    stopTimer();
+}
+
+juce::File CallbackStatsLogger::getLogFileFromEnvironment()
+{
+    const auto setting = juce::SystemStats::getEnvironmentVariable("AUDIOPLAYER_STATS_LOG", {}).trim();
+
+    if (setting.isEmpty())
+        return {};
+
+    if (setting == "1")
+        return Mp3SeekIndex::getAnalysisCacheDirectory().getSiblingFile("CallbackStats.jsonl");
+
+    return juce::File::getCurrentWorkingDirectory().getChildFile(setting);
+}
+
+void CallbackStatsLogger::timerCallback()
+{
+    stats.pollDevice(deviceManager);
+    const auto current = stats.getSnapshot();
+
+    const auto samples = current.numSamples - previous.numSamples;
+    const double rate = current.sampleRate;
+    auto load = [&](juce::int64 now, juce::int64 before)
+        {
+            return makeLoad(AudioCallbackStats::Snapshot::getLoad(now - before, samples, rate));
+        };
+
+    auto* line = new juce::DynamicObject();
+    line->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+    line->setProperty("sampleRate", rate);
+    line->setProperty("blockSize", current.blockSize);
+    line->setProperty("callbacks", (juce::int64)(current.numCallbacks - previous.numCallbacks));
+    line->setProperty("load", load(current.callbackTicks, previous.callbackTicks));
+    line->setProperty("maxLoad", makeLoad(current.maxLoad));
+    line->setProperty("mixLoad", load(current.mixTicks, previous.mixTicks));
+    line->setProperty("overruns", (int)(current.overruns - previous.overruns));
+    line->setProperty("lateCallbacks", (int)(current.lateCallbacks - previous.lateCallbacks));
+    line->setProperty("deviceXruns", current.deviceXruns);
+
+    // Whole-process CPU as a fraction of one core, so an idle app's cost shows up too
+    const double cpuSeconds = getProcessCpuSeconds();
+    const double wallSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    line->setProperty("processCpu", makeLoad(wallSeconds > previousWallSeconds
+        ? (cpuSeconds - previousCpuSeconds) / (wallSeconds - previousWallSeconds) : 0.0));
+    previousCpuSeconds = cpuSeconds;
+    previousWallSeconds = wallSeconds;
+
+    juce::Array<juce::var> histogram;
+    for (size_t i = 0; i < current.loadHistogram.size(); ++i)
+        histogram.add((int)(current.loadHistogram[i] - previous.loadHistogram[i]));
+
+    line->setProperty("loadHistogram", histogram);
+
+    juce::Array<juce::var> decks;
+    for (int deck = 0; deck < current.numDecks; ++deck)
+    {
+        auto* stages = new juce::DynamicObject();
+        stages->setProperty("decode", load(current.deckTicks[deck][AudioCallbackStats::decode],
+            previous.deckTicks[deck][AudioCallbackStats::decode]));
+        stages->setProperty("loop", load(current.deckTicks[deck][AudioCallbackStats::loop],
+            previous.deckTicks[deck][AudioCallbackStats::loop]));
+        stages->setProperty("resample", load(current.deckTicks[deck][AudioCallbackStats::resample],
+            previous.deckTicks[deck][AudioCallbackStats::resample]));
+        decks.add(juce::var(stages));
+    }
+
+    line->setProperty("decks", decks);
+    previous = current;
+
+    juce::FileOutputStream out(logFile);
+    if (!out.failedToOpen())
+        out << juce::JSON::toString(juce::var(line), true) << "\n";
+}
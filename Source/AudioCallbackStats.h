@@ -0,0 +1,131 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// ============ Deck Stage Ticks ============
+// High-resolution ticks one deck spent in each part of its chain while rendering
+struct DeckStageTicks
+{
+    juce::int64 decode = 0;         // read-ahead ring and preroll, or inline decoding
+    juce::int64 loop = 0;           // looping stage, its input excluded
+    juce::int64 resample = 0;       // transport, time-stretch and resampler, the looping stage excluded
+};
+
+// ============ Audio Callback Stats ============
+// Timing of every audio callback against its buffer period, broken down per
+// deck and stage. Each counter has a single writer (the audio thread, or the
+// thread rendering that deck), so writers never wait or use read-modify-write
+// instructions; readers take snapshots from any thread and diff two of them
+// for averages over an interval. Loads are fractions of the audio's duration:
+// 1.0 means a callback took as long as the buffer it filled lasts.
+class AudioCallbackStats
+{
+public:
+    enum Stage
+    {
+        decode = 0,
+        loop,
+        resample,
+        numDeckStages
+    };
+
+    static constexpr int maxDecks = 16;
+    static constexpr int numLoadBuckets = 41;       // 5% of the buffer period each; the last one is 200% and over
+    static constexpr float loadBucketWidth = 0.05f;
+
+    struct Snapshot
+    {
+        double sampleRate = 44100.0;
+        int blockSize = 0;
+        int numDecks = 0;
+
+        juce::uint64 numCallbacks = 0;
+        juce::uint64 numSamples = 0;
+        juce::int64 callbackTicks = 0;
+        juce::int64 mixTicks = 0;
+        juce::int64 deckTicks[maxDecks][numDeckStages] = {};
+
+        float maxLoad = 0.0f;                       // since the last resetMaxHold()
+        juce::uint32 overruns = 0;                  // callbacks that took longer than their buffer lasts
+        juce::uint32 lateCallbacks = 0;             // gaps of over two buffers between callbacks
+        int deviceXruns = -1;                       // as the device reports them; -1 if it can't
+        std::array<juce::uint32, numLoadBuckets> loadHistogram{};
+
+        // Average load of some ticks spent rendering the samples between two snapshots
+        static double getLoad(juce::int64 ticks, juce::uint64 samples, double sampleRate);
+    };
+
+    AudioCallbackStats() = default;
+
+    // Message thread, while audio is stopped
+    void prepare(double sampleRate, int blockSize, int numDecks);
+
+    // Audio thread
+    void addCallback(juce::int64 startTicks, juce::int64 endTicks, int numSamples);
+    void addMixTicks(juce::int64 ticks);
+
+    // The thread rendering the deck
+    void addDeckTicks(int deckIndex, const DeckStageTicks& ticks);
+
+    // Any thread but the audio thread
+    void pollDevice(juce::AudioDeviceManager& deviceManager);
+    void resetMaxHold() { maxLoad.store(0.0f, std::memory_order_relaxed); }
+    Snapshot getSnapshot() const;
+
+private:
+    std::atomic<double> currentSampleRate{ 44100.0 };
+    std::atomic<int> currentBlockSize{ 0 };
+    std::atomic<int> numPreparedDecks{ 0 };
+
+    std::atomic<juce::uint64> numCallbacks{ 0 };
+    std::atomic<juce::uint64> numSamples{ 0 };
+    std::atomic<juce::int64> callbackTicks{ 0 };
+    std::atomic<juce::int64> mixTicks{ 0 };
+    std::atomic<juce::int64> deckTicks[maxDecks][numDeckStages] = {};
+    std::atomic<float> maxLoad{ 0.0f };
+    std::atomic<juce::uint32> overruns{ 0 };
+    std::atomic<juce::uint32> lateCallbacks{ 0 };
+    std::atomic<int> deviceXruns{ -1 };
+    std::array<std::atomic<juce::uint32>, numLoadBuckets> loadHistogram{};
+
+    // Audio thread only
+    juce::int64 lastCallbackStart = 0;
+    juce::int64 lastCallbackPeriod = 0;
+
+    // Single writer, so a plain load and store is enough
+    template <typename Type>
+    static void accumulate(std::atomic<Type>& total, Type amount)
+    {
+        total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioCallbackStats)
+};
+
+// ============ Callback Stats Logger ============
+// Appends one JSON object per line to a file at a fixed interval: the loads,
+// counts and histogram of the interval just gone, for external monitoring.
+// Each line also carries the CPU the whole process used over the interval,
+// which is what an idle (stopped or minimised) app should keep near zero.
+class CallbackStatsLogger : private juce::Timer
+{
+public:
+    CallbackStatsLogger(AudioCallbackStats& stats, juce::AudioDeviceManager& deviceManager,
+        const juce::File& logFile, int intervalSeconds);
+    ~CallbackStatsLogger() override;
+
+    // The file named by AUDIOPLAYER_STATS_LOG, or a default file if it is set to "1"; none if it's unset
+    static juce::File getLogFileFromEnvironment();
+
+private:
+    AudioCallbackStats& stats;
+    juce::AudioDeviceManager& deviceManager;
+    const juce::File logFile;
+    AudioCallbackStats::Snapshot previous;
+    double previousCpuSeconds = 0.0;
+    double previousWallSeconds = 0.0;
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CallbackStatsLogger)
+};
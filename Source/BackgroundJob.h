@@ -0,0 +1,13 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Background Job Helpers ============
+// True once the thread pool job or thread running the caller has been asked to
+// stop, so long decode and analysis loops can bail out between chunks.
+inline bool shouldStopWork()
+{
+    if (auto* job = juce::ThreadPoolJob::getCurrentThreadPoolJob())
+        return job->shouldExit();
+
+    return juce::Thread::currentThreadShouldExit();
+}
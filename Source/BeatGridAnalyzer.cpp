@@ -0,0 +1,200 @@
+#include "BeatGridAnalyzer.h"
+#include "BackgroundJob.h"
+#include "MixKernel.h"
+#include <cmath>
+
+namespace
+{
+    constexpr double envelopeRate = 172.0;          // onset values per second, ~6 ms apart at 44.1 kHz
+    constexpr double kickBandHz = 150.0;
+    constexpr double tempoPriorBpm = 120.0;         // octave errors are settled towards this
+    constexpr double meanWindowSeconds = 0.5;       // local mean taken off the envelope
+    constexpr double minAnalysisSeconds = 8.0;
+
+    float interpolate(const std::vector<float>& values, double index)
+    {
+        const auto i = (size_t)index;
+        const float fraction = (float)(index - (double)i);
+        return values[i] + (values[i + 1] - values[i]) * fraction;
+    }
+}
+
+// ============ BeatDetector Implementation ============
+BeatDetector::BeatDetector(double rate)
+    : sampleRate(rate),
+    hopSize(juce::jmax(32, juce::roundToInt(rate / envelopeRate)))
+{
+    lowCoefficient = (float)std::exp(-juce::MathConstants<double>::twoPi * kickBandHz / sampleRate);
+    envelope.reserve(1 << 16);
+}
+
+void BeatDetector::process(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const int numChannels = buffer.getNumChannels();
+    const float channelScale = 1.0f / (float)juce::jmax(1, numChannels);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float mono = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+            mono += buffer.getReadPointer(channel)[i];
+
+        mono *= channelScale;
+        lowState = mono + (lowState - mono) * lowCoefficient;
+
+        lowEnergy += (double)(lowState * lowState);
+        fullEnergy += (double)(mono * mono);
+
+        if (++hopFill == hopSize)
+            finishHop();
+    }
+}
+
+void BeatDetector::finishHop()
+{
+    // Compressed energies, so quiet intros and loud drops produce comparable onsets
+    const double lowLog = std::log1p(1000.0 * lowEnergy / hopSize);
+    const double fullLog = std::log1p(1000.0 * fullEnergy / hopSize);
+
+    const double onset = juce::jmax(0.0, lowLog - lastLowLog) + 0.5 * juce::jmax(0.0, fullLog - lastFullLog);
+    envelope.push_back((float)onset);
+
+    lastLowLog = lowLog;
+    lastFullLog = fullLog;
+    lowEnergy = fullEnergy = 0.0;
+    hopFill = 0;
+}
+
+double BeatDetector::combScore(const std::vector<float>& onsets, double period, double phase) const
+{
+    const double last = (double)onsets.size() - 2.0;
+    double sum = 0.0;
+    int count = 0;
+
+    for (double position = phase; position < last; position += period, ++count)
+        sum += interpolate(onsets, position);
+
+    return count > 0 ? sum / count : 0.0;
+}
+
+BeatGrid BeatDetector::getResult() const
+{
+    const double rate = getEnvelopeRate();
+    const int size = (int)envelope.size();
+
+    if (size < (int)(minAnalysisSeconds * rate))
+        return {};
+
+    // Take the local mean off, so sustained noise doesn't read as a beat on every hop
+    const int halfWindow = juce::roundToInt(meanWindowSeconds * rate * 0.5);
+    std::vector<double> prefix((size_t)size + 1, 0.0);
+
+    for (int i = 0; i < size; ++i)
+        prefix[(size_t)i + 1] = prefix[(size_t)i] + envelope[(size_t)i];
+
+    std::vector<float> onsets((size_t)size, 0.0f);
+
+    for (int i = 0; i < size; ++i)
+    {
+        const int from = juce::jmax(0, i - halfWindow);
+        const int to = juce::jmin(size, i + halfWindow + 1);
+        const double mean = (prefix[(size_t)to] - prefix[(size_t)from]) / (to - from);
+        onsets[(size_t)i] = (float)juce::jmax(0.0, envelope[(size_t)i] - mean);
+    }
+
+    // Rough period: autocorrelation at each lag in the tempo range, helped by the lag twice as long
+    const int minLag = (int)std::floor(60.0 * rate / maxBpm);
+    const int maxLag = (int)std::ceil(60.0 * rate / minBpm);
+    std::vector<double> correlation((size_t)(2 * maxLag + 2), 0.0);
+
+    for (int lag = minLag; lag <= 2 * maxLag + 1 && lag < size; ++lag)
+        correlation[(size_t)lag] = MixKernel::dotProduct(onsets.data(), onsets.data() + lag, size - lag) / (double)(size - lag);
+
+    auto score = [&](int lag)
+        {
+            const double bpm = 60.0 * rate / lag;
+            const double octaves = std::log2(bpm / tempoPriorBpm);
+            return (correlation[(size_t)lag] + 0.5 * correlation[(size_t)(2 * lag)]) * std::exp(-0.5 * octaves * octaves);
+        };
+
+    int bestLag = minLag;
+    for (int lag = minLag + 1; lag <= maxLag; ++lag)
+        if (score(lag) > score(bestLag))
+            bestLag = lag;
+
+    double period = (double)bestLag;
+
+    if (bestLag > minLag && bestLag < maxLag)
+    {
+        const double left = score(bestLag - 1), centre = score(bestLag), right = score(bestLag + 1);
+        const double denominator = left - 2.0 * centre + right;
+
+        if (denominator < 0.0)
+            period += 0.5 * (left - right) / denominator;
+    }
+
+    if (correlation[(size_t)bestLag] <= 0.0)
+        return {};
+
+    // Coarse comb: periods within 2% and every half-hop phase
+    double bestPeriod = period, bestPhase = 0.0, bestScore = -1.0;
+
+    for (int step = -10; step <= 10; ++step)
+    {
+        const double candidate = period * (1.0 + step * 0.002);
+
+        for (double phase = 0.0; phase < candidate; phase += 0.5)
+        {
+            const double candidateScore = combScore(onsets, candidate, phase);
+
+            if (candidateScore > bestScore)
+            {
+                bestScore = candidateScore;
+                bestPeriod = candidate;
+                bestPhase = phase;
+            }
+        }
+
+        if (shouldStopWork())
+            return {};
+    }
+
+    // Fine: halve the steps around the best pair; over a whole track a tiny period
+    // error adds up to a visible phase drift, so this settles well below a hop
+    double periodStep = period * 0.001;
+    double phaseStep = 0.25;
+
+    for (int iteration = 0; iteration < 10; ++iteration)
+    {
+        const double centrePeriod = bestPeriod, centrePhase = bestPhase;
+
+        for (int dp = -1; dp <= 1; ++dp)
+        {
+            for (int dq = -1; dq <= 1; ++dq)
+            {
+                const double candidatePeriod = centrePeriod + dp * periodStep;
+                const double candidatePhase = centrePhase + dq * phaseStep;
+
+                if (candidatePhase < 0.0)
+                    continue;
+
+                const double candidateScore = combScore(onsets, candidatePeriod, candidatePhase);
+
+                if (candidateScore > bestScore)
+                {
+                    bestScore = candidateScore;
+                    bestPeriod = candidatePeriod;
+                    bestPhase = candidatePhase;
+                }
+            }
+        }
+
+        periodStep *= 0.5;
+        phaseStep *= 0.5;
+    }
+
+    BeatGrid grid;
+    grid.bpm = 60.0 * rate / bestPeriod;
+    grid.firstBeatSeconds = std::fmod(bestPhase, bestPeriod) * (double)hopSize / sampleRate;
+    return grid;
+}
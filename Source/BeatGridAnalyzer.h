@@ -0,0 +1,50 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// ============ Beat Grid ============
+// Constant-tempo grid of one file: a beat every 60 / bpm seconds from firstBeatSeconds
+struct BeatGrid
+{
+    double bpm = 0.0;
+    double firstBeatSeconds = 0.0;
+
+    bool isValid() const { return bpm > 0.0; }
+    double getBeatLengthSeconds() const { return isValid() ? 60.0 / bpm : 0.0; }
+};
+
+// ============ Beat Detector ============
+// Streaming onset envelope (log energy rises of a kick band and the full band,
+// one value per ~6 ms hop), then a tempo search: autocorrelation of the whole
+// envelope for the rough period, refined together with the phase by a comb
+// that sums the envelope on every candidate beat of the track.
+class BeatDetector
+{
+public:
+    explicit BeatDetector(double sampleRate);
+
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples);
+    BeatGrid getResult() const;
+
+    static constexpr double minBpm = 70.0;
+    static constexpr double maxBpm = 180.0;
+
+private:
+    const double sampleRate;
+    const int hopSize;
+
+    // Kick band low-pass state and the energies of the hop being filled
+    float lowCoefficient = 0.0f;
+    float lowState = 0.0f;
+    double lowEnergy = 0.0, fullEnergy = 0.0;
+    double lastLowLog = 0.0, lastFullLog = 0.0;
+    int hopFill = 0;
+
+    std::vector<float> envelope;
+
+    void finishHop();
+    double getEnvelopeRate() const { return sampleRate / (double)hopSize; }
+    double combScore(const std::vector<float>& onsets, double period, double phase) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BeatDetector)
+};
@@ -0,0 +1,131 @@
+#include "CallbackStatsOverlay.h"
+
+namespace
+{
+    juce::String formatLoad(double load)
+    {
+        return juce::String(load * 100.0, 1) + "%";
+    }
+}
+
+// ============ CallbackStatsOverlay Implementation ============
+CallbackStatsOverlay::CallbackStatsOverlay(AudioCallbackStats& s, juce::AudioDeviceManager& manager)
+    : stats(s), deviceManager(manager)
+{
+    previous = current = stats.getSnapshot();
+    setInterceptsMouseClicks(true, false);
+}
+
+CallbackStatsOverlay::~CallbackStatsOverlay()
+{
+    stopTimer();
+}
+
+void CallbackStatsOverlay::visibilityChanged()
+{
+    if (isVisible())
+    {
+        previous = current = stats.getSnapshot();
+        startTimer(500);
+    }
+    else
+    {
+        stopTimer();
+    }
+}
+
+void CallbackStatsOverlay::timerCallback()
+{
+    stats.pollDevice(deviceManager);
+    previous = current;
+    current = stats.getSnapshot();
+    repaint();
+}
+
+void CallbackStatsOverlay::mouseDown(const juce::MouseEvent&)
+{
+    stats.resetMaxHold();
+}
+
+void CallbackStatsOverlay::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+    g.setColour(juce::Colour(0xff0a0a0a).withAlpha(0.85f));
+    g.fillRoundedRectangle(bounds, 6.0f);
+    g.setColour(juce::Colour(0xff00d4ff).withAlpha(0.5f));
+    g.drawRoundedRectangle(bounds.reduced(0.5f), 6.0f, 1.0f);
+
+    const auto samples = current.numSamples - previous.numSamples;
+    const double rate = current.sampleRate;
+    auto loadOf = [&](juce::int64 now, juce::int64 before)
+        {
+            return AudioCallbackStats::Snapshot::getLoad(now - before, samples, rate);
+        };
+
+    auto area = getLocalBounds().reduced(8);
+    g.setFont(13.0f);
+
+    auto drawLine = [&](const juce::String& text, juce::Colour colour)
+        {
+            g.setColour(colour);
+            g.drawText(text, area.removeFromTop(16), juce::Justification::centredLeft);
+        };
+
+    const double periodMs = rate > 0.0 ? current.blockSize * 1000.0 / rate : 0.0;
+    drawLine("Audio callback: " + juce::String(current.blockSize) + " samples @ " + juce::String(rate, 0)
+        + " Hz (" + juce::String(periodMs, 2) + " ms)", juce::Colour(0xff00d4ff));
+
+    const double load = loadOf(current.callbackTicks, previous.callbackTicks);
+    drawLine("Load " + formatLoad(load) + "   max " + formatLoad(current.maxLoad)
+        + "   mix " + formatLoad(loadOf(current.mixTicks, previous.mixTicks)),
+        current.maxLoad >= 1.0f ? juce::Colours::red : (load > 0.7 ? juce::Colours::orange : juce::Colours::white));
+
+    drawLine("Overruns " + juce::String(current.overruns) + "   late callbacks " + juce::String(current.lateCallbacks)
+        + "   device xruns " + (current.deviceXruns >= 0 ? juce::String(current.deviceXruns) : juce::String("n/a")),
+        current.overruns > 0 || current.deviceXruns > 0 ? juce::Colours::orange : juce::Colours::white);
+
+    for (int deck = 0; deck < current.numDecks; ++deck)
+    {
+        juce::String text = "Deck " + juce::String(deck + 1)
+            + ": decode " + formatLoad(loadOf(current.deckTicks[deck][AudioCallbackStats::decode],
+                previous.deckTicks[deck][AudioCallbackStats::decode]))
+            + "   loop " + formatLoad(loadOf(current.deckTicks[deck][AudioCallbackStats::loop],
+                previous.deckTicks[deck][AudioCallbackStats::loop]))
+            + "   resample " + formatLoad(loadOf(current.deckTicks[deck][AudioCallbackStats::resample],
+                previous.deckTicks[deck][AudioCallbackStats::resample]));
+
+        if (describeDeck != nullptr)
+            text << "   " << describeDeck(deck);
+
+        drawLine(text, juce::Colours::lightgrey);
+    }
+
+    // Histogram of every callback so far, log-scaled so rare slow ones still show
+    area.removeFromTop(6);
+    const auto histogramArea = area.toFloat();
+    const float barWidth = histogramArea.getWidth() / (float)AudioCallbackStats::numLoadBuckets;
+    juce::uint32 largest = 1;
+
+    for (auto count : current.loadHistogram)
+        largest = juce::jmax(largest, count);
+
+    const float logLargest = std::log1p((float)largest);
+
+    for (int bucket = 0; bucket < AudioCallbackStats::numLoadBuckets; ++bucket)
+    {
+        const auto count = current.loadHistogram[(size_t)bucket];
+        if (count == 0)
+            continue;
+
+        const float height = histogramArea.getHeight() * std::log1p((float)count) / logLargest;
+        const bool over = (float)bucket * AudioCallbackStats::loadBucketWidth >= 1.0f;
+        g.setColour(over ? juce::Colours::red : juce::Colour(0xff00ff88));
+        g.fillRect(histogramArea.getX() + bucket * barWidth, histogramArea.getBottom() - height,
+            juce::jmax(1.0f, barWidth - 1.0f), height);
+    }
+
+    // Buffer period marker
+    g.setColour(juce::Colours::white.withAlpha(0.5f));
+    const float periodX = histogramArea.getX() + barWidth / AudioCallbackStats::loadBucketWidth;
+    g.drawVerticalLine(juce::roundToInt(periodX), histogramArea.getY(), histogramArea.getBottom());
+}
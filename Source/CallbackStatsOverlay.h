@@ -0,0 +1,34 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AudioCallbackStats.h"
+
+// ============ Callback Stats Overlay ============
+// Semi-transparent panel over the players showing the callback load against
+// the buffer period, its histogram, the overrun and xrun counts and each
+// deck's stage loads, averaged over the last half second. It polls the stats
+// only while it is showing. Click to clear the max-hold.
+class CallbackStatsOverlay : public juce::Component,
+    private juce::Timer
+{
+public:
+    CallbackStatsOverlay(AudioCallbackStats& stats, juce::AudioDeviceManager& deviceManager);
+    ~CallbackStatsOverlay() override;
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    void visibilityChanged() override;
+
+    // Extra text for a deck's row (underruns, waveform paint time...); optional
+    std::function<juce::String(int deckIndex)> describeDeck;
+
+    int getIdealHeight(int numDecks) const { return 120 + 16 * numDecks; }
+
+private:
+    AudioCallbackStats& stats;
+    juce::AudioDeviceManager& deviceManager;
+    AudioCallbackStats::Snapshot previous, current;
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CallbackStatsOverlay)
+};
@@ -0,0 +1,23 @@
+#include "DeckBusPool.h"
+
+void DeckBusPool::prepare(int numBuses, int numChannels, int maxBlockSize)
+{
+    numChannelsPerBus = juce::jmax(numChannelsPerBus, numChannels);
+    maxSamplesPerBlock = juce::jmax(maxSamplesPerBlock, maxBlockSize);
+
+    while (buses.size() < numBuses)
+        buses.add(new juce::AudioBuffer<float>());
+
+    for (auto* bus : buses)
+    {
+        bus->setSize(numChannelsPerBus, maxSamplesPerBlock, false, false, true);
+        bus->clear();
+    }
+}
+
+void DeckBusPool::release()
+{
+    buses.clear();
+    numChannelsPerBus = 0;
+    maxSamplesPerBlock = 0;
+}
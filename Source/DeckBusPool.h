@@ -0,0 +1,29 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Deck Bus Pool ============
+// Scratch buffers the mixer renders each deck into. They are sized from
+// prepareToPlay on the message thread and only ever reused by the callback.
+class DeckBusPool
+{
+public:
+    DeckBusPool() = default;
+
+    // Message thread only: grows the pool to fit, never shrinks it
+    void prepare(int numBuses, int numChannels, int maxBlockSize);
+    void release();
+
+    int getNumBuses() const { return buses.size(); }
+    int getNumChannels() const { return numChannelsPerBus; }
+    int getMaxBlockSize() const { return maxSamplesPerBlock; }
+
+    // Audio thread: never reallocates, callers must stay within getMaxBlockSize()
+    juce::AudioBuffer<float>& getBus(int index) { return *buses.getUnchecked(index); }
+
+private:
+    juce::OwnedArray<juce::AudioBuffer<float>> buses;
+    int numChannelsPerBus = 0;
+    int maxSamplesPerBlock = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckBusPool)
+};
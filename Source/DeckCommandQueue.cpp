@@ -0,0 +1,18 @@
+#include "DeckCommandQueue.h"
+
+DeckCommandQueue::DeckCommandQueue(int capacity)
+    : fifo(capacity),
+      commands((size_t)capacity)
+{
+}
+
+bool DeckCommandQueue::push(const DeckCommand& command)
+{
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 == 0)
+        return false;
+
+    commands[(size_t)scope.startIndex1] = command;
+    return true;
+}
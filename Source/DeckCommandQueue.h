@@ -0,0 +1,50 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// ============ Deck Command ============
+// One transport or loop change, posted by the GUI and applied by the audio thread
+struct DeckCommand
+{
+    enum class Type
+    {
+        play,
+        stop,
+        setGain,
+        seek,
+        setLoopRegion,
+        setBeatGrid
+    };
+
+    Type type = Type::stop;
+    float gain = 0.0f;
+    juce::int64 start = 0;  // seek target, loop start, or first beat
+    juce::int64 end = 0;    // loop end; not after start clears the loop
+    double length = 0.0;    // beat length in samples; 0 clears the grid
+};
+
+// ============ Deck Command Queue ============
+// Wait-free single-producer/single-consumer queue built on juce::AbstractFifo.
+// The message thread pushes, the audio thread drains at the start of a block.
+class DeckCommandQueue
+{
+public:
+    explicit DeckCommandQueue(int capacity = 256);
+
+    // Message thread only; returns false if the audio thread has fallen behind and the queue is full
+    bool push(const DeckCommand& command);
+
+    // Audio thread only: calls handler(const DeckCommand&) for every pending command, oldest first
+    template <typename Handler>
+    void drain(Handler&& handler)
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([&](int index) { handler(commands[(size_t)index]); });
+    }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<DeckCommand> commands;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckCommandQueue)
+};
@@ -0,0 +1,236 @@
+#include "DeckMixEngine.h"
+#include "RealtimeAllocationCheck.h"
+#include "SignalAnalyser.h"
+
+DeckMixEngine::DeckMixEngine()
+{
+}
+
+DeckMixEngine::~DeckMixEngine()
+{
+    releaseResources();
+}
+
+void DeckMixEngine::addDeck(PlayerAudio& deck, CrossfadeSide side)
+{
+    jassert(channels.size() < maxDecks);
+
+    if (channels.size() >= maxDecks)
+        return;
+
+    auto* channel = channels.add(new DeckChannel());
+    channel->deck = &deck;
+    channel->side = (int)side;
+}
+
+void DeckMixEngine::setDeckAnalyser(int deckIndex, SignalAnalyser* analyser)
+{
+    if (auto* channel = channels[deckIndex])
+        channel->analyser = analyser;
+}
+
+void DeckMixEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numOutputChannels)
+{
+    currentSampleRate = sampleRate;
+
+    for (auto* channel : channels)
+        channel->deck->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    deckBuses.prepare(channels.size(), juce::jmax(1, numOutputChannels), samplesPerBlockExpected);
+
+    // Workers are started here rather than per callback; a single deck renders inline
+    const int numWorkers = requestedWorkers >= 0 ? juce::jmin(requestedWorkers, juce::jmax(0, channels.size() - 1))
+                                                 : DeckRenderPool::getDefaultNumWorkers(channels.size());
+    if (renderPool == nullptr || renderPool->getNumWorkers() != numWorkers)
+        renderPool = std::make_unique<DeckRenderPool>(numWorkers);
+
+    // Fade gain changes over 20ms so fader moves don't zipper
+    for (auto* channel : channels)
+    {
+        channel->gain.reset(sampleRate, 0.02);
+        channel->gain.setCurrentAndTargetValue(getTargetGain(*channel));
+    }
+}
+
+void DeckMixEngine::releaseResources()
+{
+    renderPool.reset();
+
+    for (auto* channel : channels)
+        channel->deck->releaseResources();
+
+    deckBuses.release();
+}
+
+void DeckMixEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int numDecks = channels.size();
+
+    if (numDecks == 0 || deckBuses.getNumBuses() < numDecks)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    // Gains come from the GUI through atomics and are ramped per sample
+    for (auto* channel : channels)
+        channel->gain.setTargetValue(getTargetGain(*channel));
+
+    const int numChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), deckBuses.getNumChannels());
+    const int maxBlockSize = deckBuses.getMaxBlockSize();
+
+    // Fixed-size scratch on the stack; addDeck() caps the deck count at maxDecks
+    const juce::AudioBuffer<float>* buses[maxDecks];
+    float startGains[maxDecks];
+    float endGains[maxDecks];
+
+    for (int i = 0; i < numDecks; ++i)
+        buses[i] = &deckBuses.getBus(i);
+
+    const double callbackTime = juce::Time::getMillisecondCounterHiRes();
+
+    // Devices may hand us more than they promised; render in pool-sized pieces rather than grow here
+    for (int offset = 0; offset < bufferToFill.numSamples && maxBlockSize > 0; offset += maxBlockSize)
+    {
+        samplesToRender = juce::jmin(maxBlockSize, bufferToFill.numSamples - offset);
+        renderTimestamp = callbackTime + offset * 1000.0 / currentSampleRate;
+        syncTempos();
+
+        if (renderPool != nullptr)
+            renderPool->run(numDecks, &DeckMixEngine::renderDeck, this);
+        else
+            for (int i = 0; i < numDecks; ++i)
+                renderDeck(this, i);
+
+        for (int i = 0; i < numDecks; ++i)
+        {
+            startGains[i] = channels.getUnchecked(i)->gain.getCurrentValue();
+            endGains[i] = channels.getUnchecked(i)->gain.skip(samplesToRender);
+        }
+
+        const auto mixStart = juce::Time::getHighResolutionTicks();
+        MixKernel::mixBuses(*bufferToFill.buffer, bufferToFill.startSample + offset,
+            buses, startGains, endGains, numDecks, numChannels, samplesToRender);
+
+        if (callbackStats != nullptr)
+            callbackStats->addMixTicks(juce::Time::getHighResolutionTicks() - mixStart);
+
+        if (masterAnalyser != nullptr && !nonRealtime)
+            masterAnalyser->pushSamples(*bufferToFill.buffer, bufferToFill.startSample + offset, samplesToRender);
+    }
+
+    // Output channels the buses don't cover stay silent
+    for (int channel = numChannels; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        bufferToFill.buffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void DeckMixEngine::renderDeck(void* engine, int deckIndex)
+{
+    auto& self = *static_cast<DeckMixEngine*>(engine);
+    juce::AudioSourceChannelInfo info(&self.deckBuses.getBus(deckIndex), 0, self.samplesToRender);
+    auto* channel = self.channels.getUnchecked(deckIndex);
+    auto* deck = channel->deck;
+    deck->setRenderTimestamp(self.renderTimestamp);
+
+    if (self.nonRealtime)
+    {
+        deck->getNextAudioBlock(info);
+        return;
+    }
+
+    // Runs on the audio thread or a render worker, so both are held to the same rules
+    const ScopedRealtimeAllocationCheck allocationCheck;
+    deck->getNextAudioBlock(info);
+
+    // Each deck is rendered by one thread at a time, so its analyser and stats slot have a single writer
+    if (channel->analyser != nullptr)
+        channel->analyser->pushSamples(*info.buffer, 0, self.samplesToRender);
+
+    if (self.callbackStats != nullptr)
+        self.callbackStats->addDeckTicks(deckIndex, deck->takeStageTicks());
+}
+
+void DeckMixEngine::syncTempos()
+{
+    // Runs between pieces, while no deck is rendering, so every deck's position is settled
+    const int leaderIndex = syncLeader.load();
+    double leaderBeat = 0.0, leaderBeatsPerSample = 0.0;
+
+    const bool leaderRunning = leaderIndex >= 0 && leaderIndex < channels.size()
+        && channels.getUnchecked(leaderIndex)->deck->getBeatClock(leaderBeat, leaderBeatsPerSample);
+
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        auto* channel = channels.getUnchecked(i);
+
+        if (leaderRunning && i != leaderIndex && channel->followsLeader.load())
+            channel->deck->followBeatClock(leaderBeat, leaderBeatsPerSample);
+        else if (channel->deck->isTempoSynced())
+            channel->deck->releaseTempoSync();
+    }
+}
+
+float DeckMixEngine::getTargetGain(const DeckChannel& channel) const
+{
+    const auto side = (CrossfadeSide)channel.side.load();
+    const float level = channel.level.load();
+
+    if (side == CrossfadeSide::thru)
+        return level;
+
+    const float crossfade = crossfadePosition.load();
+    const auto curve = (CrossfadeCurve)crossfadeCurve.load();
+
+    return level * MixKernel::getCrossfadeGain(curve, side == CrossfadeSide::a ? 1.0f - crossfade : crossfade);
+}
+
+void DeckMixEngine::setDeckLevel(int deckIndex, float level)
+{
+    if (auto* channel = channels[deckIndex])
+        channel->level = level;
+}
+
+void DeckMixEngine::setCrossfadeSide(int deckIndex, CrossfadeSide side)
+{
+    if (auto* channel = channels[deckIndex])
+        channel->side = (int)side;
+}
+
+float DeckMixEngine::getDeckLevel(int deckIndex) const
+{
+    auto* channel = channels[deckIndex];
+    return channel != nullptr ? channel->level.load() : 0.0f;
+}
+
+DeckMixEngine::CrossfadeSide DeckMixEngine::getCrossfadeSide(int deckIndex) const
+{
+    auto* channel = channels[deckIndex];
+    return channel != nullptr ? (CrossfadeSide)channel->side.load() : CrossfadeSide::thru;
+}
+
+void DeckMixEngine::setCrossfade(float position)
+{
+    crossfadePosition = juce::jlimit(0.0f, 1.0f, position);
+}
+
+void DeckMixEngine::setCrossfadeCurve(CrossfadeCurve curve)
+{
+    crossfadeCurve = (int)curve;
+}
+
+void DeckMixEngine::setSyncLeader(int deckIndex)
+{
+    syncLeader = deckIndex;
+}
+
+void DeckMixEngine::setTempoSync(int deckIndex, bool shouldFollowLeader)
+{
+    if (auto* channel = channels[deckIndex])
+        channel->followsLeader = shouldFollowLeader;
+}
+
+bool DeckMixEngine::isTempoSynced(int deckIndex) const
+{
+    auto* channel = channels[deckIndex];
+    return channel != nullptr && channel->followsLeader.load();
+}
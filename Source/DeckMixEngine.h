@@ -0,0 +1,110 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include "DeckBusPool.h"
+#include "DeckRenderPool.h"
+#include "MixKernel.h"
+#include "AudioCallbackStats.h"
+
+class SignalAnalyser;
+
+// ============ Deck Mix Engine ============
+// Renders any number of decks into their own buses, in parallel on a small
+// render pool, then mixes them on the audio thread with per-deck level and
+// crossfader gains. Parameters come from the GUI through atomics. Before
+// every block, decks that follow the sync leader are matched to its tempo
+// and beat phase, so they render it already in step.
+class DeckMixEngine
+{
+public:
+    static constexpr int maxDecks = 16;
+    static_assert(maxDecks <= AudioCallbackStats::maxDecks, "every deck needs its own stats slot");
+
+    // Which side of the crossfader a deck sits on; thru decks ignore the crossfader
+    enum class CrossfadeSide
+    {
+        a = 0,
+        b,
+        thru
+    };
+
+    DeckMixEngine();
+    ~DeckMixEngine();
+
+    // Message thread, while audio is stopped: the engine doesn't own the decks
+    void addDeck(PlayerAudio& deck, CrossfadeSide side);
+    int getNumDecks() const { return channels.size(); }
+
+    // Message thread, while audio is stopped: meters fed with each deck's output
+    // before its fader, and with the master mix; nullptr for none
+    void setDeckAnalyser(int deckIndex, SignalAnalyser* analyser);
+    void setMasterAnalyser(SignalAnalyser* analyser) { masterAnalyser = analyser; }
+
+    // Message thread, while audio is stopped: where to add each deck's stage times and the mix time
+    void setCallbackStats(AudioCallbackStats* stats) { callbackStats = stats; }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numOutputChannels);
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+    void releaseResources();
+
+    // Safe from any thread
+    void setDeckLevel(int deckIndex, float level);
+    void setCrossfadeSide(int deckIndex, CrossfadeSide side);
+    void setCrossfade(float position);
+    void setCrossfadeCurve(CrossfadeCurve curve);
+
+    float getDeckLevel(int deckIndex) const;
+    CrossfadeSide getCrossfadeSide(int deckIndex) const;
+    float getCrossfade() const { return crossfadePosition.load(); }
+    CrossfadeCurve getCrossfadeCurve() const { return (CrossfadeCurve)crossfadeCurve.load(); }
+
+    // Tempo sync; a leader of -1 turns it off for every deck
+    void setSyncLeader(int deckIndex);
+    void setTempoSync(int deckIndex, bool shouldFollowLeader);
+    int getSyncLeader() const { return syncLeader.load(); }
+    bool isTempoSynced(int deckIndex) const;
+
+    // Offline renders may block and allocate in the decks, so they skip the realtime checks
+    void setNonRealtime(bool shouldBeNonRealtime) { nonRealtime = shouldBeNonRealtime; }
+
+    int getNumRenderThreads() const { return renderPool != nullptr ? renderPool->getNumWorkers() + 1 : 1; }
+
+    // Before prepareToPlay(): workers helping the audio thread, or -1 for one per spare core
+    void setNumRenderWorkers(int numWorkers) { requestedWorkers = numWorkers; }
+
+private:
+    struct DeckChannel
+    {
+        PlayerAudio* deck = nullptr;
+        std::atomic<float> level{ 0.7f };
+        std::atomic<int> side{ (int)CrossfadeSide::thru };
+        std::atomic<bool> followsLeader{ false };
+        SignalAnalyser* analyser = nullptr;
+
+        // Audio thread only
+        juce::SmoothedValue<float> gain;
+    };
+
+    juce::OwnedArray<DeckChannel> channels;
+    DeckBusPool deckBuses;
+    std::unique_ptr<DeckRenderPool> renderPool;
+    SignalAnalyser* masterAnalyser = nullptr;
+    AudioCallbackStats* callbackStats = nullptr;
+
+    std::atomic<float> crossfadePosition{ 0.5f };
+    std::atomic<int> crossfadeCurve{ (int)CrossfadeCurve::linear };
+    std::atomic<int> syncLeader{ -1 };
+
+    // Size of the piece currently being rendered, read by the render jobs
+    int samplesToRender = 0;
+    double currentSampleRate = 44100.0;
+    double renderTimestamp = 0.0;   // when the piece being rendered starts playing
+    bool nonRealtime = false;
+    int requestedWorkers = -1;
+
+    float getTargetGain(const DeckChannel& channel) const;
+    void syncTempos();
+    static void renderDeck(void* engine, int deckIndex);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckMixEngine)
+};
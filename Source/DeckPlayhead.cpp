@@ -0,0 +1,54 @@
+#include "DeckPlayhead.h"
+
+double PlayheadSnapshot::getAudiblePosition(double now) const
+{
+    // The block's first sample reaches the speakers latencySeconds after it was rendered
+    const double elapsedSeconds = (now - timestamp) * 0.001 - latencySeconds;
+    return (double)position + elapsedSeconds * samplesPerSecond;
+}
+
+void DeckPlayhead::publish(const PlayheadSnapshot& snapshot)
+{
+    const auto count = sequence.load(std::memory_order_relaxed);
+
+    // Odd while the fields are being written
+    sequence.store(count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    position.store(snapshot.position, std::memory_order_relaxed);
+    timestamp.store(snapshot.timestamp, std::memory_order_relaxed);
+    samplesPerSecond.store(snapshot.samplesPerSecond, std::memory_order_relaxed);
+    latencySeconds.store(snapshot.latencySeconds, std::memory_order_relaxed);
+    playing.store(snapshot.playing, std::memory_order_relaxed);
+    streamFinished.store(snapshot.streamFinished, std::memory_order_relaxed);
+
+    sequence.store(count + 2, std::memory_order_release);
+}
+
+PlayheadSnapshot DeckPlayhead::read() const
+{
+    PlayheadSnapshot snapshot;
+
+    for (;;)
+    {
+        const auto before = sequence.load(std::memory_order_acquire);
+
+        if ((before & 1) != 0)
+        {
+            juce::Thread::yield();
+            continue;
+        }
+
+        snapshot.position = position.load(std::memory_order_relaxed);
+        snapshot.timestamp = timestamp.load(std::memory_order_relaxed);
+        snapshot.samplesPerSecond = samplesPerSecond.load(std::memory_order_relaxed);
+        snapshot.latencySeconds = latencySeconds.load(std::memory_order_relaxed);
+        snapshot.playing = playing.load(std::memory_order_relaxed);
+        snapshot.streamFinished = streamFinished.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) == before)
+            return snapshot;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Playhead Snapshot ============
+// Where a deck was when the audio thread rendered its last block
+struct PlayheadSnapshot
+{
+    juce::int64 position = 0;           // file sample at the start of the block
+    double timestamp = 0.0;             // juce::Time::getMillisecondCounterHiRes() as the block was rendered
+    double samplesPerSecond = 0.0;      // file samples played per second of real time; 0 when stopped
+    double latencySeconds = 0.0;        // from rendering to the speakers: chain delay, device and buffer
+    bool playing = false;
+    bool streamFinished = false;
+
+    // File sample audible at time now (a getMillisecondCounterHiRes() value)
+    double getAudiblePosition(double now) const;
+};
+
+// ============ Deck Playhead ============
+// Sequence lock around one snapshot. The audio thread writes it once per block
+// without ever waiting; a reader retries in the rare case it overlapped a write.
+// The fields are relaxed atomics so a torn read is harmless, just discarded.
+class DeckPlayhead
+{
+public:
+    DeckPlayhead() = default;
+
+    // One writer at a time: the audio thread, or the message thread while it holds the deck's track lock
+    void publish(const PlayheadSnapshot& snapshot);
+
+    // Any thread
+    PlayheadSnapshot read() const;
+
+private:
+    std::atomic<juce::uint32> sequence{ 0 };
+    std::atomic<juce::int64> position{ 0 };
+    std::atomic<double> timestamp{ 0.0 };
+    std::atomic<double> samplesPerSecond{ 0.0 };
+    std::atomic<double> latencySeconds{ 0.0 };
+    std::atomic<bool> playing{ false };
+    std::atomic<bool> streamFinished{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckPlayhead)
+};
@@ -0,0 +1,368 @@
+#include "DeckReadAheadSource.h"
+
+// ============ DeckReadAheadThread Implementation ============
+DeckReadAheadThread::DeckReadAheadThread() : juce::TimeSliceThread("Deck Read-Ahead")
+{
+    startThread(juce::Thread::Priority::high);
+}
+
+DeckReadAheadThread::~DeckReadAheadThread()
+{
+    stopThread(2000);
+}
+
+// ============ DeckReadAheadSource Implementation ============
+DeckReadAheadSource::DeckReadAheadSource(juce::PositionableAudioSource* s, bool deleteSourceWhenDeleted,
+    juce::TimeSliceThread& thread, int samplesToBuffer, int numChannels, bool readSourceDirectly)
+    : source(s, deleteSourceWhenDeleted),
+      backgroundThread(thread),
+      numberOfSamplesToBuffer(juce::jmax(8192, samplesToBuffer)),
+      numberOfChannels(numChannels),
+      readsDirectly(readSourceDirectly)
+{
+    jassert(source != nullptr);
+}
+
+DeckReadAheadSource::~DeckReadAheadSource()
+{
+    releaseResources();
+}
+
+void DeckReadAheadSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    if (readsDirectly)
+    {
+        source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+        isPrepared = true;
+        return;
+    }
+
+    // Make sure the read-ahead thread is not touching the ring while we resize it
+    backgroundThread.removeTimeSliceClient(this);
+
+    const int bufferSizeNeeded = juce::jmax(samplesPerBlockExpected * 2, numberOfSamplesToBuffer);
+    historySamples = bufferSizeNeeded / 4;
+
+    buffer.setSize(numberOfChannels, bufferSizeNeeded + historySamples);
+    buffer.clear();
+
+    for (auto& preroll : prerollBuffers)
+        preroll.setSize(numberOfChannels, maxPrerollSamples);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+        bufferValidStart = bufferValidEnd = nextPlayPos.load();
+        prerollStarts[0] = prerollStarts[1] = -1;
+        prerollLengths[0] = prerollLengths[1] = 0;
+    }
+
+    source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    isPrepared = true;
+
+    backgroundThread.addTimeSliceClient(this);
+}
+
+void DeckReadAheadSource::releaseResources()
+{
+    backgroundThread.removeTimeSliceClient(this);
+    isPrepared = false;
+
+    buffer.setSize(numberOfChannels, 0);
+
+    for (auto& preroll : prerollBuffers)
+        preroll.setSize(numberOfChannels, 0);
+
+    source->releaseResources();
+}
+
+void DeckReadAheadSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (readsDirectly)
+    {
+        readDirect(bufferToFill);
+        return;
+    }
+
+    auto start = nextPlayPos.load();
+    const auto end = start + bufferToFill.numSamples;
+    bool missingSamples = false;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+
+        const auto validStart = juce::jlimit(bufferValidStart, bufferValidEnd, start);
+        const auto validEnd = juce::jlimit(bufferValidStart, bufferValidEnd, end);
+        missingSamples = validStart > start || validEnd < end;
+
+        if (validStart == validEnd)
+        {
+            bufferToFill.clearActiveBufferRegion();
+        }
+        else
+        {
+            auto* dest = bufferToFill.buffer;
+            const int numValid = (int)(validEnd - validStart);
+            const int destStart = bufferToFill.startSample + (int)(validStart - start);
+            const int ringSize = buffer.getNumSamples();
+            const int ringStart = (int)(validStart % ringSize);
+            const int firstPart = juce::jmin(numValid, ringSize - ringStart);
+
+            if (validStart > start)
+                dest->clear(bufferToFill.startSample, (int)(validStart - start));
+
+            if (validEnd < end)
+                dest->clear(destStart + numValid, (int)(end - validEnd));
+
+            for (int channel = 0; channel < dest->getNumChannels(); ++channel)
+            {
+                if (channel >= numberOfChannels)
+                {
+                    dest->clear(channel, destStart, numValid);
+                    continue;
+                }
+
+                dest->copyFrom(channel, destStart, buffer, channel, ringStart, firstPart);
+
+                if (numValid > firstPart)
+                    dest->copyFrom(channel, destStart + firstPart, buffer, channel, 0, numValid - firstPart);
+            }
+        }
+    }
+
+    // Silence past the end of a non-looping file is expected, not a dropout
+    if (missingSamples && (source->isLooping() || start < source->getTotalLength()))
+        ++underrunCount;
+
+    // A seek from another thread while we were copying wins over our advance
+    nextPlayPos.compare_exchange_strong(start, end);
+}
+
+void DeckReadAheadSource::readDirect(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto start = nextPlayPos.load();
+
+    // Only the audio thread touches the source's own position in this mode
+    if (source->getNextReadPosition() != start)
+        source->setNextReadPosition(start);
+
+    source->getNextAudioBlock(bufferToFill);
+    nextPlayPos.compare_exchange_strong(start, start + bufferToFill.numSamples);
+}
+
+void DeckReadAheadSource::setNextReadPosition(juce::int64 newPosition)
+{
+    // Only a store: seeks and loop wraps land here from the callback, and the read-ahead thread finds the jump on its next poll
+    nextPlayPos = juce::jmax((juce::int64)0, newPosition);
+}
+
+void DeckReadAheadSource::expectJump()
+{
+    if (readsDirectly)
+        return;
+
+    fastPollUntil = juce::Time::getMillisecondCounter() + (juce::uint32)expectJumpMs;
+    backgroundThread.notify();
+}
+
+juce::int64 DeckReadAheadSource::getNextReadPosition() const
+{
+    const auto pos = nextPlayPos.load();
+
+    if (source->isLooping())
+    {
+        const auto length = source->getTotalLength();
+        if (length > 0)
+            return pos % length;
+    }
+
+    return pos;
+}
+
+juce::int64 DeckReadAheadSource::getTotalLength() const
+{
+    return source->getTotalLength();
+}
+
+bool DeckReadAheadSource::isLooping() const
+{
+    return source->isLooping();
+}
+
+bool DeckReadAheadSource::waitForBufferedSamples(int numSamples, int timeoutMs)
+{
+    if (!isPrepared)
+        return false;
+
+    if (readsDirectly)
+        return true;
+
+    numSamples = juce::jmin(numSamples, buffer.getNumSamples() - historySamples);
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)timeoutMs;
+
+    for (;;)
+    {
+        if (getNumBufferedSamples() >= numSamples)
+            return true;
+
+        const auto now = juce::Time::getMillisecondCounter();
+        if (now >= deadline)
+            return false;
+
+        backgroundThread.notify();
+        bufferReadyEvent.wait((int)(deadline - now));
+    }
+}
+
+int DeckReadAheadSource::getNumBufferedSamples() const
+{
+    if (readsDirectly)
+        return numberOfSamplesToBuffer;
+
+    const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+    const auto pos = nextPlayPos.load();
+
+    if (pos < bufferValidStart || pos > bufferValidEnd)
+        return 0;
+
+    return (int)(bufferValidEnd - pos);
+}
+
+void DeckReadAheadSource::setPrerollRegion(juce::int64 start, int numSamples)
+{
+    // A direct source seeks inline, so a loop wrap never needs a preroll
+    if (readsDirectly)
+        return;
+
+    requestedPrerollLength = juce::jlimit(0, maxPrerollSamples, numSamples);
+    requestedPrerollStart = start;
+    backgroundThread.notify();
+}
+
+int DeckReadAheadSource::getPrerollLength(juce::int64 start) const
+{
+    const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+    return prerollStarts[activePreroll] == start ? prerollLengths[activePreroll] : 0;
+}
+
+bool DeckReadAheadSource::readPreroll(juce::int64 position, const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+
+    const auto& preroll = prerollBuffers[activePreroll];
+    const auto prerollStart = prerollStarts[activePreroll];
+
+    if (prerollStart < 0 || position < prerollStart
+        || position + bufferToFill.numSamples > prerollStart + prerollLengths[activePreroll])
+        return false;
+
+    const int offset = (int)(position - prerollStart);
+
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+    {
+        if (channel < numberOfChannels)
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample, preroll, channel, offset, bufferToFill.numSamples);
+        else
+            bufferToFill.buffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+    }
+
+    return true;
+}
+
+int DeckReadAheadSource::useTimeSlice()
+{
+    // Playback comes first; the preroll only gets filled in between
+    const bool readChunk = readNextBufferChunk();
+    const bool readPrerollChunk = readRequestedPreroll();
+
+    if (readChunk || readPrerollChunk)
+        return 1;
+
+    // Nothing wakes this thread when the play head jumps, so it looks again soon while the deck plays
+    const auto playPos = nextPlayPos.load();
+    const bool moving = playPos != polledPlayPos
+        || (int)(fastPollUntil.load() - juce::Time::getMillisecondCounter()) > 0;
+    polledPlayPos = playPos;
+
+    return moving ? activePollMs : idlePollMs;
+}
+
+bool DeckReadAheadSource::readNextBufferChunk()
+{
+    juce::int64 sectionStart;
+    int sectionLength;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+        const auto playPos = nextPlayPos.load();
+
+        // The play head jumped outside what we have, so start the ring again from there
+        if (playPos < bufferValidStart || playPos > bufferValidEnd)
+            bufferValidStart = bufferValidEnd = playPos;
+
+        // Keep some history so small backward nudges are still served from memory
+        bufferValidStart = juce::jmax(bufferValidStart, playPos - historySamples);
+
+        const auto targetEnd = bufferValidStart + buffer.getNumSamples();
+        sectionStart = bufferValidEnd;
+        sectionLength = (int)juce::jmin((juce::int64)samplesPerChunk, targetEnd - bufferValidEnd);
+    }
+
+    if (sectionLength <= 0)
+        return false;
+
+    // The section lies outside the valid range, so the callback never reads it while we write
+    readBufferSection(sectionStart, sectionLength);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+        bufferValidEnd = sectionStart + sectionLength;
+    }
+
+    bufferReadyEvent.signal();
+    return true;
+}
+
+void DeckReadAheadSource::readBufferSection(juce::int64 start, int length)
+{
+    if (source->getNextReadPosition() != start)
+        source->setNextReadPosition(start);
+
+    const int ringSize = buffer.getNumSamples();
+    const int ringStart = (int)(start % ringSize);
+    const int firstPart = juce::jmin(length, ringSize - ringStart);
+
+    source->getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, ringStart, firstPart));
+
+    if (length > firstPart)
+        source->getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, length - firstPart));
+}
+
+bool DeckReadAheadSource::readRequestedPreroll()
+{
+    const auto start = requestedPrerollStart.load();
+    const auto length = requestedPrerollLength.load();
+    int target;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+
+        if (start < 0 || length <= 0
+            || (prerollStarts[activePreroll] == start && prerollLengths[activePreroll] == length))
+            return false;
+
+        target = 1 - activePreroll;
+    }
+
+    // Nothing reads the inactive buffer, so it can be filled without the lock
+    source->setNextReadPosition(start);
+    source->getNextAudioBlock(juce::AudioSourceChannelInfo(&prerollBuffers[target], 0, length));
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferRangeLock);
+        prerollStarts[target] = start;
+        prerollLengths[target] = length;
+        activePreroll = target;
+    }
+
+    return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Shared Read-Ahead Thread ============
+// One background thread that does all file I/O and decoding for every deck.
+// Decks get it through juce::SharedResourcePointer so the app owns exactly one.
+class DeckReadAheadThread : public juce::TimeSliceThread
+{
+public:
+    DeckReadAheadThread();
+    ~DeckReadAheadThread() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckReadAheadThread)
+};
+
+// ============ Deck Read-Ahead Source ============
+// Keeps a ring buffer of decoded samples ahead of the play position, filled by the
+// read-ahead thread. The audio callback only copies from the ring; if the ring has
+// not caught up the missing samples are silenced and counted as an underrun.
+// A source that already lives in memory (a cached decoded track) skips the ring and
+// is read directly from the callback, so seeks and loop wraps cost no I/O at all.
+// Offline renders read directly too, since they can afford to wait on the file.
+class DeckReadAheadSource : public juce::PositionableAudioSource,
+    private juce::TimeSliceClient
+{
+public:
+    DeckReadAheadSource(juce::PositionableAudioSource* source, bool deleteSourceWhenDeleted,
+        juce::TimeSliceThread& thread, int samplesToBuffer, int numChannels,
+        bool readSourceDirectly = false);
+    ~DeckReadAheadSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // Any thread, the audio thread included (seek commands, loop wraps, preroll fallbacks):
+    // only stores the position, and never wakes the read-ahead thread
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    // Message thread, after posting a seek or a play: the read-ahead thread polls quickly for a
+    // moment, so it starts refilling as soon as the audio thread applies the jump
+    void expectJump();
+
+    // Blocks a non-audio thread until numSamples from the play position are buffered
+    bool waitForBufferedSamples(int numSamples, int timeoutMs);
+
+    // Keeps a decoded copy of [start, start + numSamples) so a loop can jump there without a seek.
+    // Pass a negative start to stop asking for one.
+    static constexpr int maxPrerollSamples = 16384;
+    void setPrerollRegion(juce::int64 start, int numSamples);
+    int getPrerollLength(juce::int64 start) const;
+    bool readPreroll(juce::int64 position, const juce::AudioSourceChannelInfo& bufferToFill);
+
+    int getNumSamplesToBuffer() const { return numberOfSamplesToBuffer; }
+    int getNumBufferedSamples() const;
+    bool readsSourceDirectly() const { return readsDirectly; }
+    juce::uint32 getUnderrunCount() const { return underrunCount.load(); }
+    void resetUnderrunCount() { underrunCount = 0; }
+
+private:
+    juce::OptionalScopedPointer<juce::PositionableAudioSource> source;
+    juce::TimeSliceThread& backgroundThread;
+    int numberOfSamplesToBuffer;
+    int numberOfChannels;
+    const bool readsDirectly;
+
+    // Ring of decoded audio; sample position p lives at index p % buffer.getNumSamples()
+    juce::AudioBuffer<float> buffer;
+    mutable juce::SpinLock bufferRangeLock;
+    juce::int64 bufferValidStart = 0;
+    juce::int64 bufferValidEnd = 0;
+    int historySamples = 0;
+
+    // Double-buffered preroll: the thread fills the inactive one, then flips under bufferRangeLock
+    juce::AudioBuffer<float> prerollBuffers[2];
+    juce::int64 prerollStarts[2] = { -1, -1 };
+    int prerollLengths[2] = { 0, 0 };
+    int activePreroll = 0;
+    std::atomic<juce::int64> requestedPrerollStart{ -1 };
+    std::atomic<int> requestedPrerollLength{ 0 };
+
+    std::atomic<juce::int64> nextPlayPos{ 0 };
+    std::atomic<juce::uint32> underrunCount{ 0 };
+    juce::WaitableEvent bufferReadyEvent;
+    bool isPrepared = false;
+
+    // Read-ahead thread only: the play position its last idle slice saw
+    juce::int64 polledPlayPos = 0;
+    std::atomic<juce::uint32> fastPollUntil{ 0 };
+
+    static constexpr int samplesPerChunk = 4096;
+    static constexpr int activePollMs = 10;     // while the play head moves
+    static constexpr int idlePollMs = 100;      // while it stands still
+    static constexpr int expectJumpMs = 200;    // polling at the active rate after expectJump()
+
+    void readDirect(const juce::AudioSourceChannelInfo& bufferToFill);
+    int useTimeSlice() override;
+    bool readNextBufferChunk();
+    void readBufferSection(juce::int64 start, int length);
+    bool readRequestedPreroll();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckReadAheadSource)
+};
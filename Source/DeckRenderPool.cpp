@@ -0,0 +1,157 @@
+#include "DeckRenderPool.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+namespace
+{
+    inline void pauseForSpin()
+    {
+#if JUCE_INTEL
+        _mm_pause();
+#elif JUCE_ARM && JUCE_MSVC
+        __yield();
+#elif JUCE_ARM
+        __asm__ __volatile__ ("yield");
+#endif
+    }
+
+    constexpr int workerSpinIterations = 20000;
+}
+
+// ============ Worker ============
+class DeckRenderPool::Worker : public juce::Thread
+{
+public:
+    Worker(DeckRenderPool& p, int index)
+        : juce::Thread("Deck Render " + juce::String(index + 1)), pool(p)
+    {
+        if (!startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(9)))
+            startThread(juce::Thread::Priority::highest);
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        wakeEvent.signal();
+        stopThread(2000);
+    }
+
+    // Audio thread: only touches the event when the worker has actually gone to sleep
+    void wakeIfSleeping()
+    {
+        if (sleeping.load())
+            wakeEvent.signal();
+    }
+
+    void run() override
+    {
+        auto lastGeneration = (juce::uint32)(pool.workCounter.load() >> 32);
+
+        while (!threadShouldExit())
+        {
+            auto generation = (juce::uint32)(pool.workCounter.load(std::memory_order_acquire) >> 32);
+
+            // Stay hot for a little while, since the next block is usually close
+            for (int spin = 0; spin < workerSpinIterations && generation == lastGeneration; ++spin)
+            {
+                pauseForSpin();
+                generation = (juce::uint32)(pool.workCounter.load(std::memory_order_acquire) >> 32);
+            }
+
+            if (generation == lastGeneration)
+            {
+                sleeping = true;
+
+                // Re-check after announcing we sleep so a block published in between isn't missed
+                generation = (juce::uint32)(pool.workCounter.load(std::memory_order_acquire) >> 32);
+                if (generation == lastGeneration)
+                    wakeEvent.wait(20);
+
+                sleeping = false;
+                continue;
+            }
+
+            lastGeneration = generation;
+            pool.claimAndRunJobs(generation);
+        }
+    }
+
+private:
+    DeckRenderPool& pool;
+    juce::WaitableEvent wakeEvent;
+    std::atomic<bool> sleeping{ false };
+};
+
+// ============ DeckRenderPool Implementation ============
+DeckRenderPool::DeckRenderPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i));
+}
+
+DeckRenderPool::~DeckRenderPool()
+{
+    workers.clear();
+}
+
+int DeckRenderPool::getDefaultNumWorkers(int numDecks)
+{
+    return juce::jlimit(0, 7, juce::jmin(numDecks, juce::SystemStats::getNumCpus()) - 1);
+}
+
+void DeckRenderPool::run(int numJobs, JobFunction job, void* context)
+{
+    if (numJobs <= 0)
+        return;
+
+    if (workers.isEmpty() || numJobs == 1)
+    {
+        for (int i = 0; i < numJobs; ++i)
+            job(context, i);
+
+        return;
+    }
+
+    numJobsInBlock = numJobs;
+    jobFunction = job;
+    jobContext = context;
+    jobsDone.store(0, std::memory_order_relaxed);
+
+    // Publishing the new generation with index 0 releases the block to the workers
+    const auto generation = (juce::uint32)(workCounter.load(std::memory_order_relaxed) >> 32) + 1;
+    workCounter.store((juce::uint64)generation << 32, std::memory_order_release);
+
+    for (auto* worker : workers)
+        worker->wakeIfSleeping();
+
+    // Do our share, then wait at the barrier for the rest
+    claimAndRunJobs(generation);
+
+    while (jobsDone.load(std::memory_order_acquire) < numJobs)
+        pauseForSpin();
+}
+
+bool DeckRenderPool::claimAndRunJobs(juce::uint32 generation)
+{
+    bool ranAny = false;
+    auto work = workCounter.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        // A claim only succeeds while the counter still belongs to this block
+        if ((juce::uint32)(work >> 32) != generation || (int)(work & 0xffffffffu) >= numJobsInBlock)
+            break;
+
+        if (workCounter.compare_exchange_weak(work, work + 1, std::memory_order_acq_rel))
+        {
+            jobFunction(jobContext, (int)(work & 0xffffffffu));
+            jobsDone.fetch_add(1, std::memory_order_release);
+            ranAny = true;
+            work = workCounter.load(std::memory_order_acquire);
+        }
+    }
+
+    return ranAny;
+}
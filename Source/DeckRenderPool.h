@@ -0,0 +1,40 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Deck Render Pool ============
+// A few worker threads that help the audio thread render decks in parallel.
+// run() hands out job indices through one lock-free counter and spins on a
+// completion barrier; idle workers spin briefly, then sleep until the next block.
+class DeckRenderPool
+{
+public:
+    using JobFunction = void (*)(void* context, int jobIndex);
+
+    explicit DeckRenderPool(int numWorkers);
+    ~DeckRenderPool();
+
+    // Audio thread: runs job(context, 0..numJobs-1) across the workers and the
+    // calling thread, and returns once every job has finished
+    void run(int numJobs, JobFunction job, void* context);
+
+    int getNumWorkers() const { return workers.size(); }
+
+    // One worker per core beyond the audio thread, capped by how many decks there are
+    static int getDefaultNumWorkers(int numDecks);
+
+private:
+    class Worker;
+
+    juce::OwnedArray<Worker> workers;
+
+    // High 32 bits: block generation, low 32 bits: next job index to claim
+    std::atomic<juce::uint64> workCounter{ 0 };
+    std::atomic<int> jobsDone{ 0 };
+    int numJobsInBlock = 0;
+    JobFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+
+    bool claimAndRunJobs(juce::uint32 generation);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckRenderPool)
+};
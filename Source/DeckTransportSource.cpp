@@ -0,0 +1,121 @@
+#include "DeckTransportSource.h"
+
+DeckTransportSource::DeckTransportSource()
+{
+}
+
+DeckTransportSource::~DeckTransportSource()
+{
+    setSource(nullptr);
+}
+
+void DeckTransportSource::setSource(juce::PositionableAudioSource* newSource)
+{
+    if (source == newSource)
+        return;
+
+    auto* oldSource = source;
+
+    if (newSource != nullptr && isPrepared)
+        newSource->prepareToPlay(preparedBlockSize, preparedSampleRate);
+
+    source = newSource;
+    playing = false;
+    fadingOut = false;
+    streamFinished = false;
+    lastGain = 0.0f;
+
+    if (oldSource != nullptr && isPrepared)
+        oldSource->releaseResources();
+}
+
+void DeckTransportSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+
+    if (source != nullptr)
+        source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    isPrepared = true;
+}
+
+void DeckTransportSource::releaseResources()
+{
+    if (source != nullptr)
+        source->releaseResources();
+
+    isPrepared = false;
+}
+
+void DeckTransportSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (source == nullptr || (!playing && !fadingOut))
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    source->getNextAudioBlock(bufferToFill);
+
+    // Ramp across the block whenever the gain moved, so starts, stops and fader jumps don't click
+    const float targetGain = playing ? gain : 0.0f;
+
+    if (lastGain != targetGain)
+        bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, bufferToFill.numSamples, lastGain, targetGain);
+    else if (targetGain != 1.0f)
+        bufferToFill.buffer->applyGain(bufferToFill.startSample, bufferToFill.numSamples, targetGain);
+
+    lastGain = targetGain;
+    fadingOut = false;
+
+    if (playing && !source->isLooping() && source->getNextReadPosition() > source->getTotalLength() + 1)
+    {
+        playing = false;
+        streamFinished = true;
+        lastGain = 0.0f;
+    }
+}
+
+void DeckTransportSource::start()
+{
+    if (!playing && source != nullptr)
+    {
+        playing = true;
+        fadingOut = false;
+        streamFinished = false;
+    }
+}
+
+void DeckTransportSource::stop()
+{
+    if (playing)
+    {
+        playing = false;
+        fadingOut = true;
+    }
+}
+
+void DeckTransportSource::setNextReadPosition(juce::int64 newPosition)
+{
+    if (source != nullptr)
+    {
+        source->setNextReadPosition(newPosition);
+        streamFinished = false;
+    }
+}
+
+juce::int64 DeckTransportSource::getNextReadPosition() const
+{
+    return source != nullptr ? source->getNextReadPosition() : 0;
+}
+
+juce::int64 DeckTransportSource::getTotalLength() const
+{
+    return source != nullptr ? source->getTotalLength() : 0;
+}
+
+bool DeckTransportSource::isLooping() const
+{
+    return source != nullptr && source->isLooping();
+}
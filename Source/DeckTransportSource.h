@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Deck Transport Source ============
+// Play/stop and gain for one deck. Unlike juce::AudioTransportSource it has no
+// lock and never waits for the callback: apart from setSource() it is only
+// driven from the audio thread, by PlayerAudio's command drain.
+class DeckTransportSource : public juce::PositionableAudioSource
+{
+public:
+    DeckTransportSource();
+    ~DeckTransportSource() override;
+
+    // Message thread, while the owner keeps the audio thread out
+    void setSource(juce::PositionableAudioSource* newSource);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    // Audio thread: start fades in over one block and stop fades out over the next
+    void start();
+    void stop();
+    void setGain(float newGain) { gain = newGain; }
+    bool isPlaying() const { return playing; }
+    bool hasStreamFinished() const { return streamFinished; }
+
+private:
+    juce::PositionableAudioSource* source = nullptr;
+    bool isPrepared = false;
+    int preparedBlockSize = 512;
+    double preparedSampleRate = 44100.0;
+
+    bool playing = false;
+    bool fadingOut = false;
+    bool streamFinished = false;
+    float gain = 1.0f;
+    float lastGain = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckTransportSource)
+};
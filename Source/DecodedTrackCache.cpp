@@ -0,0 +1,354 @@
+#include "DecodedTrackCache.h"
+#include "MappedAudioReader.h"
+#include <cstring>
+
+namespace
+{
+    // IEEE 754 binary16, round-to-nearest; enough range and precision for audio in [-1, 1]
+    juce::uint16 floatToHalf(float value)
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const auto sign = (juce::uint16)((bits >> 16) & 0x8000u);
+        const int exponent = (int)((bits >> 23) & 0xffu) - 127 + 15;
+        juce::uint32 mantissa = bits & 0x7fffffu;
+
+        if (exponent <= 0)
+        {
+            // Subnormal or too small to represent
+            if (exponent < -10)
+                return sign;
+
+            mantissa |= 0x800000u;
+            const int shift = 14 - exponent;
+            return (juce::uint16)(sign | ((mantissa + (1u << (shift - 1))) >> shift));
+        }
+
+        if (exponent >= 31)
+            return (juce::uint16)(sign | 0x7c00u);
+
+        const auto half = (juce::uint32)(sign | (exponent << 10) | (mantissa >> 13));
+        return (juce::uint16)(half + ((mantissa >> 12) & 1u));
+    }
+
+    float halfToFloat(juce::uint16 half)
+    {
+        const juce::uint32 sign = (juce::uint32)(half & 0x8000u) << 16;
+        const int exponent = (half >> 10) & 0x1f;
+        const juce::uint32 mantissa = half & 0x3ffu;
+        juce::uint32 bits;
+
+        if (exponent == 0)
+        {
+            // Subnormals are scaled rather than renormalised; they are far below audibility anyway
+            const float magnitude = (float)mantissa * (1.0f / 16777216.0f);
+            return sign != 0 ? -magnitude : magnitude;
+        }
+
+        if (exponent == 31)
+            bits = sign | 0x7f800000u | (mantissa << 13);
+        else
+            bits = sign | ((juce::uint32)(exponent - 15 + 127) << 23) | (mantissa << 13);
+
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    constexpr int decodeChunkSamples = 65536;
+}
+
+// ============ DecodedTrack Implementation ============
+DecodedTrack::DecodedTrack(const juce::File& f, double rate, int channels, juce::int64 numSamples, SampleStorage s)
+    : file(f),
+      fileSize(f.getSize()),
+      fileModificationTime(f.getLastModificationTime()),
+      sampleRate(rate),
+      numChannels(channels),
+      length(numSamples),
+      storage(s),
+      bytesPerSample(getBytesPerSample(s))
+{
+    data.allocate(getSizeInBytes(), true);
+}
+
+bool DecodedTrack::isUpToDate() const
+{
+    return file.getSize() == fileSize && file.getLastModificationTime() == fileModificationTime;
+}
+
+void DecodedTrack::write(const juce::AudioBuffer<float>& source, int numSamples, juce::int64 position)
+{
+    numSamples = (int)juce::jmin((juce::int64)numSamples, length - position);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* src = source.getReadPointer(juce::jmin(channel, source.getNumChannels() - 1));
+        auto* dest = const_cast<char*>(getChannelData(channel)) + (size_t)position * bytesPerSample;
+
+        switch (storage)
+        {
+            case SampleStorage::int16:
+            {
+                auto* out = reinterpret_cast<juce::int16*>(dest);
+                for (int i = 0; i < numSamples; ++i)
+                    out[i] = (juce::int16)juce::roundToInt(juce::jlimit(-1.0f, 1.0f, src[i]) * 32767.0f);
+                break;
+            }
+
+            case SampleStorage::float16:
+            {
+                auto* out = reinterpret_cast<juce::uint16*>(dest);
+                for (int i = 0; i < numSamples; ++i)
+                    out[i] = floatToHalf(src[i]);
+                break;
+            }
+
+            case SampleStorage::float32:
+            default:
+                std::memcpy(dest, src, (size_t)numSamples * sizeof(float));
+                break;
+        }
+    }
+}
+
+void DecodedTrack::read(juce::AudioBuffer<float>& dest, int destStartSample, juce::int64 startSample, int numSamples) const
+{
+    // Split into silence before the track, the part inside it and silence after
+    const auto validStart = juce::jlimit((juce::int64)0, length, startSample);
+    const auto validEnd = juce::jlimit((juce::int64)0, length, startSample + numSamples);
+    const int leading = (int)juce::jmin((juce::int64)numSamples, validStart - startSample);
+    const int numValid = (int)juce::jmax((juce::int64)0, validEnd - validStart);
+    const int trailing = numSamples - leading - numValid;
+
+    for (int channel = 0; channel < dest.getNumChannels(); ++channel)
+    {
+        auto* out = dest.getWritePointer(channel, destStartSample);
+
+        if (leading > 0)
+            juce::FloatVectorOperations::clear(out, leading);
+
+        if (trailing > 0)
+            juce::FloatVectorOperations::clear(out + leading + numValid, trailing);
+
+        if (numValid <= 0)
+            continue;
+
+        // Mono files play on every output channel
+        const char* src = getChannelData(juce::jmin(channel, numChannels - 1)) + (size_t)validStart * bytesPerSample;
+        out += leading;
+
+        switch (storage)
+        {
+            case SampleStorage::int16:
+            {
+                auto* in = reinterpret_cast<const juce::int16*>(src);
+                for (int i = 0; i < numValid; ++i)
+                    out[i] = (float)in[i] * (1.0f / 32767.0f);
+                break;
+            }
+
+            case SampleStorage::float16:
+            {
+                auto* in = reinterpret_cast<const juce::uint16*>(src);
+                for (int i = 0; i < numValid; ++i)
+                    out[i] = halfToFloat(in[i]);
+                break;
+            }
+
+            case SampleStorage::float32:
+            default:
+                juce::FloatVectorOperations::copy(out, reinterpret_cast<const float*>(src), numValid);
+                break;
+        }
+    }
+}
+
+// ============ CachedTrackSource Implementation ============
+CachedTrackSource::CachedTrackSource(DecodedTrack::Ptr t) : track(std::move(t))
+{
+    jassert(track != nullptr);
+}
+
+void CachedTrackSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    track->read(*bufferToFill.buffer, bufferToFill.startSample, position, bufferToFill.numSamples);
+    position += bufferToFill.numSamples;
+}
+
+// ============ Decode Job ============
+class DecodedTrackCache::DecodeJob : public juce::ThreadPoolJob
+{
+public:
+    DecodeJob(DecodedTrackCache& c, const juce::File& f)
+        : juce::ThreadPoolJob("Decode " + f.getFileName()), cache(c), file(f)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        decode();
+
+        const juce::ScopedLock sl(cache.lock);
+        cache.pendingPaths.removeString(file.getFullPathName());
+        return jobHasFinished;
+    }
+
+private:
+    DecodedTrackCache& cache;
+    const juce::File file;
+
+    void decode()
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(MappedAudioReader::createReaderFor(cache.formatManager, file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return;
+
+        const auto storage = cache.getStorage();
+        const int numChannels = juce::jlimit(1, 2, (int)reader->numChannels);
+        const auto bytesNeeded = reader->lengthInSamples * numChannels * (juce::int64)DecodedTrack::getBytesPerSample(storage);
+
+        // Never let one track push everything else out
+        if (bytesNeeded > cache.getBudget() / 2)
+            return;
+
+        DecodedTrack::Ptr track = new DecodedTrack(file, reader->sampleRate, numChannels, reader->lengthInSamples, storage);
+        juce::AudioBuffer<float> chunk(numChannels, decodeChunkSamples);
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples; position += decodeChunkSamples)
+        {
+            if (shouldExit())
+                return;
+
+            const int numSamples = (int)juce::jmin((juce::int64)decodeChunkSamples, reader->lengthInSamples - position);
+            reader->read(&chunk, 0, numSamples, position, true, numChannels > 1);
+            track->write(chunk, numSamples, position);
+        }
+
+        cache.insert(track);
+    }
+};
+
+// ============ DecodedTrackCache Implementation ============
+DecodedTrackCache::DecodedTrackCache()
+{
+    formatManager.registerBasicFormats();
+}
+
+DecodedTrackCache::~DecodedTrackCache()
+{
+    decodePool.removeAllJobs(true, 5000);
+}
+
+DecodedTrack::Ptr DecodedTrackCache::find(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (int i = 0; i < tracks.size(); ++i)
+    {
+        auto* track = tracks.getUnchecked(i);
+
+        if (track->getFile() != file)
+            continue;
+
+        if (!track->isUpToDate())
+        {
+            tracks.remove(i);
+            break;
+        }
+
+        ++hits;
+        tracks.move(i, 0);
+        return track;
+    }
+
+    ++misses;
+    return nullptr;
+}
+
+void DecodedTrackCache::requestDecode(const juce::File& file)
+{
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (pendingPaths.contains(file.getFullPathName()))
+            return;
+
+        for (auto* track : tracks)
+            if (track->getFile() == file && track->isUpToDate())
+                return;
+
+        pendingPaths.add(file.getFullPathName());
+    }
+
+    decodePool.addJob(new DecodeJob(*this, file), true);
+}
+
+void DecodedTrackCache::insert(DecodedTrack::Ptr track)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (int i = tracks.size(); --i >= 0;)
+        if (tracks.getUnchecked(i)->getFile() == track->getFile())
+            tracks.remove(i);
+
+    tracks.insert(0, track);
+    evictToBudget();
+}
+
+void DecodedTrackCache::evictToBudget()
+{
+    juce::int64 used = 0;
+
+    for (auto* track : tracks)
+        used += (juce::int64)track->getSizeInBytes();
+
+    // Least recently used first; a deck still playing an evicted track keeps it alive
+    while (used > budgetBytes && tracks.size() > 0)
+    {
+        used -= (juce::int64)tracks.getLast()->getSizeInBytes();
+        tracks.removeLast();
+    }
+}
+
+void DecodedTrackCache::setBudget(juce::int64 newBudgetBytes)
+{
+    const juce::ScopedLock sl(lock);
+    budgetBytes = juce::jmax((juce::int64)0, newBudgetBytes);
+    evictToBudget();
+}
+
+juce::int64 DecodedTrackCache::getBudget() const
+{
+    const juce::ScopedLock sl(lock);
+    return budgetBytes;
+}
+
+void DecodedTrackCache::setStorage(SampleStorage newStorage)
+{
+    // Only affects tracks decoded from now on
+    const juce::ScopedLock sl(lock);
+    storage = newStorage;
+}
+
+SampleStorage DecodedTrackCache::getStorage() const
+{
+    const juce::ScopedLock sl(lock);
+    return storage;
+}
+
+DecodedTrackCache::Stats DecodedTrackCache::getStats() const
+{
+    const juce::ScopedLock sl(lock);
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.numTracks = tracks.size();
+
+    for (auto* track : tracks)
+        stats.bytesUsed += (juce::int64)track->getSizeInBytes();
+
+    return stats;
+}
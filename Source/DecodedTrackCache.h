@@ -0,0 +1,130 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Sample Storage ============
+// How a decoded track is kept in RAM; the compact forms halve the footprint
+// and are converted back to float as they are read.
+enum class SampleStorage
+{
+    float32 = 0,
+    int16,
+    float16
+};
+
+// ============ Decoded Track ============
+// A whole file decoded into memory, planar, in one of the storage formats.
+// Shared by reference so an evicted track stays alive while a deck plays it.
+class DecodedTrack : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<DecodedTrack>;
+
+    DecodedTrack(const juce::File& file, double sampleRate, int numChannels, juce::int64 length, SampleStorage storage);
+
+    // Decode thread, before the track is published: stores source samples at position
+    void write(const juce::AudioBuffer<float>& source, int numSamples, juce::int64 position);
+
+    // Any thread, no allocation or I/O: samples outside the track come back silent
+    void read(juce::AudioBuffer<float>& dest, int destStartSample, juce::int64 startSample, int numSamples) const;
+
+    const juce::File& getFile() const { return file; }
+    bool isUpToDate() const;
+    double getSampleRate() const { return sampleRate; }
+    int getNumChannels() const { return numChannels; }
+    juce::int64 getLength() const { return length; }
+    SampleStorage getStorage() const { return storage; }
+    size_t getSizeInBytes() const { return (size_t)length * (size_t)numChannels * bytesPerSample; }
+
+    static size_t getBytesPerSample(SampleStorage storage) { return storage == SampleStorage::float32 ? 4 : 2; }
+
+private:
+    const juce::File file;
+    const juce::int64 fileSize;
+    const juce::Time fileModificationTime;
+    const double sampleRate;
+    const int numChannels;
+    const juce::int64 length;
+    const SampleStorage storage;
+    const size_t bytesPerSample;
+    juce::HeapBlock<char> data;
+
+    const char* getChannelData(int channel) const { return data.get() + (size_t)channel * (size_t)length * bytesPerSample; }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedTrack)
+};
+
+// ============ Cached Track Source ============
+// Plays a DecodedTrack. Reads are plain memory conversions, so it is safe to
+// drive straight from the audio thread and seeking costs nothing.
+class CachedTrackSource : public juce::PositionableAudioSource
+{
+public:
+    explicit CachedTrackSource(DecodedTrack::Ptr track);
+
+    void prepareToPlay(int, double) override {}
+    void releaseResources() override {}
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = newPosition; }
+    juce::int64 getNextReadPosition() const override { return position; }
+    juce::int64 getTotalLength() const override { return track->getLength(); }
+    bool isLooping() const override { return false; }
+
+private:
+    DecodedTrack::Ptr track;
+    juce::int64 position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CachedTrackSource)
+};
+
+// ============ Decoded Track Cache ============
+// Fully decoded tracks shared by every deck, most recently used first, kept
+// within a byte budget. A miss queues the file for decoding in the background
+// so the next load of it is instant. Decks get the cache through
+// juce::SharedResourcePointer.
+class DecodedTrackCache
+{
+public:
+    DecodedTrackCache();
+    ~DecodedTrackCache();
+
+    // Message thread: a hit moves the track to the front; a stale entry (file changed) is dropped
+    DecodedTrack::Ptr find(const juce::File& file);
+    void requestDecode(const juce::File& file);
+
+    void setBudget(juce::int64 newBudgetBytes);
+    juce::int64 getBudget() const;
+    void setStorage(SampleStorage newStorage);
+    SampleStorage getStorage() const;
+
+    struct Stats
+    {
+        juce::int64 hits = 0;
+        juce::int64 misses = 0;
+        juce::int64 bytesUsed = 0;
+        int numTracks = 0;
+
+        double getHitRate() const { return hits + misses > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+    };
+
+    Stats getStats() const;
+
+private:
+    class DecodeJob;
+
+    mutable juce::CriticalSection lock;
+    juce::ReferenceCountedArray<DecodedTrack> tracks;
+    juce::StringArray pendingPaths;
+    juce::int64 budgetBytes = (juce::int64)1024 * 1024 * 1024;
+    SampleStorage storage = SampleStorage::float32;
+    juce::int64 hits = 0;
+    juce::int64 misses = 0;
+
+    juce::AudioFormatManager formatManager;
+    juce::ThreadPool decodePool{ 1, 0, juce::Thread::Priority::low };
+
+    void insert(DecodedTrack::Ptr track);
+    void evictToBudget();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedTrackCache)
+};
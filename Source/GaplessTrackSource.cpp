@@ -0,0 +1,131 @@
+#include "GaplessTrackSource.h"
+
+GaplessTrackSource::GaplessTrackSource()
+{
+}
+
+GaplessTrackSource::~GaplessTrackSource()
+{
+}
+
+void GaplessTrackSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+    isPrepared = true;
+
+    if (auto* track = currentTrack.load())
+        track->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    if (auto* track = queuedTrack.load())
+        track->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void GaplessTrackSource::releaseResources()
+{
+    isPrepared = false;
+
+    if (auto* track = currentTrack.load())
+        track->releaseResources();
+
+    if (auto* track = queuedTrack.load())
+        track->releaseResources();
+}
+
+void GaplessTrackSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto* track = currentTrack.load();
+
+    if (track == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    auto* next = queuedTrack.load();
+
+    if (next != nullptr && !track->isLooping())
+    {
+        const auto remaining = track->getTotalLength() - track->getNextReadPosition();
+
+        // Claim the queued track first so the message thread can't unqueue it mid-splice
+        if (remaining < bufferToFill.numSamples && queuedTrack.compare_exchange_strong(next, nullptr))
+        {
+            const int fromCurrent = (int)juce::jmax((juce::int64)0, remaining);
+
+            if (fromCurrent > 0)
+                track->getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer,
+                    bufferToFill.startSample, fromCurrent));
+
+            // The next track starts on the very next sample
+            next->getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer,
+                bufferToFill.startSample + fromCurrent, bufferToFill.numSamples - fromCurrent));
+
+            currentTrack = next;
+            finishedTrack = track;
+            ++spliceCount;
+            return;
+        }
+    }
+
+    track->getNextAudioBlock(bufferToFill);
+}
+
+void GaplessTrackSource::setNextReadPosition(juce::int64 newPosition)
+{
+    if (auto* track = currentTrack.load())
+        track->setNextReadPosition(newPosition);
+}
+
+juce::int64 GaplessTrackSource::getNextReadPosition() const
+{
+    auto* track = currentTrack.load();
+    return track != nullptr ? track->getNextReadPosition() : 0;
+}
+
+juce::int64 GaplessTrackSource::getTotalLength() const
+{
+    auto* track = currentTrack.load();
+    return track != nullptr ? track->getTotalLength() : 0;
+}
+
+bool GaplessTrackSource::isLooping() const
+{
+    auto* track = currentTrack.load();
+    return track != nullptr && track->isLooping();
+}
+
+void GaplessTrackSource::setCurrentTrack(juce::PositionableAudioSource* track)
+{
+    jassert(!isPrepared);
+
+    currentTrack = track;
+    finishedTrack = nullptr;
+}
+
+void GaplessTrackSource::queueNextTrack(juce::PositionableAudioSource* track)
+{
+    jassert(queuedTrack.load() == nullptr);
+
+    if (track != nullptr)
+    {
+        // Preparing starts its read-ahead, so it is buffered well before the splice
+        if (isPrepared)
+            track->prepareToPlay(preparedBlockSize, preparedSampleRate);
+
+        track->setNextReadPosition(0);
+    }
+
+    queuedTrack = track;
+}
+
+bool GaplessTrackSource::unqueueNextTrack(juce::PositionableAudioSource* track)
+{
+    auto* expected = track;
+    return queuedTrack.compare_exchange_strong(expected, nullptr);
+}
+
+juce::PositionableAudioSource* GaplessTrackSource::takeFinishedTrack()
+{
+    return finishedTrack.exchange(nullptr);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Gapless Track Source ============
+// Plays the current track and, once a next track has been queued and buffered,
+// carries straight on into it at the sample after the current one ends. The tracks
+// are owned elsewhere; a spliced-out track is handed back through takeFinishedTrack().
+class GaplessTrackSource : public juce::PositionableAudioSource
+{
+public:
+    GaplessTrackSource();
+    ~GaplessTrackSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    // Only while detached from the transport
+    void setCurrentTrack(juce::PositionableAudioSource* track);
+
+    // Message thread: the track is prepared here and must stay alive until it is
+    // either unqueued or returned by takeFinishedTrack()
+    void queueNextTrack(juce::PositionableAudioSource* track);
+    bool unqueueNextTrack(juce::PositionableAudioSource* track);
+    juce::PositionableAudioSource* takeFinishedTrack();
+
+    juce::uint32 getSpliceCount() const { return spliceCount.load(); }
+    juce::PositionableAudioSource* getCurrentTrack() const { return currentTrack.load(); }
+
+private:
+    std::atomic<juce::PositionableAudioSource*> currentTrack{ nullptr };
+    std::atomic<juce::PositionableAudioSource*> queuedTrack{ nullptr };
+    std::atomic<juce::PositionableAudioSource*> finishedTrack{ nullptr };
+    std::atomic<juce::uint32> spliceCount{ 0 };
+
+    bool isPrepared = false;
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GaplessTrackSource)
+};
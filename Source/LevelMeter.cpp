@@ -0,0 +1,160 @@
+#include "LevelMeter.h"
+
+namespace
+{
+    constexpr float minFrequency = 20.0f;
+    constexpr float spectrumTopDb = 0.0f;
+    constexpr float clipLightHeight = 6.0f;
+}
+
+// ============ LevelMeter Implementation ============
+LevelMeter::LevelMeter(SignalAnalyser& a) : analyser(a)
+{
+    analyser.addChangeListener(this);
+    analyser.readFrame(frame);
+}
+
+LevelMeter::~LevelMeter()
+{
+    analyser.removeChangeListener(this);
+}
+
+void LevelMeter::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    analyser.readFrame(frame);
+    repaint();
+}
+
+void LevelMeter::mouseDown(const juce::MouseEvent&)
+{
+    analyser.resetClip();
+}
+
+float LevelMeter::dbToY(float gain, juce::Rectangle<float> area) const
+{
+    const float db = juce::jlimit(minDb, maxDb, juce::Decibels::gainToDecibels(gain, minDb));
+    return juce::jmap(db, minDb, maxDb, area.getBottom(), area.getY());
+}
+
+void LevelMeter::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+
+    // Clip light on top
+    const auto clipArea = bounds.removeFromTop(clipLightHeight);
+    g.setColour(frame.clipped ? juce::Colours::red : juce::Colour(0xff3a1a1a));
+    g.fillRoundedRectangle(clipArea, 1.5f);
+    bounds.removeFromTop(2.0f);
+
+    g.setColour(juce::Colour(0xff0a0a0a));
+    g.fillRoundedRectangle(bounds, 2.0f);
+
+    const int numChannels = juce::jmax(1, frame.numChannels);
+    const float channelWidth = bounds.getWidth() / (float)numChannels;
+    const float zeroDbY = dbToY(1.0f, bounds);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const auto area = bounds.withX(bounds.getX() + channel * channelWidth).withWidth(channelWidth).reduced(1.0f, 0.0f);
+
+        // RMS as the solid body, peak as a lighter bar behind it
+        const float peakY = dbToY(frame.peak[channel], area);
+        g.setColour(juce::Colour(0xff00ff88).withAlpha(0.35f));
+        g.fillRect(area.withTop(peakY));
+
+        const float rmsY = dbToY(frame.rms[channel], area);
+        g.setColour(juce::Colour(0xff00ff88));
+        g.fillRect(area.withTop(rmsY));
+
+        // Anything above 0 dBFS in red
+        if (peakY < zeroDbY)
+        {
+            g.setColour(juce::Colours::red.withAlpha(0.8f));
+            g.fillRect(area.withTop(peakY).withBottom(zeroDbY));
+        }
+
+        if (frame.peakHold[channel] > 0.0f)
+        {
+            const float holdY = dbToY(frame.peakHold[channel], area);
+            g.setColour(frame.peakHold[channel] >= 1.0f ? juce::Colours::red : juce::Colours::white);
+            g.fillRect(area.getX(), holdY - 1.0f, area.getWidth(), 2.0f);
+        }
+    }
+
+    // 0 dB tick
+    g.setColour(juce::Colours::white.withAlpha(0.4f));
+    g.drawHorizontalLine(juce::roundToInt(zeroDbY), bounds.getX(), bounds.getRight());
+}
+
+// ============ SpectrumDisplay Implementation ============
+SpectrumDisplay::SpectrumDisplay(SignalAnalyser& a) : analyser(a)
+{
+    jassert(analyser.hasSpectrum());
+    analyser.addChangeListener(this);
+    analyser.readFrame(frame);
+    setOpaque(true);
+}
+
+SpectrumDisplay::~SpectrumDisplay()
+{
+    analyser.removeChangeListener(this);
+}
+
+void SpectrumDisplay::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    analyser.readFrame(frame);
+    repaint();
+}
+
+void SpectrumDisplay::paint(juce::Graphics& g)
+{
+    const auto bounds = getLocalBounds().toFloat();
+    g.fillAll(juce::Colour(0xff0a0a0a));
+
+    const float nyquist = (float)frame.sampleRate * 0.5f;
+    const float binWidth = (float)frame.sampleRate / (float)SignalAnalyser::fftSize;
+
+    if (nyquist <= minFrequency || bounds.getWidth() < 2.0f)
+        return;
+
+    const float logRange = std::log(nyquist / minFrequency);
+
+    // Octave grid lines
+    g.setColour(juce::Colours::white.withAlpha(0.08f));
+    for (float frequency = 40.0f; frequency < nyquist; frequency *= 2.0f)
+        g.drawVerticalLine(juce::roundToInt(bounds.getX() + bounds.getWidth() * std::log(frequency / minFrequency) / logRange),
+            bounds.getY(), bounds.getBottom());
+
+    // One point per pixel column, taking the loudest bin under it so narrow peaks stay visible
+    spectrumPath.clear();
+    spectrumPath.startNewSubPath(bounds.getX(), bounds.getBottom());
+
+    const int numColumns = (int)bounds.getWidth();
+    auto columnToBin = [&](int column)
+        {
+            return (int)(minFrequency * std::exp(logRange * (float)column / (float)numColumns) / binWidth);
+        };
+
+    for (int column = 0; column < numColumns; ++column)
+    {
+        const int firstBin = juce::jlimit(1, SignalAnalyser::numSpectrumBins - 1, columnToBin(column));
+        const int endBin = juce::jlimit(firstBin + 1, SignalAnalyser::numSpectrumBins, columnToBin(column + 1));
+
+        float db = SignalAnalyser::floorDb;
+        for (int bin = firstBin; bin < endBin; ++bin)
+            db = juce::jmax(db, frame.spectrumDb[(size_t)bin]);
+
+        const float y = juce::jmap(db, SignalAnalyser::floorDb, spectrumTopDb, bounds.getBottom(), bounds.getY());
+        spectrumPath.lineTo(bounds.getX() + (float)column, juce::jlimit(bounds.getY(), bounds.getBottom(), y));
+    }
+
+    spectrumPath.lineTo(bounds.getRight(), bounds.getBottom());
+    spectrumPath.closeSubPath();
+
+    g.setGradientFill(juce::ColourGradient(juce::Colour(0xff00d4ff).withAlpha(0.6f), 0.0f, bounds.getY(),
+        juce::Colour(0xff00d4ff).withAlpha(0.1f), 0.0f, bounds.getBottom(), false));
+    g.fillPath(spectrumPath);
+
+    g.setColour(juce::Colour(0xff00d4ff));
+    g.strokePath(spectrumPath, juce::PathStrokeType(1.0f));
+}
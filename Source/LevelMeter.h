@@ -0,0 +1,52 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SignalAnalyser.h"
+
+// ============ Level Meter ============
+// Vertical peak/RMS bars per channel with a peak-hold line and a clip light.
+// It only draws the frames its analyser publishes: nothing is measured here,
+// and it repaints only when a new frame arrives. Click to clear the clip light.
+class LevelMeter : public juce::Component,
+    private juce::ChangeListener
+{
+public:
+    explicit LevelMeter(SignalAnalyser& analyser);
+    ~LevelMeter() override;
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+
+    static constexpr float minDb = -60.0f;
+    static constexpr float maxDb = 3.0f;
+
+private:
+    SignalAnalyser& analyser;
+    SignalAnalyser::Frame frame;
+
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+    float dbToY(float gain, juce::Rectangle<float> area) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeter)
+};
+
+// ============ Spectrum Display ============
+// The analyser's spectrum on a log frequency axis, 20 Hz to Nyquist, drawn
+// from published frames only, like the level meter.
+class SpectrumDisplay : public juce::Component,
+    private juce::ChangeListener
+{
+public:
+    explicit SpectrumDisplay(SignalAnalyser& analyser);
+    ~SpectrumDisplay() override;
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    SignalAnalyser& analyser;
+    SignalAnalyser::Frame frame;
+    juce::Path spectrumPath;
+
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumDisplay)
+};
@@ -0,0 +1,178 @@
+#include "LoopingAudioSource.h"
+
+LoopingAudioSource::LoopingAudioSource(DeckReadAheadSource& source) : input(source)
+{
+}
+
+LoopingAudioSource::~LoopingAudioSource()
+{
+}
+
+void LoopingAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // The input keeps the preroll request across a prepare and fills it again
+    input.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void LoopingAudioSource::releaseResources()
+{
+    input.releaseResources();
+}
+
+void LoopingAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto blockStart = juce::Time::getHighResolutionTicks();
+    juce::int64 inputTicks = 0;
+
+    auto position = playPosition.load();
+    applyPendingSeek(position);
+
+    int done = 0;
+
+    while (done < bufferToFill.numSamples)
+    {
+        if (loopActive && position >= loopEnd)
+            wrapToLoopStart(position);
+
+        int toRead = bufferToFill.numSamples - done;
+
+        if (loopActive)
+            toRead = (int)juce::jmin((juce::int64)toRead, loopEnd - position);
+
+        const auto readStart = juce::Time::getHighResolutionTicks();
+
+        if (servingPreroll && position < prerollEnd)
+        {
+            toRead = (int)juce::jmin((juce::int64)toRead, prerollEnd - position);
+            juce::AudioSourceChannelInfo part(bufferToFill.buffer, bufferToFill.startSample + done, toRead);
+
+            if (!input.readPreroll(position, part))
+            {
+                // The preroll changed under us; fall back to reading the ring from here
+                servingPreroll = false;
+                input.setNextReadPosition(position);
+                input.getNextAudioBlock(part);
+            }
+        }
+        else
+        {
+            servingPreroll = false;
+            input.getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer,
+                bufferToFill.startSample + done, toRead));
+        }
+
+        inputTicks += juce::Time::getHighResolutionTicks() - readStart;
+        position += toRead;
+        done += toRead;
+    }
+
+    playPosition = position;
+
+    if (stageTicks != nullptr)
+    {
+        stageTicks->decode += inputTicks;
+        stageTicks->loop += juce::Time::getHighResolutionTicks() - blockStart - inputTicks;
+    }
+}
+
+void LoopingAudioSource::applyPendingSeek(juce::int64& position)
+{
+    const auto seek = pendingSeek.exchange(-1);
+
+    if (seek >= 0)
+    {
+        position = seek;
+        servingPreroll = false;
+        input.setNextReadPosition(seek);
+    }
+}
+
+void LoopingAudioSource::wrapToLoopStart(juce::int64& position)
+{
+    position = loopStart;
+    ++wrapCount;
+
+    const int prerollLength = input.getPrerollLength(loopStart);
+
+    if (prerollLength > 0)
+    {
+        // Play the loop start from memory while the ring refills from where the preroll ends
+        servingPreroll = true;
+        prerollEnd = juce::jmin(loopStart + prerollLength, loopEnd);
+        input.setNextReadPosition(prerollEnd);
+    }
+    else
+    {
+        servingPreroll = false;
+        input.setNextReadPosition(loopStart);
+    }
+}
+
+void LoopingAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    newPosition = juce::jmax((juce::int64)0, newPosition);
+
+    // The ring starts refilling at the read-ahead thread's next poll; the audio thread moves its own play head next block
+    input.setNextReadPosition(newPosition);
+    pendingSeek = newPosition;
+}
+
+juce::int64 LoopingAudioSource::getNextReadPosition() const
+{
+    const auto seek = pendingSeek.load();
+    return seek >= 0 ? seek : playPosition.load();
+}
+
+juce::int64 LoopingAudioSource::getTotalLength() const
+{
+    return input.getTotalLength();
+}
+
+bool LoopingAudioSource::isLooping() const
+{
+    return loopEnabled.load();
+}
+
+void LoopingAudioSource::setLoopRegion(juce::int64 startSample, juce::int64 endSample)
+{
+    if (endSample <= startSample)
+    {
+        clearLoopRegion();
+        return;
+    }
+
+    loopStart = startSample;
+    loopEnd = endSample;
+    loopActive = true;
+    loopEnabled = true;
+
+    // A preroll of the old loop start, or one running past the new end, can't be played from any more
+    const auto position = playPosition.load();
+
+    if (servingPreroll && (prerollEnd > loopEnd || position < loopStart))
+    {
+        servingPreroll = false;
+        input.setNextReadPosition(position);
+    }
+}
+
+void LoopingAudioSource::clearLoopRegion()
+{
+    loopActive = false;
+    loopEnabled = false;
+
+    if (servingPreroll)
+    {
+        servingPreroll = false;
+        input.setNextReadPosition(playPosition.load());
+    }
+}
+
+void LoopingAudioSource::requestPreroll(juce::int64 startSample, juce::int64 endSample)
+{
+    if (endSample > startSample)
+        input.setPrerollRegion(startSample, (int)juce::jmin(endSample - startSample,
+            (juce::int64)DeckReadAheadSource::maxPrerollSamples));
+    else
+        input.setPrerollRegion(-1, 0);
+}
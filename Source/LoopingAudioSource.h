@@ -0,0 +1,59 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DeckReadAheadSource.h"
+#include "AudioCallbackStats.h"
+
+// ============ Looping Audio Source ============
+// Sits between the transport and the read-ahead buffer and wraps at the exact loop
+// end sample. The loop start is kept decoded in the read-ahead preroll, so a wrap
+// plays from memory while the ring refills behind it instead of seeking.
+class LoopingAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit LoopingAudioSource(DeckReadAheadSource& input);
+    ~LoopingAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // Safe from any thread; the audio thread picks the change up at its next block
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    // Audio thread, between blocks (PlayerAudio calls these from its command drain): loop
+    // [startSample, endSample) or pass a non-positive length to stop looping. Nothing blocks.
+    void setLoopRegion(juce::int64 startSample, juce::int64 endSample);
+    void clearLoopRegion();
+    juce::uint32 getWrapCount() const { return wrapCount.load(); }
+
+    // Message thread, alongside the command: has the read-ahead thread keep the loop start
+    // decoded so the wrap plays from memory. An empty region drops it.
+    void requestPreroll(juce::int64 startSample, juce::int64 endSample);
+
+    // Before the source is played: where to add the time spent here and in the input; nullptr for nowhere
+    void setStageTicks(DeckStageTicks* ticks) { stageTicks = ticks; }
+
+private:
+    DeckReadAheadSource& input;
+
+    std::atomic<bool> loopEnabled{ false };
+    std::atomic<juce::int64> pendingSeek{ -1 };
+
+    // Audio thread state
+    juce::int64 loopStart = 0;
+    juce::int64 loopEnd = 0;
+    bool loopActive = false;
+    bool servingPreroll = false;
+    juce::int64 prerollEnd = 0;
+    std::atomic<juce::int64> playPosition{ 0 };
+    std::atomic<juce::uint32> wrapCount{ 0 };
+    DeckStageTicks* stageTicks = nullptr;
+
+    void applyPendingSeek(juce::int64& position);
+    void wrapToLoopStart(juce::int64& position);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopingAudioSource)
+};
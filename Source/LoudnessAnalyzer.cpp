@@ -0,0 +1,415 @@
+#include "LoudnessAnalyzer.h"
+#include "MixKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #include <emmintrin.h>
+ #define LOUDNESS_USE_SSE2 1
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define LOUDNESS_USE_NEON 1
+#endif
+
+namespace
+{
+    constexpr double absoluteGateLufs = -70.0;
+    constexpr double integratedRelativeGate = -10.0;
+    constexpr double rangeRelativeGate = -20.0;
+    constexpr int segmentsPerBlock = 4;         // 400 ms momentary blocks, 100 ms apart
+    constexpr int segmentsPerShortTerm = 30;    // 3 s short-term windows, 100 ms apart
+
+    double powerToLufs(double power)
+    {
+        return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : -std::numeric_limits<double>::infinity();
+    }
+
+    double lufsToPower(double lufs)
+    {
+        return std::pow(10.0, (lufs + 0.691) / 10.0);
+    }
+
+    // Mean power of the windows at or above the gate, 0 if none are
+    double gatedMean(const std::vector<double>& powers, double gatePower)
+    {
+        double sum = 0.0;
+        int count = 0;
+
+        for (auto power : powers)
+        {
+            if (power >= gatePower)
+            {
+                sum += power;
+                ++count;
+            }
+        }
+
+        return count > 0 ? sum / count : 0.0;
+    }
+
+    // Window powers over a sliding run of segments
+    std::vector<double> slidingPowers(const std::vector<double>& segments, int windowLength)
+    {
+        std::vector<double> powers;
+        const int numSegments = (int)segments.size();
+
+        // Files shorter than one window still get one, averaged over what there is
+        if (numSegments < windowLength)
+        {
+            if (numSegments > 0)
+            {
+                double sum = 0.0;
+                for (auto power : segments)
+                    sum += power;
+
+                powers.push_back(sum / numSegments);
+            }
+
+            return powers;
+        }
+
+        double sum = 0.0;
+        for (int i = 0; i < numSegments; ++i)
+        {
+            sum += segments[(size_t)i];
+
+            if (i >= windowLength)
+                sum -= segments[(size_t)(i - windowLength)];
+
+            if (i >= windowLength - 1)
+                powers.push_back(juce::jmax(0.0, sum) / windowLength);
+        }
+
+        return powers;
+    }
+}
+
+// ============ LoudnessInfo Implementation ============
+double LoudnessInfo::getNormalisationGainDb(double targetLufs, double peakCeilingDb) const
+{
+    // Silence (or nothing measured) is left alone
+    if (integratedLufs <= absoluteGateLufs)
+        return 0.0;
+
+    double gain = targetLufs - integratedLufs;
+
+    if (truePeakDb + gain > peakCeilingDb)
+        gain = peakCeilingDb - truePeakDb;
+
+    return gain;
+}
+
+// ============ LoudnessMeter Implementation ============
+LoudnessMeter::LoudnessMeter(double rate, int channels)
+    : sampleRate(rate),
+      numChannels(juce::jmax(1, channels)),
+      filterStates((size_t)numChannels),
+      channelWeights((size_t)numChannels, 1.0),
+      segmentSums((size_t)numChannels, 0.0),
+      peakHistories((size_t)numChannels, std::vector<float>(2 * truePeakTaps, 0.0f))
+{
+    // K-weighting for any sample rate: a high shelf for the head, then the RLB high-pass
+    {
+        const double f0 = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+
+        stages[0].b0 = (vh + vb * k / q + k * k) / a0;
+        stages[0].b1 = 2.0 * (k * k - vh) / a0;
+        stages[0].b2 = (vh - vb * k / q + k * k) / a0;
+        stages[0].a1 = 2.0 * (k * k - 1.0) / a0;
+        stages[0].a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+
+        stages[1].b0 = 1.0;
+        stages[1].b1 = -2.0;
+        stages[1].b2 = 1.0;
+        stages[1].a1 = 2.0 * (k * k - 1.0) / a0;
+        stages[1].a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // 5.1 order (L R C LFE Ls Rs): the LFE is left out and the surrounds count +1.5 dB
+    if (numChannels >= 5)
+    {
+        channelWeights[3] = 0.0;
+        channelWeights[4] = 1.41;
+
+        if (numChannels >= 6)
+            channelWeights[5] = 1.41;
+    }
+
+    segmentLength = juce::jmax(1, juce::roundToInt(sampleRate * 0.1));
+
+    // Rates of 176.4 kHz and up are already fine enough for the true peak
+    oversampleForPeak = sampleRate < 176400.0;
+
+    // 48-tap windowed-sinc interpolator split into four phases; taps are stored
+    // oldest-first so each phase is a plain dot product with the history window
+    const int totalTaps = truePeakPhases * truePeakTaps;
+    const double centre = (totalTaps - 1) * 0.5;
+
+    for (int phase = 0; phase < truePeakPhases; ++phase)
+    {
+        double sum = 0.0;
+
+        for (int tap = 0; tap < truePeakTaps; ++tap)
+        {
+            const int n = phase + truePeakPhases * (truePeakTaps - 1 - tap);
+            const double x = ((double)n - centre) / truePeakPhases;
+            const double sinc = std::abs(x) < 1.0e-9 ? 1.0
+                : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+            const double window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * (n + 0.5) / totalTaps);
+
+            truePeakCoefficients[phase][tap] = (float)(sinc * window);
+            sum += sinc * window;
+        }
+
+        for (auto& coefficient : truePeakCoefficients[phase])
+            coefficient = (float)(coefficient / sum);
+    }
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const juce::ScopedNoDenormals noDenormals;
+    const int channelsToRead = juce::jmin(numChannels, buffer.getNumChannels());
+
+    for (int channel = 0; channel < channelsToRead; ++channel)
+        measureTruePeak(buffer.getReadPointer(channel), channel, numSamples);
+
+    // Every channel's history advanced by the same amount
+    peakHistoryPos = (peakHistoryPos + numSamples) % truePeakTaps;
+
+    // Filter up to each 100 ms segment boundary, then close the segment
+    for (int done = 0; done < numSamples;)
+    {
+        const int toDo = juce::jmin(numSamples - done, segmentLength - segmentFill);
+        int channel = 0;
+
+        for (; channel + 1 < channelsToRead; channel += 2)
+            filterPair(buffer.getReadPointer(channel, done), buffer.getReadPointer(channel + 1, done), channel, toDo);
+
+        if (channel < channelsToRead)
+            filterSingle(buffer.getReadPointer(channel, done), channel, toDo);
+
+        done += toDo;
+        segmentFill += toDo;
+
+        if (segmentFill == segmentLength)
+            finishSegment();
+    }
+}
+
+void LoudnessMeter::filterPair(const float* left, const float* right, int channel, int numSamples)
+{
+    auto& stateL = filterStates[(size_t)channel];
+    auto& stateR = filterStates[(size_t)channel + 1];
+
+#if LOUDNESS_USE_SSE2
+    // Both channels of the pair ride in one register, lane 0 left and lane 1 right
+    __m128d b0[2], b1[2], b2[2], a1[2], a2[2], z1[2], z2[2];
+
+    for (int s = 0; s < 2; ++s)
+    {
+        b0[s] = _mm_set1_pd(stages[s].b0);
+        b1[s] = _mm_set1_pd(stages[s].b1);
+        b2[s] = _mm_set1_pd(stages[s].b2);
+        a1[s] = _mm_set1_pd(stages[s].a1);
+        a2[s] = _mm_set1_pd(stages[s].a2);
+        z1[s] = _mm_set_pd(stateR.z1[s], stateL.z1[s]);
+        z2[s] = _mm_set_pd(stateR.z2[s], stateL.z2[s]);
+    }
+
+    __m128d sum = _mm_setzero_pd();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        __m128d x = _mm_set_pd((double)right[i], (double)left[i]);
+
+        for (int s = 0; s < 2; ++s)
+        {
+            const __m128d y = _mm_add_pd(_mm_mul_pd(b0[s], x), z1[s]);
+            z1[s] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1[s], x), _mm_mul_pd(a1[s], y)), z2[s]);
+            z2[s] = _mm_sub_pd(_mm_mul_pd(b2[s], x), _mm_mul_pd(a2[s], y));
+            x = y;
+        }
+
+        sum = _mm_add_pd(sum, _mm_mul_pd(x, x));
+    }
+
+    double sums[2], z1Out[2], z2Out[2];
+    _mm_storeu_pd(sums, sum);
+
+    for (int s = 0; s < 2; ++s)
+    {
+        _mm_storeu_pd(z1Out, z1[s]);
+        _mm_storeu_pd(z2Out, z2[s]);
+        stateL.z1[s] = z1Out[0];
+        stateR.z1[s] = z1Out[1];
+        stateL.z2[s] = z2Out[0];
+        stateR.z2[s] = z2Out[1];
+    }
+
+    segmentSums[(size_t)channel] += sums[0];
+    segmentSums[(size_t)channel + 1] += sums[1];
+#elif LOUDNESS_USE_NEON
+    float64x2_t b0[2], b1[2], b2[2], a1[2], a2[2], z1[2], z2[2];
+
+    for (int s = 0; s < 2; ++s)
+    {
+        const double z1In[2] = { stateL.z1[s], stateR.z1[s] };
+        const double z2In[2] = { stateL.z2[s], stateR.z2[s] };
+        b0[s] = vdupq_n_f64(stages[s].b0);
+        b1[s] = vdupq_n_f64(stages[s].b1);
+        b2[s] = vdupq_n_f64(stages[s].b2);
+        a1[s] = vdupq_n_f64(stages[s].a1);
+        a2[s] = vdupq_n_f64(stages[s].a2);
+        z1[s] = vld1q_f64(z1In);
+        z2[s] = vld1q_f64(z2In);
+    }
+
+    float64x2_t sum = vdupq_n_f64(0.0);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double in[2] = { (double)left[i], (double)right[i] };
+        float64x2_t x = vld1q_f64(in);
+
+        for (int s = 0; s < 2; ++s)
+        {
+            const float64x2_t y = vfmaq_f64(z1[s], b0[s], x);
+            z1[s] = vaddq_f64(vfmsq_f64(vmulq_f64(b1[s], x), a1[s], y), z2[s]);
+            z2[s] = vfmsq_f64(vmulq_f64(b2[s], x), a2[s], y);
+            x = y;
+        }
+
+        sum = vfmaq_f64(sum, x, x);
+    }
+
+    for (int s = 0; s < 2; ++s)
+    {
+        stateL.z1[s] = vgetq_lane_f64(z1[s], 0);
+        stateR.z1[s] = vgetq_lane_f64(z1[s], 1);
+        stateL.z2[s] = vgetq_lane_f64(z2[s], 0);
+        stateR.z2[s] = vgetq_lane_f64(z2[s], 1);
+    }
+
+    segmentSums[(size_t)channel] += vgetq_lane_f64(sum, 0);
+    segmentSums[(size_t)channel + 1] += vgetq_lane_f64(sum, 1);
+#else
+    filterSingle(left, channel, numSamples);
+    filterSingle(right, channel + 1, numSamples);
+#endif
+}
+
+void LoudnessMeter::filterSingle(const float* samples, int channel, int numSamples)
+{
+    auto& state = filterStates[(size_t)channel];
+    double sum = 0.0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double x = samples[i];
+
+        for (int s = 0; s < 2; ++s)
+        {
+            const auto& stage = stages[s];
+            const double y = stage.b0 * x + state.z1[s];
+            state.z1[s] = stage.b1 * x - stage.a1 * y + state.z2[s];
+            state.z2[s] = stage.b2 * x - stage.a2 * y;
+            x = y;
+        }
+
+        sum += x * x;
+    }
+
+    segmentSums[(size_t)channel] += sum;
+}
+
+void LoudnessMeter::measureTruePeak(const float* samples, int channel, int numSamples)
+{
+    const auto range = juce::FloatVectorOperations::findMinAndMax(samples, numSamples);
+    peak = juce::jmax(peak, std::abs(range.getStart()), std::abs(range.getEnd()));
+
+    if (!oversampleForPeak)
+        return;
+
+    auto& history = peakHistories[(size_t)channel];
+    int pos = peakHistoryPos;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        pos = (pos + 1) % truePeakTaps;
+        history[(size_t)pos] = history[(size_t)(pos + truePeakTaps)] = samples[i];
+
+        const float* window = history.data() + pos + 1;
+
+        for (int phase = 0; phase < truePeakPhases; ++phase)
+            peak = juce::jmax(peak, std::abs(MixKernel::dotProduct(window, truePeakCoefficients[phase], truePeakTaps)));
+    }
+}
+
+void LoudnessMeter::finishSegment()
+{
+    double power = 0.0;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        power += channelWeights[(size_t)channel] * segmentSums[(size_t)channel] / segmentFill;
+        segmentSums[(size_t)channel] = 0.0;
+    }
+
+    segmentPowers.push_back(power);
+    segmentFill = 0;
+}
+
+LoudnessInfo LoudnessMeter::getResult() const
+{
+    LoudnessInfo info;
+    info.truePeakDb = peak > 0.0f ? 20.0 * std::log10((double)peak) : -100.0;
+
+    // Integrated: absolute gate, then a relative gate 10 LU under the loudness of what passed
+    const auto blockPowers = slidingPowers(segmentPowers, segmentsPerBlock);
+    const double absoluteGate = lufsToPower(absoluteGateLufs);
+    const double ungated = gatedMean(blockPowers, absoluteGate);
+
+    if (ungated > 0.0)
+    {
+        const double relativeGate = lufsToPower(powerToLufs(ungated) + integratedRelativeGate);
+        info.integratedLufs = juce::jmax(absoluteGateLufs, powerToLufs(gatedMean(blockPowers, juce::jmax(absoluteGate, relativeGate))));
+    }
+
+    // Loudness range: 10th to 95th percentile of gated short-term loudness
+    const auto shortTermPowers = slidingPowers(segmentPowers, segmentsPerShortTerm);
+    const double shortTermUngated = gatedMean(shortTermPowers, absoluteGate);
+
+    if (shortTermUngated > 0.0)
+    {
+        const double gate = juce::jmax(absoluteGate, lufsToPower(powerToLufs(shortTermUngated) + rangeRelativeGate));
+        std::vector<double> levels;
+
+        for (auto power : shortTermPowers)
+            if (power >= gate)
+                levels.push_back(powerToLufs(power));
+
+        if (levels.size() > 1)
+        {
+            std::sort(levels.begin(), levels.end());
+            const auto last = (double)(levels.size() - 1);
+            info.loudnessRange = levels[(size_t)juce::roundToInt(last * 0.95)] - levels[(size_t)juce::roundToInt(last * 0.10)];
+        }
+    }
+
+    return info;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// ============ Loudness Info ============
+// EBU R128 / ITU-R BS.1770 measurements of one file
+struct LoudnessInfo
+{
+    double integratedLufs = -70.0;
+    double loudnessRange = 0.0;     // LU
+    double truePeakDb = -100.0;     // dBTP
+
+    // ReplayGain 2.0 reference level; the gain is held back so peaks stay under the ceiling
+    static constexpr double defaultTargetLufs = -18.0;
+    static constexpr double defaultPeakCeilingDb = -1.0;
+
+    double getNormalisationGainDb(double targetLufs = defaultTargetLufs,
+        double peakCeilingDb = defaultPeakCeilingDb) const;
+};
+
+// ============ Loudness Meter ============
+// Streaming BS.1770-4 measurement: K-weighting, gated 400 ms blocks for the
+// integrated loudness, 3 s short-term windows for the loudness range (EBU
+// Tech 3342), and a 4x oversampled true peak. Channel pairs are filtered
+// together in one SIMD register (SSE2 or NEON), with a scalar fallback.
+class LoudnessMeter
+{
+public:
+    LoudnessMeter(double sampleRate, int numChannels);
+
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples);
+    LoudnessInfo getResult() const;
+
+private:
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    // Transposed direct form II state of both K-weighting stages for one channel
+    struct FilterState
+    {
+        double z1[2] = { 0.0, 0.0 };
+        double z2[2] = { 0.0, 0.0 };
+    };
+
+    static constexpr int truePeakPhases = 4;
+    static constexpr int truePeakTaps = 12;
+
+    const double sampleRate;
+    const int numChannels;
+    Biquad stages[2];
+    std::vector<FilterState> filterStates;
+    std::vector<double> channelWeights;
+
+    // Weighted mean square of every 100 ms segment, and the one being filled
+    std::vector<double> segmentPowers;
+    std::vector<double> segmentSums;
+    int segmentLength = 0;
+    int segmentFill = 0;
+
+    // True-peak interpolator: a doubled history so each window is contiguous
+    float truePeakCoefficients[truePeakPhases][truePeakTaps];
+    std::vector<std::vector<float>> peakHistories;
+    int peakHistoryPos = 0;
+    bool oversampleForPeak = true;
+    float peak = 0.0f;
+
+    void filterPair(const float* left, const float* right, int channel, int numSamples);
+    void filterSingle(const float* samples, int channel, int numSamples);
+    void measureTruePeak(const float* samples, int channel, int numSamples);
+    void finishSegment();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter)
+};
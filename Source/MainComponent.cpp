@@ -1,28 +1,66 @@
 #include "MainComponent.h"
+#include "RealtimeAllocationCheck.h"
 
-MainComponent::MainComponent()
+MainComponent::MainComponent(int numberOfDecks)
+    : numDecks(juce::jlimit(1, DeckMixEngine::maxDecks, numberOfDecks))
 {
-    // Add players
-    addAndMakeVisible(player1);
+    // Add players; decks alternate between the A and B side of the crossfader
+    for (int i = 0; i < numDecks; ++i)
+    {
+        auto* player = players.add(new PlayerGUI());
+        addAndMakeVisible(player);
+
+        const auto side = numDecks == 1 ? DeckMixEngine::CrossfadeSide::thru
+            : (i % 2 == 0 ? DeckMixEngine::CrossfadeSide::a : DeckMixEngine::CrossfadeSide::b);
+        mixEngine.addDeck(player->getPlayerAudio(), side);
+    }
 
-    if (useDualPlayer)
+    // Master meter and spectrum, plus a meter beside each deck's fader when there's a mixer
+    mixEngine.setMasterAnalyser(&masterAnalyser);
+    addAndMakeVisible(masterMeter);
+    addAndMakeVisible(spectrumDisplay);
+
+    if (numDecks > 1)
     {
-        addAndMakeVisible(player2);
+        for (int i = 0; i < numDecks; ++i)
+        {
+            auto* analyser = deckAnalysers.add(new SignalAnalyser(false));
+            mixEngine.setDeckAnalyser(i, analyser);
+            addAndMakeVisible(deckMeters.add(new LevelMeter(*analyser)));
+        }
+    }
 
+    // Export button, in the mixer header or under a single player
+    exportButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
+    exportButton.onClick = [this]()
+        {
+            if (mixRenderer.isRendering())
+                mixRenderer.cancel();
+            else
+                chooseExportFile();
+        };
+    addAndMakeVisible(exportButton);
+    mixRenderer.onFinished = [this](const juce::Result& result) { exportFinished(result); };
+
+    if (numDecks > 1)
+    {
         // Mixer sliders
-        mixerSlider1.setRange(0.0, 1.0, 0.01);
-        mixerSlider1.setValue(0.7);
-        mixerSlider1.setSliderStyle(Slider::LinearVertical);
-        mixerSlider1.setTextBoxStyle(Slider::TextBoxBelow, false, 50, 20);
-        mixerSlider1.addListener(this);
-        addAndMakeVisible(mixerSlider1);
-
-        mixerSlider2.setRange(0.0, 1.0, 0.01);
-        mixerSlider2.setValue(0.7);
-        mixerSlider2.setSliderStyle(Slider::LinearVertical);
-        mixerSlider2.setTextBoxStyle(Slider::TextBoxBelow, false, 50, 20);
-        mixerSlider2.addListener(this);
-        addAndMakeVisible(mixerSlider2);
+        for (int i = 0; i < numDecks; ++i)
+        {
+            auto* slider = levelSliders.add(new juce::Slider());
+            slider->setRange(0.0, 1.0, 0.01);
+            slider->setValue(0.7);
+            slider->setSliderStyle(Slider::LinearVertical);
+            slider->setTextBoxStyle(Slider::TextBoxBelow, false, 50, 20);
+            slider->addListener(this);
+            addAndMakeVisible(slider);
+
+            auto* label = playerLabels.add(new juce::Label());
+            label->setText("Player " + juce::String(i + 1), dontSendNotification);
+            label->setColour(Label::textColourId, Colours::white);
+            label->setJustificationType(Justification::centred);
+            addAndMakeVisible(label);
+        }
 
         // Crossfade slider
         crossfadeSlider.setRange(0.0, 1.0, 0.01);
@@ -39,20 +77,19 @@ MainComponent::MainComponent()
         mixerLabel.setJustificationType(Justification::centred);
         addAndMakeVisible(mixerLabel);
 
-        player1Label.setText("Player 1", dontSendNotification);
-        player1Label.setColour(Label::textColourId, Colours::white);
-        player1Label.setJustificationType(Justification::centred);
-        addAndMakeVisible(player1Label);
-
-        player2Label.setText("Player 2", dontSendNotification);
-        player2Label.setColour(Label::textColourId, Colours::white);
-        player2Label.setJustificationType(Justification::centred);
-        addAndMakeVisible(player2Label);
-
-        crossfadeLabel.setText("Crossfade: Player 1 ← → Player 2", dontSendNotification);
+        crossfadeLabel.setText(numDecks == 2 ? "Crossfade: Player 1 ← → Player 2"
+                                             : "Crossfade: Odd players ← → Even players", dontSendNotification);
         crossfadeLabel.setColour(Label::textColourId, Colours::white);
         addAndMakeVisible(crossfadeLabel);
 
+        // Crossfader curve
+        crossfadeCurveBox.addItem("Linear", (int)CrossfadeCurve::linear + 1);
+        crossfadeCurveBox.addItem("Equal Power", (int)CrossfadeCurve::equalPower + 1);
+        crossfadeCurveBox.addItem("Cut", (int)CrossfadeCurve::cut + 1);
+        crossfadeCurveBox.setSelectedId((int)CrossfadeCurve::linear + 1, dontSendNotification);
+        crossfadeCurveBox.onChange = [this]() { publishMixerParameters(); };
+        addAndMakeVisible(crossfadeCurveBox);
+
         // Link button
         linkButton.onClick = [this]() {
             linked = !linked;
@@ -63,18 +100,66 @@ MainComponent::MainComponent()
         linkButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
         addAndMakeVisible(linkButton);
 
-        setSize(900, 1200);
+        // Sync button: every other deck follows the leader's tempo and beats
+        syncButton.onClick = [this]() { setTempoSync(!tempoSynced); };
+        syncButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
+        addAndMakeVisible(syncButton);
+
+        publishMixerParameters();
+
+        const int rows = (numDecks + getNumDeckColumns() - 1) / getNumDeckColumns();
+        setSize(900 * getNumDeckColumns(), 600 * rows);
     }
     else
     {
-        setSize(750, 600);
+        mixEngine.setDeckLevel(0, 1.0f);
+        setSize(750, 670);
     }
 
+    // Timing overlay over the top left corner, hidden until asked for
+    mixEngine.setCallbackStats(&callbackStats);
+    statsOverlay.describeDeck = [this](int deckIndex)
+        {
+            auto* player = players[deckIndex];
+            return player == nullptr ? juce::String()
+                : "underruns " + juce::String(player->getPlayerAudio().getUnderrunCount())
+                    + "   paint " + juce::String(player->getWaveformPaintMilliseconds(false), 2) + " ms"
+                    + " (full " + juce::String(player->getWaveformPaintMilliseconds(true), 2) + " ms)"
+                    + (fullWaveformRepaint ? "   full repaint" : "");
+        };
+    addChildComponent(statsOverlay);
+
+    // Shift-click switches the waveforms to full repaints and back, to compare paint times
+    statsButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
+    statsButton.onClick = [this]()
+        {
+            if (juce::ModifierKeys::currentModifiers.isShiftDown())
+            {
+                fullWaveformRepaint = !fullWaveformRepaint;
+
+                for (auto* player : players)
+                    player->setWaveformFullRepaint(fullWaveformRepaint);
+
+                return;
+            }
+
+            statsOverlay.setVisible(!statsOverlay.isVisible());
+            statsButton.setColour(TextButton::buttonColourId,
+                statsOverlay.isVisible() ? Colour(0xff00ff88) : Colour(0xff786fa6));
+        };
+    addAndMakeVisible(statsButton);
+
+    const auto statsLogFile = CallbackStatsLogger::getLogFileFromEnvironment();
+    if (statsLogFile != juce::File())
+        statsLogger = std::make_unique<CallbackStatsLogger>(callbackStats, deviceManager, statsLogFile, 10);
+
     setAudioChannels(0, 2);
 }
 
 MainComponent::~MainComponent()
 {
+    mixRenderer.cancel();
+    statsLogger.reset();
     shutdownAudio();
 }
 
@@ -84,149 +169,283 @@ void MainComponent::paint(juce::Graphics& g)
         Colour(0xff1a1a1a), 0, (float)getHeight(), false));
     g.fillAll();
 
-    if (useDualPlayer)
+    if (numDecks > 1)
     {
         // Mixer panel background
-        int mixerX = getWidth() / 2 - 150;
+        const int panelWidth = getMixerPanelWidth();
+        int mixerX = getWidth() / 2 - panelWidth / 2;
         int mixerY = getHeight() / 2 - 95;
         g.setColour(Colour(0xff16213e).withAlpha(0.8f));
-        g.fillRoundedRectangle((float)mixerX, (float)mixerY, 300, 180, 10);
+        g.fillRoundedRectangle((float)mixerX, (float)mixerY, (float)panelWidth, 260, 10);
 
-        // Divider line
+        // Divider lines between deck rows and columns
+        const int rows = (numDecks + getNumDeckColumns() - 1) / getNumDeckColumns();
         g.setColour(Colour(0xff00d4ff).withAlpha(0.3f));
-        g.drawLine(10, (float)(getHeight() / 2), (float)(getWidth() - 10), (float)(getHeight() / 2), 2);
+
+        for (int row = 1; row < rows; ++row)
+        {
+            const float y = (float)(getHeight() * row / rows);
+            g.drawLine(10, y, (float)(getWidth() - 10), y, 2);
+        }
+
+        if (getNumDeckColumns() > 1)
+            g.drawLine((float)(getWidth() / 2), 10, (float)(getWidth() / 2), (float)(getHeight() - 10), 2);
     }
 }
 
 void MainComponent::resized()
 {
-    if (useDualPlayer)
+    // Timing overlay, over whatever sits in the top left corner
+    statsOverlay.setBounds(10, 10, juce::jmin(getWidth() - 20, 560), statsOverlay.getIdealHeight(numDecks));
+
+    if (numDecks > 1)
     {
-        int halfHeight = getHeight() / 2;
+        const int columns = getNumDeckColumns();
+        const int rows = (numDecks + columns - 1) / columns;
+        const int columnWidth = getWidth() / columns;
+        const int rowHeight = getHeight() / rows;
 
-        // Player 1 on top
-        player1.setBounds(10, 10, getWidth() - 20, halfHeight - 15);
+        // Players in a grid, first deck top left
+        for (int i = 0; i < numDecks; ++i)
+        {
+            const int column = i % columns;
+            const int row = i / columns;
+            const int top = row == 0 ? 10 : 15;
 
-        // Player 2 on bottom
-        player2.setBounds(10, halfHeight + 15, getWidth() - 20, halfHeight - 25);
+            players[i]->setBounds(column * columnWidth + 10, row * rowHeight + top,
+                columnWidth - 20, rowHeight - top - 10);
+        }
 
         // Mixer controls in center
-        int mixerX = getWidth() / 2 - 150;
-        int mixerY = halfHeight - 85;
+        const int panelWidth = getMixerPanelWidth();
+        const int sliderSpacing = (panelWidth - 140) / (numDecks - 1);
+        int mixerX = getWidth() / 2 - panelWidth / 2;
+        int mixerY = getHeight() / 2 - 85;
+
+        mixerLabel.setBounds(mixerX, mixerY - 30, panelWidth, 30);
+
+        for (int i = 0; i < numDecks; ++i)
+        {
+            const int x = mixerX + 40 + i * sliderSpacing;
+            playerLabels[i]->setBounds(x - 10, mixerY, 80, 20);
+            levelSliders[i]->setBounds(x, mixerY + 25, 60, 100);
+            deckMeters[i]->setBounds(x + 60, mixerY + 25, 8, 78);
+        }
 
-        mixerLabel.setBounds(mixerX, mixerY - 30, 300, 30);
+        masterMeter.setBounds(mixerX + panelWidth - 22, mixerY + 25, 12, 100);
 
-        player1Label.setBounds(mixerX + 30, mixerY, 80, 20);
-        mixerSlider1.setBounds(mixerX + 40, mixerY + 25, 60, 100);
+        crossfadeLabel.setBounds(mixerX, mixerY + 135, panelWidth - 80, 20);
+        crossfadeSlider.setBounds(mixerX + 10, mixerY + 160, panelWidth - 90, 25);
 
-        player2Label.setBounds(mixerX + 190, mixerY, 80, 20);
-        mixerSlider2.setBounds(mixerX + 200, mixerY + 25, 60, 100);
+        spectrumDisplay.setBounds(mixerX + 10, mixerY + 192, panelWidth - 90, 50);
+        statsButton.setBounds(mixerX + panelWidth - 70, mixerY + 192, 60, 25);
 
-        crossfadeLabel.setBounds(mixerX, mixerY + 135, 240, 20);
-        crossfadeSlider.setBounds(mixerX + 10, mixerY + 160, 210, 25);
+        linkButton.setBounds(mixerX + panelWidth - 70, mixerY + 160, 60, 25);
+        syncButton.setBounds(mixerX + panelWidth - 70, mixerY + 131, 60, 25);
+        exportButton.setBounds(mixerX + 10, mixerY - 27, 100, 24);
 
-        linkButton.setBounds(mixerX + 230, mixerY + 160, 60, 25);
+        // Between the two faders, or tucked into the header when they fill the panel
+        if (numDecks == 2)
+            crossfadeCurveBox.setBounds(mixerX + 105, mixerY + 60, 90, 24);
+        else
+            crossfadeCurveBox.setBounds(mixerX + panelWidth - 100, mixerY - 27, 90, 24);
     }
     else
     {
         // Single player mode
-        player1.setBounds(getLocalBounds().reduced(10));
+        auto area = getLocalBounds().reduced(10);
+        auto buttonRow = area.removeFromBottom(24);
+        exportButton.setBounds(buttonRow.removeFromRight(120));
+        buttonRow.removeFromRight(6);
+        statsButton.setBounds(buttonRow.removeFromRight(60));
+        area.removeFromBottom(6);
+
+        auto meterArea = area.removeFromBottom(60);
+        masterMeter.setBounds(meterArea.removeFromRight(12));
+        meterArea.removeFromRight(6);
+        spectrumDisplay.setBounds(meterArea);
+        area.removeFromBottom(6);
+
+        players[0]->setBounds(area);
     }
 }
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    callbackStats.prepare(sampleRate, samplesPerBlockExpected, numDecks);
 
-    if (useDualPlayer)
-    {
-        player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    }
+    int numOutputChannels = 2;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        numOutputChannels = juce::jmax(1, device->getActiveOutputChannels().countNumberOfSetBits());
+
+    mixEngine.prepareToPlay(samplesPerBlockExpected, sampleRate, numOutputChannels);
+
+    masterAnalyser.prepare(sampleRate);
+    for (auto* analyser : deckAnalysers)
+        analyser->prepare(sampleRate);
+
+    // A block rendered now is heard after the one playing and the device's own delay
+    double outputLatency = 0.0;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        outputLatency = (device->getOutputLatencyInSamples() + samplesPerBlockExpected) / juce::jmax(1.0, sampleRate);
+
+    for (int i = 0; i < numDecks; ++i)
+        players[i]->getPlayerAudio().setOutputLatency(outputLatency);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    if (useDualPlayer)
-    {
-        // Clear buffer first
-        bufferToFill.clearActiveBufferRegion();
-
-        // Create temp buffers for each player
-        juce::AudioBuffer<float> tempBuffer1(bufferToFill.buffer->getNumChannels(),
-            bufferToFill.numSamples);
-        juce::AudioBuffer<float> tempBuffer2(bufferToFill.buffer->getNumChannels(),
-            bufferToFill.numSamples);
+    const ScopedRealtimeAllocationCheck allocationCheck;
+    const auto callbackStart = juce::Time::getHighResolutionTicks();
 
-        juce::AudioSourceChannelInfo tempInfo1(&tempBuffer1, 0, bufferToFill.numSamples);
-        juce::AudioSourceChannelInfo tempInfo2(&tempBuffer2, 0, bufferToFill.numSamples);
+    mixEngine.getNextAudioBlock(bufferToFill);
 
-        // Get audio from both players
-        player1.getNextAudioBlock(tempInfo1);
-        player2.getNextAudioBlock(tempInfo2);
+    callbackStats.addCallback(callbackStart, juce::Time::getHighResolutionTicks(), bufferToFill.numSamples);
+}
 
-        // Mix with crossfade
-        float crossfade = (float)crossfadeSlider.getValue();
-        float gain1 = (1.0f - crossfade) * (float)mixerSlider1.getValue();
-        float gain2 = crossfade * (float)mixerSlider2.getValue();
+void MainComponent::releaseResources()
+{
+    mixEngine.releaseResources();
+}
 
-        // Apply gains and mix
-        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
-        {
-            auto* outputData = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
-            auto* input1Data = tempBuffer1.getReadPointer(channel);
-            auto* input2Data = tempBuffer2.getReadPointer(channel);
+void MainComponent::sliderValueChanged(juce::Slider* slider)
+{
+    if (numDecks < 2) return;
 
-            for (int sample = 0; sample < bufferToFill.numSamples; ++sample)
-            {
-                outputData[sample] = (input1Data[sample] * gain1) + (input2Data[sample] * gain2);
-            }
-        }
-    }
-    else
+    if (slider == &crossfadeSlider && linked)
     {
-        // Single player mode
-        player1.getNextAudioBlock(bufferToFill);
+        // Linked mode: inverse relationship between the A and B decks
+        float value = (float)slider->getValue();
+
+        for (int i = 0; i < numDecks; ++i)
+            levelSliders[i]->setValue(i % 2 == 0 ? 1.0 - value : value, dontSendNotification);
     }
+
+    publishMixerParameters();
 }
 
-void MainComponent::releaseResources()
+void MainComponent::publishMixerParameters()
 {
-    player1.releaseResources();
+    for (int i = 0; i < levelSliders.size(); ++i)
+        mixEngine.setDeckLevel(i, (float)levelSliders[i]->getValue());
 
-    if (useDualPlayer)
-    {
-        player2.releaseResources();
-    }
+    mixEngine.setCrossfade((float)crossfadeSlider.getValue());
+    mixEngine.setCrossfadeCurve((CrossfadeCurve)(crossfadeCurveBox.getSelectedId() - 1));
 }
 
-void MainComponent::sliderValueChanged(juce::Slider* slider)
+void MainComponent::setTempoSync(bool shouldSync)
 {
-    if (!useDualPlayer) return;
+    tempoSynced = shouldSync;
 
-    if (slider == &mixerSlider1)
+    // The leader is the deck already playing, so it's the others that move
+    int leader = 0;
+    for (int i = 0; i < numDecks; ++i)
     {
-        float gain = (float)slider->getValue();
-        player1.setGain(gain * (1.0f - (float)crossfadeSlider.getValue()));
+        if (players[i]->getPlayerAudio().isPlaying())
+        {
+            leader = i;
+            break;
+        }
     }
 
-    if (slider == &mixerSlider2)
-    {
-        float gain = (float)slider->getValue();
-        player2.setGain(gain * (float)crossfadeSlider.getValue());
-    }
+    mixEngine.setSyncLeader(tempoSynced ? leader : -1);
 
-    if (slider == &crossfadeSlider)
-    {
-        if (linked)
+    for (int i = 0; i < numDecks; ++i)
+        mixEngine.setTempoSync(i, tempoSynced && i != leader);
+
+    syncButton.setButtonText(tempoSynced ? "Synced" : "Sync");
+    syncButton.setColour(TextButton::buttonColourId,
+        tempoSynced ? Colour(0xff00ff88) : Colour(0xff786fa6));
+}
+
+void MainComponent::chooseExportFile()
+{
+    exportChooser = std::make_unique<juce::FileChooser>("Export mix as...",
+        juce::File::getSpecialLocation(juce::File::userMusicDirectory).getChildFile("Mix.wav"),
+        "*.wav;*.flac");
+
+    auto flags = juce::FileBrowserComponent::saveMode |
+        juce::FileBrowserComponent::canSelectFiles |
+        juce::FileBrowserComponent::warnAboutOverwriting;
+
+    exportChooser->launchAsync(flags, [this](const juce::FileChooser& fc)
         {
-            // Linked mode: inverse relationship
-            float value = (float)slider->getValue();
-            mixerSlider1.setValue(1.0 - value, dontSendNotification);
-            mixerSlider2.setValue(value, dontSendNotification);
-        }
+            auto file = fc.getResult();
+            if (file == juce::File())
+                return;
+
+            if (!file.hasFileExtension("wav;flac"))
+                file = file.withFileExtension("wav");
+
+            showExportOptions(file);
+        });
+}
+
+void MainComponent::showExportOptions(const juce::File& file)
+{
+    exportOptionsWindow = std::make_unique<juce::AlertWindow>("Export Mix",
+        "Render " + file.getFileName() + " from where each deck is now.", MessageBoxIconType::NoIcon);
+
+    juce::StringArray depths{ "16-bit", "24-bit" };
+    if (file.hasFileExtension("wav"))
+        depths.add("32-bit float");
+
+    exportOptionsWindow->addComboBox("depth", depths, "Bit depth");
+    exportOptionsWindow->getComboBoxComponent("depth")->setSelectedItemIndex(1, dontSendNotification);
+    exportOptionsWindow->addComboBox("dither", { "No dither", "TPDF", "Noise-shaped TPDF" }, "Dither");
+    exportOptionsWindow->getComboBoxComponent("dither")->setSelectedItemIndex(1, dontSendNotification);
+    exportOptionsWindow->addButton("Export", 1, KeyPress(KeyPress::returnKey));
+    exportOptionsWindow->addButton("Cancel", 0, KeyPress(KeyPress::escapeKey));
+
+    exportOptionsWindow->enterModalState(true, juce::ModalCallbackFunction::create([this, file](int choice)
+        {
+            const int depthIndex = exportOptionsWindow->getComboBoxComponent("depth")->getSelectedItemIndex();
+            const int ditherIndex = exportOptionsWindow->getComboBoxComponent("dither")->getSelectedItemIndex();
+            exportOptionsWindow->setVisible(false);
 
-        // Update gains
-        player1.setGain((float)mixerSlider1.getValue() * (1.0f - (float)slider->getValue()));
-        player2.setGain((float)mixerSlider2.getValue() * (float)slider->getValue());
+            if (choice == 1)
+                startExport(file, depthIndex == 0 ? 16 : (depthIndex == 1 ? 24 : 32), (ExportDither)ditherIndex);
+        }), false);
+}
+
+void MainComponent::startExport(const juce::File& file, int bitsPerSample, ExportDither dither)
+{
+    OfflineMixRenderer::Settings settings;
+    settings.outputFile = file;
+    settings.bitsPerSample = bitsPerSample;
+    settings.dither = dither;
+    settings.crossfade = mixEngine.getCrossfade();
+    settings.crossfadeCurve = mixEngine.getCrossfadeCurve();
+
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        settings.sampleRate = device->getCurrentSampleRate();
+
+    // Every loaded deck plays from its current position, as if Play had been pressed on all of them
+    for (int i = 0; i < numDecks; ++i)
+        if (players[i]->getPlayerAudio().getCurrentFile() != juce::File())
+            settings.decks.add(OfflineMixRenderer::captureDeck(players[i]->getPlayerAudio(), mixEngine, i));
+
+    if (mixRenderer.start(settings))
+    {
+        exportButton.setButtonText("Cancel Export");
+        startTimerHz(10);
     }
 }
+
+void MainComponent::exportFinished(const juce::Result& result)
+{
+    stopTimer();
+    exportButton.setButtonText("Export Mix");
+
+    const auto message = result.wasOk()
+        ? "Rendered at " + juce::String(mixRenderer.getRealtimeFactor(), 1) + "x realtime."
+        : result.getErrorMessage();
+
+    juce::AlertWindow::showMessageBoxAsync(result.wasOk() ? MessageBoxIconType::InfoIcon : MessageBoxIconType::WarningIcon,
+        "Export Mix", message);
+}
+
+void MainComponent::timerCallback()
+{
+    exportButton.setButtonText("Cancel " + juce::String(juce::roundToInt(mixRenderer.getProgress() * 100.0)) + "%");
+}
@@ -1,12 +1,19 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PlayerGUI.h"
+#include "DeckMixEngine.h"
+#include "OfflineMixRenderer.h"
+#include "SignalAnalyser.h"
+#include "LevelMeter.h"
+#include "AudioCallbackStats.h"
+#include "CallbackStatsOverlay.h"
 
 class MainComponent : public juce::AudioAppComponent,
-    public juce::Slider::Listener
+    public juce::Slider::Listener,
+    private juce::Timer
 {
 public:
-    MainComponent();
+    explicit MainComponent(int numberOfDecks = 2);
     ~MainComponent() override;
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
@@ -17,22 +24,55 @@ public:
     void sliderValueChanged(juce::Slider* slider) override;
 
 private:
-    // Two players for mixing
-    PlayerGUI player1;
-    PlayerGUI player2;
+    // Players for mixing; one deck means single player mode
+    const int numDecks;
+    juce::OwnedArray<PlayerGUI> players;
 
-    // Mixer controls
-    juce::Slider mixerSlider1;
-    juce::Slider mixerSlider2;
+    // Renders every deck in parallel and mixes them
+    DeckMixEngine mixEngine;
+
+    // Meters: one per deck, pre-fader, and the master with its spectrum
+    juce::OwnedArray<SignalAnalyser> deckAnalysers;
+    SignalAnalyser masterAnalyser{ true };
+    juce::OwnedArray<LevelMeter> deckMeters;
+    LevelMeter masterMeter{ masterAnalyser };
+    SpectrumDisplay spectrumDisplay{ masterAnalyser };
+
+    // Callback timing: overlay toggled by the Stats button, file dump when the environment asks for one
+    AudioCallbackStats callbackStats;
+    CallbackStatsOverlay statsOverlay{ callbackStats, deviceManager };
+    std::unique_ptr<CallbackStatsLogger> statsLogger;
+    juce::TextButton statsButton{ "Stats" };
+
+    // Mixer controls, one level fader per deck
+    juce::OwnedArray<juce::Slider> levelSliders;
+    juce::OwnedArray<juce::Label> playerLabels;
     juce::Slider crossfadeSlider;
     juce::Label mixerLabel;
-    juce::Label player1Label;
-    juce::Label player2Label;
     juce::Label crossfadeLabel;
+    juce::ComboBox crossfadeCurveBox;
     juce::TextButton linkButton{ "Link" };
+    juce::TextButton syncButton{ "Sync" };
+
+    // Offline export of the mix
+    juce::TextButton exportButton{ "Export Mix" };
+    OfflineMixRenderer mixRenderer;
+    std::unique_ptr<juce::FileChooser> exportChooser;
+    std::unique_ptr<juce::AlertWindow> exportOptionsWindow;
+
+    void publishMixerParameters();
+    void setTempoSync(bool shouldSync);
+    void chooseExportFile();
+    void showExportOptions(const juce::File& file);
+    void startExport(const juce::File& file, int bitsPerSample, ExportDither dither);
+    void exportFinished(const juce::Result& result);
+    void timerCallback() override;
+    int getNumDeckColumns() const { return numDecks > 2 ? 2 : 1; }
+    int getMixerPanelWidth() const { return juce::jmax(300, 70 * numDecks + 40); }
 
-    bool useDualPlayer = true;  // Set to false for single player mode
     bool linked = false;
+    bool tempoSynced = false;
+    bool fullWaveformRepaint = false;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
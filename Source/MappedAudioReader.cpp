@@ -0,0 +1,57 @@
+#include "MappedAudioReader.h"
+
+MappedAudioReader::MappedAudioReader(juce::MemoryMappedAudioFormatReader* mappedReader, juce::int64 windowBytes)
+    : juce::AudioFormatReader(nullptr, mappedReader->getFormatName()),
+      source(mappedReader)
+{
+    sampleRate = source->sampleRate;
+    bitsPerSample = source->bitsPerSample;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = source->numChannels;
+    usesFloatingPointData = source->usesFloatingPointData;
+    metadataValues = source->metadataValues;
+
+    const int bytesPerFrame = juce::jmax(1, (int)(bitsPerSample / 8) * (int)numChannels);
+    windowSamples = juce::jmax((juce::int64)65536, windowBytes / bytesPerFrame);
+}
+
+MappedAudioReader::~MappedAudioReader()
+{
+}
+
+juce::AudioFormatReader* MappedAudioReader::createReaderFor(juce::AudioFormatManager& formatManager, const juce::File& file)
+{
+    if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+        if (auto* mapped = format->createMemoryMappedReader(file))
+            return new MappedAudioReader(mapped);
+
+    return formatManager.createReaderFor(file);
+}
+
+bool MappedAudioReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+    juce::int64 startSampleInFile, int numSamples)
+{
+    // The mapped reader zeroes anything past the end itself; only the part inside the file must be mapped
+    const juce::Range<juce::int64> wanted(startSampleInFile, juce::jmin(lengthInSamples, startSampleInFile + numSamples));
+
+    if (!wanted.isEmpty() && !source->getMappedSection().contains(wanted) && !mapWindowFor(wanted))
+    {
+        for (int channel = 0; channel < numDestChannels; ++channel)
+            if (destChannels[channel] != nullptr)
+                juce::zeromem(destChannels[channel] + startOffsetInDestBuffer, sizeof(int) * (size_t)numSamples);
+
+        return false;
+    }
+
+    return source->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+}
+
+bool MappedAudioReader::mapWindowFor(juce::Range<juce::int64> samples)
+{
+    // Keep a little behind the read as well, for loops and small backward seeks
+    const auto start = juce::jmax((juce::int64)0, samples.getStart() - windowSamples / 8);
+    const auto end = juce::jmin(lengthInSamples, juce::jmax(samples.getEnd(), start + windowSamples));
+
+    // Remapping replaces (and so unmaps) the previous window
+    return source->mapSectionOfFile(juce::Range<juce::int64>(start, end));
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Mapped Audio Reader ============
+// Reads an uncompressed file (WAV/AIFF) straight out of a memory mapping, with
+// no stream buffer in between. Only a window of the file is mapped at a time;
+// it moves to wherever the reads go, so multi-GB recordings cost no more
+// address space or page cache than a short file.
+class MappedAudioReader : public juce::AudioFormatReader
+{
+public:
+    static constexpr juce::int64 defaultWindowBytes = 64 * 1024 * 1024;
+
+    explicit MappedAudioReader(juce::MemoryMappedAudioFormatReader* mappedReader,
+        juce::int64 windowBytes = defaultWindowBytes);
+    ~MappedAudioReader() override;
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile, int numSamples) override;
+
+    juce::Range<juce::int64> getMappedSection() const { return source->getMappedSection(); }
+
+    // Memory-mapped where the format supports it, otherwise an ordinary buffered reader
+    static juce::AudioFormatReader* createReaderFor(juce::AudioFormatManager& formatManager, const juce::File& file);
+
+private:
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> source;
+    juce::int64 windowSamples;
+
+    bool mapWindowFor(juce::Range<juce::int64> samples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedAudioReader)
+};
@@ -0,0 +1,312 @@
+#include "MixKernel.h"
+
+#if defined (__AVX__)
+ #include <immintrin.h>
+ #define MIX_KERNEL_USE_AVX 1
+#elif JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #include <emmintrin.h>
+ #define MIX_KERNEL_USE_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define MIX_KERNEL_USE_NEON 1
+#endif
+
+namespace
+{
+    const std::array<float, CrossfadeTables::tableSize>& getTable(CrossfadeCurve curve)
+    {
+        switch (curve)
+        {
+            case CrossfadeCurve::equalPower: return CrossfadeTables::equalPower;
+            case CrossfadeCurve::cut:        return CrossfadeTables::cut;
+            case CrossfadeCurve::linear:
+            default:                         return CrossfadeTables::linear;
+        }
+    }
+
+    // Shared body of the ramped kernels; accumulate selects += versus =
+    template <bool accumulate>
+    void processWithRamp(float* dest, const float* src, float startGain, float endGain, int numSamples)
+    {
+        if (numSamples <= 0)
+            return;
+
+        const float step = (endGain - startGain) / (float)numSamples;
+        int i = 0;
+
+#if MIX_KERNEL_USE_AVX
+        __m256 gains = _mm256_setr_ps(startGain, startGain + step, startGain + 2.0f * step,
+            startGain + 3.0f * step, startGain + 4.0f * step, startGain + 5.0f * step,
+            startGain + 6.0f * step, startGain + 7.0f * step);
+        const __m256 gainIncrement = _mm256_set1_ps(8.0f * step);
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            __m256 result = _mm256_mul_ps(_mm256_loadu_ps(src + i), gains);
+
+            if constexpr (accumulate)
+                result = _mm256_add_ps(result, _mm256_loadu_ps(dest + i));
+
+            _mm256_storeu_ps(dest + i, result);
+            gains = _mm256_add_ps(gains, gainIncrement);
+        }
+#elif MIX_KERNEL_USE_SSE
+        __m128 gains = _mm_setr_ps(startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step);
+        const __m128 gainIncrement = _mm_set1_ps(4.0f * step);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            __m128 result = _mm_mul_ps(_mm_loadu_ps(src + i), gains);
+
+            if constexpr (accumulate)
+                result = _mm_add_ps(result, _mm_loadu_ps(dest + i));
+
+            _mm_storeu_ps(dest + i, result);
+            gains = _mm_add_ps(gains, gainIncrement);
+        }
+#elif MIX_KERNEL_USE_NEON
+        const float initialGains[4] = { startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step };
+        float32x4_t gains = vld1q_f32(initialGains);
+        const float32x4_t gainIncrement = vdupq_n_f32(4.0f * step);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            float32x4_t result = vmulq_f32(vld1q_f32(src + i), gains);
+
+            if constexpr (accumulate)
+                result = vaddq_f32(result, vld1q_f32(dest + i));
+
+            vst1q_f32(dest + i, result);
+            gains = vaddq_f32(gains, gainIncrement);
+        }
+#endif
+
+        for (; i < numSamples; ++i)
+        {
+            const float gain = startGain + step * (float)i;
+
+            if constexpr (accumulate)
+                dest[i] += src[i] * gain;
+            else
+                dest[i] = src[i] * gain;
+        }
+    }
+}
+
+float MixKernel::getCrossfadeGain(CrossfadeCurve curve, float position)
+{
+    const auto& table = getTable(curve);
+    const float index = juce::jlimit(0.0f, 1.0f, position) * (float)(CrossfadeTables::tableSize - 1);
+    const int lower = juce::jmin((int)index, CrossfadeTables::tableSize - 2);
+    const float fraction = index - (float)lower;
+
+    return table[(size_t)lower] + (table[(size_t)lower + 1] - table[(size_t)lower]) * fraction;
+}
+
+void MixKernel::copyWithRamp(float* dest, const float* src, float startGain, float endGain, int numSamples)
+{
+    // A settled gain is a plain multiply, which JUCE already vectorises
+    if (startGain == endGain)
+        juce::FloatVectorOperations::multiply(dest, src, startGain, numSamples);
+    else
+        processWithRamp<false>(dest, src, startGain, endGain, numSamples);
+}
+
+void MixKernel::addWithRamp(float* dest, const float* src, float startGain, float endGain, int numSamples)
+{
+    if (startGain == endGain)
+    {
+        if (startGain != 0.0f)
+            juce::FloatVectorOperations::addWithMultiply(dest, src, startGain, numSamples);
+    }
+    else
+    {
+        processWithRamp<true>(dest, src, startGain, endGain, numSamples);
+    }
+}
+
+void MixKernel::mixBuses(juce::AudioBuffer<float>& dest, int destStartSample,
+    const juce::AudioBuffer<float>* const* sources, const float* startGains, const float* endGains,
+    int numSources, int numChannels, int numSamples)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* output = dest.getWritePointer(channel, destStartSample);
+
+        if (numSources == 0)
+        {
+            juce::FloatVectorOperations::clear(output, numSamples);
+            continue;
+        }
+
+        copyWithRamp(output, sources[0]->getReadPointer(channel), startGains[0], endGains[0], numSamples);
+
+        for (int source = 1; source < numSources; ++source)
+            addWithRamp(output, sources[source]->getReadPointer(channel), startGains[source], endGains[source], numSamples);
+    }
+}
+
+float MixKernel::dotProduct(const float* a, const float* b, int numSamples)
+{
+    int i = 0;
+    float sum = 0.0f;
+
+#if MIX_KERNEL_USE_AVX
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    // Two accumulators hide the add latency
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+
+    for (; i + 8 <= numSamples; i += 8)
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+
+    const __m256 acc = _mm256_add_ps(acc0, acc1);
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    const __m128 pair = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    sum = _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+#elif MIX_KERNEL_USE_SSE
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    for (; i + 4 <= numSamples; i += 4)
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+    const __m128 acc = _mm_add_ps(acc0, acc1);
+    const __m128 pair = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    sum = _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+#elif MIX_KERNEL_USE_NEON
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+
+    for (; i + 4 <= numSamples; i += 4)
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+
+    const float32x4_t acc = vaddq_f32(acc0, acc1);
+    const float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+
+    for (; i < numSamples; ++i)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+void MixKernel::findPeaks(const float* src, int numSamples, float& minValue, float& maxValue, float& sumSquares)
+{
+    jassert(numSamples > 0);
+
+    int i = 0;
+    float low = src[0], high = src[0], sum = 0.0f;
+
+#if MIX_KERNEL_USE_AVX
+    if (numSamples >= 8)
+    {
+        __m256 lows = _mm256_loadu_ps(src);
+        __m256 highs = lows;
+        __m256 squares = _mm256_setzero_ps();
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const __m256 v = _mm256_loadu_ps(src + i);
+            lows = _mm256_min_ps(lows, v);
+            highs = _mm256_max_ps(highs, v);
+            squares = _mm256_add_ps(squares, _mm256_mul_ps(v, v));
+        }
+
+        alignas(32) float l[8], h[8], q[8];
+        _mm256_store_ps(l, lows);
+        _mm256_store_ps(h, highs);
+        _mm256_store_ps(q, squares);
+
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            low = juce::jmin(low, l[lane]);
+            high = juce::jmax(high, h[lane]);
+            sum += q[lane];
+        }
+    }
+#elif MIX_KERNEL_USE_SSE
+    if (numSamples >= 4)
+    {
+        __m128 lows = _mm_loadu_ps(src);
+        __m128 highs = lows;
+        __m128 squares = _mm_setzero_ps();
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 v = _mm_loadu_ps(src + i);
+            lows = _mm_min_ps(lows, v);
+            highs = _mm_max_ps(highs, v);
+            squares = _mm_add_ps(squares, _mm_mul_ps(v, v));
+        }
+
+        alignas(16) float l[4], h[4], q[4];
+        _mm_store_ps(l, lows);
+        _mm_store_ps(h, highs);
+        _mm_store_ps(q, squares);
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            low = juce::jmin(low, l[lane]);
+            high = juce::jmax(high, h[lane]);
+            sum += q[lane];
+        }
+    }
+#elif MIX_KERNEL_USE_NEON
+    if (numSamples >= 4)
+    {
+        float32x4_t lows = vld1q_f32(src);
+        float32x4_t highs = lows;
+        float32x4_t squares = vdupq_n_f32(0.0f);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const float32x4_t v = vld1q_f32(src + i);
+            lows = vminq_f32(lows, v);
+            highs = vmaxq_f32(highs, v);
+            squares = vmlaq_f32(squares, v, v);
+        }
+
+        float l[4], h[4], q[4];
+        vst1q_f32(l, lows);
+        vst1q_f32(h, highs);
+        vst1q_f32(q, squares);
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            low = juce::jmin(low, l[lane]);
+            high = juce::jmax(high, h[lane]);
+            sum += q[lane];
+        }
+    }
+#endif
+
+    for (; i < numSamples; ++i)
+    {
+        low = juce::jmin(low, src[i]);
+        high = juce::jmax(high, src[i]);
+        sum += src[i] * src[i];
+    }
+
+    minValue = low;
+    maxValue = high;
+    sumSquares = sum;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// ============ Crossfader Curves ============
+enum class CrossfadeCurve
+{
+    linear = 0,
+    equalPower,
+    cut
+};
+
+// Gain tables for each curve, built at compile time. Index 0 is the far side of the
+// fader (silent) and the last entry is fully towards the deck (unity).
+namespace CrossfadeTables
+{
+    constexpr int tableSize = 257;
+    constexpr double cutWidth = 0.05;
+
+    // Taylor series sine for x in [0, pi/2]; std::sin is not constexpr
+    constexpr double constexprSin(double x)
+    {
+        double term = x;
+        double sum = x;
+
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -x * x / (double)((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    template <typename CurveFunction>
+    constexpr std::array<float, tableSize> makeTable(CurveFunction curve)
+    {
+        std::array<float, tableSize> table{};
+
+        for (int i = 0; i < tableSize; ++i)
+            table[(size_t)i] = (float)curve((double)i / (double)(tableSize - 1));
+
+        return table;
+    }
+
+    constexpr auto linear = makeTable([](double x) { return x; });
+    constexpr auto equalPower = makeTable([](double x) { return constexprSin(x * 1.5707963267948966); });
+    constexpr auto cut = makeTable([](double x) { return x >= cutWidth ? 1.0 : x / cutWidth; });
+}
+
+// ============ Mix Kernel ============
+// Vectorised (AVX, SSE2 or NEON, with a scalar tail) gain-ramped mixing of deck buses,
+// plus the dot product the resampler and time-stretcher filter with and the peak
+// scan the waveform builder runs over whole files.
+namespace MixKernel
+{
+    // Gain for a deck whose fader position towards it is position (0..1)
+    float getCrossfadeGain(CrossfadeCurve curve, float position);
+
+    // dest[i] = src[i] * gain, gain moving linearly from startGain to endGain
+    void copyWithRamp(float* dest, const float* src, float startGain, float endGain, int numSamples);
+
+    // dest[i] += src[i] * gain, gain moving linearly from startGain to endGain
+    void addWithRamp(float* dest, const float* src, float startGain, float endGain, int numSamples);
+
+    // Writes the gain-ramped sum of numSources buses into dest, replacing its contents
+    void mixBuses(juce::AudioBuffer<float>& dest, int destStartSample,
+        const juce::AudioBuffer<float>* const* sources, const float* startGains, const float* endGains,
+        int numSources, int numChannels, int numSamples);
+
+    // Sum of a[i] * b[i]
+    float dotProduct(const float* a, const float* b, int numSamples);
+
+    // Lowest and highest sample and the sum of squares, in one pass; numSamples must be at least 1
+    void findPeaks(const float* src, int numSamples, float& minValue, float& maxValue, float& sumSquares);
+}
@@ -0,0 +1,474 @@
+#include "Mp3SeekIndex.h"
+#include "MappedAudioReader.h"
+#include <cstring>
+
+namespace
+{
+    struct FrameHeader
+    {
+        int version = 0;    // 0 = MPEG-1, 1 = MPEG-2, 2 = MPEG-2.5
+        int layer = 0;
+        int sampleRate = 0;
+        int frameLength = 0;
+        int samplesPerFrame = 0;
+        bool mono = false;
+
+        bool sameStreamAs(const FrameHeader& other) const
+        {
+            return version == other.version && layer == other.layer && sampleRate == other.sampleRate;
+        }
+    };
+
+    bool parseFrameHeader(const juce::uint8* p, FrameHeader& header)
+    {
+        static const int bitrates[2][3][15] = {
+            { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+              { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+              { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 } },
+            { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } }
+        };
+
+        static const int sampleRates[3][3] = { { 44100, 48000, 32000 }, { 22050, 24000, 16000 }, { 11025, 12000, 8000 } };
+
+        if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+            return false;
+
+        const int versionBits = (p[1] >> 3) & 3;
+        const int layerBits = (p[1] >> 1) & 3;
+        const int bitrateIndex = p[2] >> 4;
+        const int sampleRateIndex = (p[2] >> 2) & 3;
+
+        // Reserved values, and free-format streams whose frame size is not in the header
+        if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+            return false;
+
+        header.version = versionBits == 3 ? 0 : (versionBits == 2 ? 1 : 2);
+        header.layer = 4 - layerBits;
+        header.sampleRate = sampleRates[header.version][sampleRateIndex];
+        header.mono = (p[3] >> 6) == 3;
+
+        const bool lowSamplingFrequency = header.version != 0;
+        const int bitrate = bitrates[lowSamplingFrequency ? 1 : 0][header.layer - 1][bitrateIndex] * 1000;
+        const int padding = (p[2] >> 1) & 1;
+
+        if (header.layer == 1)
+        {
+            header.samplesPerFrame = 384;
+            header.frameLength = (12 * bitrate / header.sampleRate + padding) * 4;
+        }
+        else if (header.layer == 2 || !lowSamplingFrequency)
+        {
+            header.samplesPerFrame = 1152;
+            header.frameLength = 144 * bitrate / header.sampleRate + padding;
+        }
+        else
+        {
+            header.samplesPerFrame = 576;
+            header.frameLength = 72 * bitrate / header.sampleRate + padding;
+        }
+
+        return header.frameLength > 4;
+    }
+
+    // Xing/Info and VBRI frames carry stream info, not audio; the decoder skips them too
+    bool isTagFrame(const juce::uint8* frame, const FrameHeader& header)
+    {
+        if (header.layer != 3)
+            return false;
+
+        const int sideInfoSize = header.version == 0 ? (header.mono ? 17 : 32) : (header.mono ? 9 : 17);
+        const int xingOffset = 4 + sideInfoSize;
+
+        if (xingOffset + 4 <= header.frameLength)
+        {
+            auto* tag = reinterpret_cast<const char*>(frame + xingOffset);
+            if (std::memcmp(tag, "Xing", 4) == 0 || std::memcmp(tag, "Info", 4) == 0)
+                return true;
+        }
+
+        return header.frameLength >= 40 && std::memcmp(frame + 36, "VBRI", 4) == 0;
+    }
+
+    juce::int64 skipId3v2Tags(const juce::uint8* data, juce::int64 size)
+    {
+        juce::int64 pos = 0;
+
+        while (pos + 10 <= size && std::memcmp(data + pos, "ID3", 3) == 0)
+        {
+            const auto* p = data + pos;
+            const juce::int64 tagSize = ((juce::int64)(p[6] & 0x7f) << 21) | ((p[7] & 0x7f) << 14)
+                | ((p[8] & 0x7f) << 7) | (p[9] & 0x7f);
+            pos += 10 + tagSize + ((p[5] & 0x10) != 0 ? 10 : 0);
+        }
+
+        return pos;
+    }
+
+    // A header only counts if the next frame (when there is one) agrees with it
+    bool isFrameAt(const juce::uint8* data, juce::int64 size, juce::int64 pos, FrameHeader& header)
+    {
+        if (pos + 4 > size || !parseFrameHeader(data + pos, header) || pos + header.frameLength > size)
+            return false;
+
+        FrameHeader next;
+        const auto nextPos = pos + header.frameLength;
+        return nextPos + 4 > size || (parseFrameHeader(data + nextPos, next) && next.sameStreamAs(header));
+    }
+
+    constexpr int indexMagic = 0x58444953;    // "SIDX"
+    constexpr int indexVersion = 1;
+}
+
+// ============ Mp3SeekIndex Implementation ============
+Mp3SeekIndex::Mp3SeekIndex(const juce::File& f, juce::int64 size, juce::Time modificationTime)
+    : file(f), fileSize(size), fileModificationTime(modificationTime)
+{
+}
+
+bool Mp3SeekIndex::isUpToDate() const
+{
+    return file.getSize() == fileSize && file.getLastModificationTime() == fileModificationTime;
+}
+
+Mp3SeekIndex::Ptr Mp3SeekIndex::build(const juce::File& file)
+{
+    Ptr index = new Mp3SeekIndex(file, file.getSize(), file.getLastModificationTime());
+
+    juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const juce::uint8*>(mapped.getData());
+    const auto size = (juce::int64)mapped.getSize();
+
+    if (data == nullptr)
+        return nullptr;
+
+    // Find the first frame, giving up if the start of the file is not MPEG audio at all
+    auto pos = skipId3v2Tags(data, size);
+    const auto searchEnd = juce::jmin(size, pos + 65536);
+    FrameHeader first;
+
+    while (pos < searchEnd && !isFrameAt(data, size, pos, first))
+        ++pos;
+
+    if (pos >= searchEnd)
+        return nullptr;
+
+    if (isTagFrame(data + pos, first))
+        pos += first.frameLength;
+
+    index->sampleRate = first.sampleRate;
+    index->samplesPerFrame = first.samplesPerFrame;
+    index->frameOffsets.ensureStorageAllocated((int)(size / juce::jmax(1, first.frameLength)) + 16);
+
+    FrameHeader header;
+
+    while (pos + 4 <= size)
+    {
+        if (parseFrameHeader(data + pos, header) && header.sameStreamAs(first) && pos + header.frameLength <= size)
+        {
+            index->frameOffsets.add(pos);
+            pos += header.frameLength;
+
+            if ((index->frameOffsets.size() & 4095) == 0 && juce::Thread::currentThreadShouldExit())
+                return nullptr;
+
+            continue;
+        }
+
+        // ID3v1 / APE tags at the end, or junk in the middle: resync on the next good header
+        if (std::memcmp(data + pos, "TAG", 3) == 0 || (size - pos >= 8 && std::memcmp(data + pos, "APETAGEX", 8) == 0))
+            break;
+
+        while (++pos + 4 <= size && !(isFrameAt(data, size, pos, header) && header.sameStreamAs(first)))
+        {
+        }
+    }
+
+    if (index->frameOffsets.isEmpty())
+        return nullptr;
+
+    return index;
+}
+
+juce::File Mp3SeekIndex::getAnalysisCacheDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("AudioPlayer").getChildFile("AnalysisCache");
+}
+
+juce::File Mp3SeekIndex::getCacheFileFor(const juce::File& file)
+{
+    return getAnalysisCacheDirectory().getChildFile(
+        juce::String::toHexString(file.getFullPathName().hashCode64()) + ".seekidx");
+}
+
+bool Mp3SeekIndex::save() const
+{
+    auto target = getCacheFileFor(file);
+    if (!target.getParentDirectory().createDirectory())
+        return false;
+
+    // Written aside and swapped in, so a crash never leaves a half-written index behind
+    juce::TemporaryFile temp(target);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen())
+            return false;
+
+        out.writeInt(indexMagic);
+        out.writeInt(indexVersion);
+        out.writeString(file.getFullPathName());
+        out.writeInt64(fileSize);
+        out.writeInt64(fileModificationTime.toMilliseconds());
+        out.writeDouble(sampleRate);
+        out.writeInt(samplesPerFrame);
+        out.writeInt(frameOffsets.size());
+        out.write(frameOffsets.getRawDataPointer(), sizeof(juce::int64) * (size_t)frameOffsets.size());
+        out.flush();
+
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+Mp3SeekIndex::Ptr Mp3SeekIndex::load(const juce::File& file)
+{
+    juce::FileInputStream in(getCacheFileFor(file));
+    if (in.failedToOpen() || in.readInt() != indexMagic || in.readInt() != indexVersion)
+        return nullptr;
+
+    // The name is a hash of the path, so check the path itself as well as size and date
+    if (in.readString() != file.getFullPathName())
+        return nullptr;
+
+    const auto size = in.readInt64();
+    const auto modificationTime = juce::Time(in.readInt64());
+
+    if (size != file.getSize() || modificationTime != file.getLastModificationTime())
+        return nullptr;
+
+    Ptr index = new Mp3SeekIndex(file, size, modificationTime);
+    index->sampleRate = in.readDouble();
+    index->samplesPerFrame = in.readInt();
+    const int numFrames = in.readInt();
+
+    if (index->samplesPerFrame <= 0 || numFrames <= 0 || (juce::int64)numFrames > size / 4)
+        return nullptr;
+
+    index->frameOffsets.resize(numFrames);
+    const auto bytes = sizeof(juce::int64) * (size_t)numFrames;
+
+    if (in.read(index->frameOffsets.getRawDataPointer(), bytes) != (int)bytes)
+        return nullptr;
+
+    return index;
+}
+
+// ============ IndexedMp3Reader Implementation ============
+IndexedMp3Reader::IndexedMp3Reader(juce::AudioFormat& mp3Format, juce::AudioFormatReader* initialReader, Mp3SeekIndex::Ptr i)
+    : juce::AudioFormatReader(nullptr, initialReader->getFormatName()),
+      format(mp3Format),
+      index(std::move(i)),
+      decoder(initialReader)
+{
+    sampleRate = decoder->sampleRate;
+    bitsPerSample = decoder->bitsPerSample;
+    numChannels = decoder->numChannels;
+    usesFloatingPointData = decoder->usesFloatingPointData;
+    metadataValues = decoder->metadataValues;
+
+    // The index counts frames exactly; the decoder only estimates from the bitrate
+    lengthInSamples = index->getLengthInSamples();
+
+    scratch.allocate((size_t)scratchSamples * numChannels, false);
+}
+
+IndexedMp3Reader::~IndexedMp3Reader()
+{
+}
+
+bool IndexedMp3Reader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+    juce::int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer,
+        startSampleInFile, numSamples, lengthInSamples);
+
+    if (numSamples <= 0)
+        return true;
+
+    // Short hops forward just decode through; anything else reopens at the nearest indexed frame
+    const auto skipLimit = (juce::int64)maxSkipFrames * index->getSamplesPerFrame();
+    const bool canContinue = decoder != nullptr && startSampleInFile >= nextSample
+        && startSampleInFile - nextSample <= skipLimit;
+
+    if (!(canContinue ? skipTo(startSampleInFile) : restartAt(startSampleInFile)))
+    {
+        for (int channel = 0; channel < numDestChannels; ++channel)
+            if (destChannels[channel] != nullptr)
+                juce::zeromem(destChannels[channel] + startOffsetInDestBuffer, sizeof(int) * (size_t)numSamples);
+
+        decoder.reset();
+        return false;
+    }
+
+    const bool ok = decoder->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer,
+        startSampleInFile - decoderStart, numSamples);
+    nextSample = startSampleInFile + numSamples;
+    return ok;
+}
+
+bool IndexedMp3Reader::restartAt(juce::int64 sample)
+{
+    const int frame = (int)juce::jlimit((juce::int64)0, (juce::int64)index->getNumFrames() - 1,
+        sample / index->getSamplesPerFrame());
+    const int firstFrame = juce::jmax(0, frame - leadInFrames);
+
+    auto stream = std::make_unique<juce::FileInputStream>(index->getFile());
+    if (stream->failedToOpen())
+        return false;
+
+    // Frame 0 is opened with the whole file so the decoder sees the ID3 and Xing headers as usual
+    juce::InputStream* input = stream.release();
+    if (firstFrame > 0)
+        input = new juce::SubregionStream(input, index->getFrameOffset(firstFrame), -1, true);
+
+    decoder.reset(format.createReaderFor(input, true));
+    if (decoder == nullptr)
+        return false;
+
+    decoderStart = (juce::int64)firstFrame * index->getSamplesPerFrame();
+    nextSample = decoderStart;
+    return skipTo(sample);
+}
+
+bool IndexedMp3Reader::skipTo(juce::int64 sample)
+{
+    float* channels[2] = { scratch.get(), scratch.get() + (numChannels > 1 ? scratchSamples : 0) };
+
+    while (nextSample < sample)
+    {
+        const int numToSkip = (int)juce::jmin((juce::int64)scratchSamples, sample - nextSample);
+
+        if (!decoder->readSamples(reinterpret_cast<int* const*>(channels), juce::jmin(2, (int)numChannels), 0,
+                nextSample - decoderStart, numToSkip))
+            return false;
+
+        nextSample += numToSkip;
+    }
+
+    return true;
+}
+
+// ============ Build Job ============
+class SeekIndexCache::BuildJob : public juce::ThreadPoolJob
+{
+public:
+    BuildJob(SeekIndexCache& c, const juce::File& f)
+        : juce::ThreadPoolJob("Index " + f.getFileName()), cache(c), file(f)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        if (auto index = Mp3SeekIndex::build(file))
+        {
+            index->save();
+            cache.remember(index);
+        }
+
+        const juce::ScopedLock sl(cache.lock);
+        cache.pendingPaths.removeString(file.getFullPathName());
+        return jobHasFinished;
+    }
+
+private:
+    SeekIndexCache& cache;
+    const juce::File file;
+};
+
+// ============ SeekIndexCache Implementation ============
+SeekIndexCache::SeekIndexCache()
+{
+}
+
+SeekIndexCache::~SeekIndexCache()
+{
+    buildPool.removeAllJobs(true, 5000);
+}
+
+Mp3SeekIndex::Ptr SeekIndexCache::find(const juce::File& file)
+{
+    {
+        const juce::ScopedLock sl(lock);
+
+        for (int i = 0; i < indexes.size(); ++i)
+        {
+            auto* index = indexes.getUnchecked(i);
+
+            if (index->getFile() != file)
+                continue;
+
+            if (index->isUpToDate())
+                return index;
+
+            indexes.remove(i);
+            break;
+        }
+    }
+
+    auto index = Mp3SeekIndex::load(file);
+    if (index != nullptr)
+        remember(index);
+
+    return index;
+}
+
+void SeekIndexCache::requestBuild(const juce::File& file)
+{
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (pendingPaths.contains(file.getFullPathName()))
+            return;
+
+        pendingPaths.add(file.getFullPathName());
+    }
+
+    buildPool.addJob(new BuildJob(*this, file), true);
+}
+
+void SeekIndexCache::remember(Mp3SeekIndex::Ptr index)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (int i = indexes.size(); --i >= 0;)
+        if (indexes.getUnchecked(i)->getFile() == index->getFile())
+            indexes.remove(i);
+
+    indexes.insert(0, index);
+
+    while (indexes.size() > maxIndexesInMemory)
+        indexes.removeLast();
+}
+
+juce::AudioFormatReader* SeekIndexCache::createReaderFor(juce::AudioFormatManager& formatManager, const juce::File& file)
+{
+    if (!needsIndex(file))
+        return MappedAudioReader::createReaderFor(formatManager, file);
+
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    auto* reader = MappedAudioReader::createReaderFor(formatManager, file);
+
+    if (format == nullptr || reader == nullptr)
+        return reader;
+
+    if (auto index = find(file))
+        return new IndexedMp3Reader(*format, reader, index);
+
+    requestBuild(file);
+    return reader;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ MP3 Seek Index ============
+// Byte offset of every audio frame in an MP3 file, found by walking the frame
+// headers only (nothing is decoded). With it a seek is one file open plus a
+// few frames of decode, instead of scanning forward from the last known frame.
+class Mp3SeekIndex : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<Mp3SeekIndex>;
+
+    // Walks the whole file; returns nullptr for anything that is not a constant-layout MPEG audio stream
+    static Ptr build(const juce::File& file);
+
+    // Persisted form, next to the other cached analysis; load() rejects an index for a changed file
+    static Ptr load(const juce::File& file);
+    bool save() const;
+    static juce::File getCacheFileFor(const juce::File& file);
+    static juce::File getAnalysisCacheDirectory();
+
+    const juce::File& getFile() const { return file; }
+    bool isUpToDate() const;
+    double getSampleRate() const { return sampleRate; }
+    int getSamplesPerFrame() const { return samplesPerFrame; }
+    int getNumFrames() const { return frameOffsets.size(); }
+    juce::int64 getFrameOffset(int frame) const { return frameOffsets[frame]; }
+    juce::int64 getLengthInSamples() const { return (juce::int64)getNumFrames() * samplesPerFrame; }
+
+private:
+    Mp3SeekIndex(const juce::File& file, juce::int64 fileSize, juce::Time modificationTime);
+
+    const juce::File file;
+    const juce::int64 fileSize;
+    const juce::Time fileModificationTime;
+    double sampleRate = 0.0;
+    int samplesPerFrame = 0;
+    juce::Array<juce::int64> frameOffsets;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Mp3SeekIndex)
+};
+
+// ============ Indexed MP3 Reader ============
+// Decodes with JUCE's MP3 reader, but jumps by reopening the stream at an indexed
+// frame a few frames before the target. The lead-in frames refill the bit
+// reservoir and the synthesis overlap, and are thrown away.
+class IndexedMp3Reader : public juce::AudioFormatReader
+{
+public:
+    // Takes ownership of initialReader, which must have been opened on the whole file
+    IndexedMp3Reader(juce::AudioFormat& mp3Format, juce::AudioFormatReader* initialReader, Mp3SeekIndex::Ptr index);
+    ~IndexedMp3Reader() override;
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    static constexpr int leadInFrames = 4;
+    static constexpr int maxSkipFrames = 8;
+    static constexpr int scratchSamples = 4096;
+
+    juce::AudioFormat& format;
+    Mp3SeekIndex::Ptr index;
+    std::unique_ptr<juce::AudioFormatReader> decoder;
+    juce::int64 decoderStart = 0;
+    juce::int64 nextSample = 0;
+    juce::HeapBlock<float> scratch;
+
+    bool restartAt(juce::int64 sample);
+    bool skipTo(juce::int64 sample);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IndexedMp3Reader)
+};
+
+// ============ Seek Index Cache ============
+// Hands out seek indexes for compressed files, building missing ones on a
+// background thread and persisting them so a file is only walked once.
+// Decks get it through juce::SharedResourcePointer.
+class SeekIndexCache
+{
+public:
+    SeekIndexCache();
+    ~SeekIndexCache();
+
+    // Ogg and FLAC already seek by bisection or their own seek tables; only MP3 needs help
+    static bool needsIndex(const juce::File& file) { return file.hasFileExtension("mp3"); }
+
+    // Memory first, then the persisted copy; nullptr if it has not been built yet
+    Mp3SeekIndex::Ptr find(const juce::File& file);
+    void requestBuild(const juce::File& file);
+
+    // An indexed reader when an index is ready, otherwise the usual reader (and the index gets queued)
+    juce::AudioFormatReader* createReaderFor(juce::AudioFormatManager& formatManager, const juce::File& file);
+
+private:
+    class BuildJob;
+
+    static constexpr int maxIndexesInMemory = 32;
+
+    juce::CriticalSection lock;
+    juce::ReferenceCountedArray<Mp3SeekIndex> indexes;
+    juce::StringArray pendingPaths;
+    juce::ThreadPool buildPool{ 1, 0, juce::Thread::Priority::low };
+
+    void remember(Mp3SeekIndex::Ptr index);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SeekIndexCache)
+};
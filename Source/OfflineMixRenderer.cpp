@@ -0,0 +1,255 @@
+#include "OfflineMixRenderer.h"
+
+OfflineMixRenderer::OfflineMixRenderer() : juce::Thread("Offline Mix Render")
+{
+}
+
+OfflineMixRenderer::~OfflineMixRenderer()
+{
+    stopThread(10000);
+    cancelPendingUpdate();
+}
+
+OfflineMixRenderer::DeckSettings OfflineMixRenderer::captureDeck(const PlayerAudio& deck,
+    const DeckMixEngine& engine, int deckIndex)
+{
+    DeckSettings deckSettings;
+    deckSettings.file = deck.getCurrentFile();
+    deckSettings.startSeconds = deck.getPosition();
+    deckSettings.gain = deck.getGain();
+    deckSettings.autoGain = deck.isAutoGainEnabled();
+    deckSettings.speed = deck.getSpeed();
+    deckSettings.keyLock = deck.isKeyLockEnabled();
+    deckSettings.stretchQuality = deck.getStretchQuality();
+    deckSettings.resamplerQuality = deck.getResamplerQuality();
+    deckSettings.loopTrack = deck.isLoopingTrack();
+    deckSettings.abLoopStart = deck.getABLoopStart();
+    deckSettings.abLoopEnd = deck.getABLoopEnd();
+    deckSettings.level = engine.getDeckLevel(deckIndex);
+    deckSettings.side = engine.getCrossfadeSide(deckIndex);
+    deckSettings.syncLeader = engine.getSyncLeader() == deckIndex;
+    deckSettings.followsLeader = engine.isTempoSynced(deckIndex);
+    return deckSettings;
+}
+
+bool OfflineMixRenderer::start(const Settings& newSettings)
+{
+    if (isThreadRunning())
+        return false;
+
+    settings = newSettings;
+    result = juce::Result::ok();
+    progress = 0.0;
+    realtimeFactor = 0.0;
+    shapingError[0] = shapingError[1] = 0.0f;
+
+    startThread(juce::Thread::Priority::normal);
+    return true;
+}
+
+void OfflineMixRenderer::cancel()
+{
+    signalThreadShouldExit();
+}
+
+void OfflineMixRenderer::run()
+{
+    result = render();
+    triggerAsyncUpdate();
+}
+
+void OfflineMixRenderer::handleAsyncUpdate()
+{
+    if (onFinished)
+        onFinished(result);
+}
+
+juce::Result OfflineMixRenderer::render()
+{
+    if (settings.decks.isEmpty())
+        return juce::Result::fail("There is nothing loaded to export.");
+
+    // Decks first, so the engine (which releases them) goes before they do
+    juce::OwnedArray<PlayerAudio> decks;
+    DeckMixEngine engine;
+    engine.setNonRealtime(true);
+
+    for (const auto& deckSettings : settings.decks)
+    {
+        auto* deck = decks.add(new PlayerAudio());
+        deck->setNonRealtime(true);
+
+        if (!deck->loadFile(deckSettings.file))
+            return juce::Result::fail("Could not open " + deckSettings.file.getFileName());
+
+        // Earlier measurements come off the disk here, on the render thread; the gain follows below
+        deck->getTrackAnalyzer().loadFromCache(deckSettings.file);
+        deck->updateBeatGrid();
+
+        engine.addDeck(*deck, deckSettings.side);
+    }
+
+    engine.prepareToPlay(settings.blockSize, settings.sampleRate, 2);
+    engine.setCrossfade(settings.crossfade);
+    engine.setCrossfadeCurve(settings.crossfadeCurve);
+
+    // Same calls the GUI makes; they are queued and applied on the first block
+    double longestSeconds = 0.0;
+
+    for (int i = 0; i < decks.size(); ++i)
+    {
+        const auto& deckSettings = settings.decks.getReference(i);
+        auto* deck = decks.getUnchecked(i);
+
+        deck->setAutoGain(deckSettings.autoGain);
+        deck->setGain(deckSettings.gain);
+        deck->setStretchQuality(deckSettings.stretchQuality);
+        deck->setResamplerQuality(deckSettings.resamplerQuality);
+        deck->setKeyLock(deckSettings.keyLock);
+        deck->setSpeed(deckSettings.speed);
+        deck->setLooping(deckSettings.loopTrack);
+
+        if (deckSettings.abLoopStart >= 0.0 && deckSettings.abLoopEnd > deckSettings.abLoopStart)
+            deck->setABLoop(deckSettings.abLoopStart, deckSettings.abLoopEnd);
+
+        deck->setPosition(deckSettings.startSeconds);
+        deck->play();
+        engine.setDeckLevel(i, deckSettings.level);
+        engine.setTempoSync(i, deckSettings.followsLeader);
+
+        if (deckSettings.syncLeader)
+            engine.setSyncLeader(i);
+
+        const double remaining = (deck->getLength() - deckSettings.startSeconds) / juce::jmax(0.01f, deck->getSpeed());
+        longestSeconds = juce::jmax(longestSeconds, remaining);
+    }
+
+    const double lengthSeconds = settings.lengthSeconds > 0.0 ? settings.lengthSeconds : longestSeconds;
+    const auto totalSamples = (juce::int64)(lengthSeconds * settings.sampleRate);
+
+    if (totalSamples <= 0)
+        return juce::Result::fail("The decks have nothing left to play.");
+
+    // Writer: FLAC tops out at 24 bits, and only WAV takes 32-bit float
+    const bool flac = settings.outputFile.hasFileExtension("flac");
+    std::unique_ptr<juce::AudioFormat> format;
+    if (flac)
+        format = std::make_unique<juce::FlacAudioFormat>();
+    else
+        format = std::make_unique<juce::WavAudioFormat>();
+
+    const int bitsPerSample = flac ? juce::jmin(24, settings.bitsPerSample) : settings.bitsPerSample;
+
+    settings.outputFile.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(settings.outputFile.createOutputStream());
+
+    if (stream == nullptr)
+        return juce::Result::fail("Could not write to " + settings.outputFile.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), settings.sampleRate, 2,
+        bitsPerSample, {}, 0));
+
+    if (writer == nullptr)
+        return juce::Result::fail(format->getFormatName() + " can't write " + juce::String(bitsPerSample) + "-bit audio.");
+
+    stream.release();
+    settings.bitsPerSample = bitsPerSample;
+
+    // Encoding and disk writes happen on their own thread, behind a FIFO
+    juce::TimeSliceThread writerThread("Export Writer");
+    writerThread.startThread();
+    auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(writer.release(), writerThread, 1 << 18);
+
+    juce::AudioBuffer<float> block(2, settings.blockSize);
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    bool cancelled = false;
+
+    for (juce::int64 done = 0; done < totalSamples;)
+    {
+        if (threadShouldExit())
+        {
+            cancelled = true;
+            break;
+        }
+
+        const int numSamples = (int)juce::jmin((juce::int64)settings.blockSize, totalSamples - done);
+        engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&block, 0, numSamples));
+        applyDither(block, numSamples);
+
+        // The FIFO only fills up if the disk is slower than we are
+        while (!threadedWriter->write(block.getArrayOfReadPointers(), numSamples))
+        {
+            if (threadShouldExit())
+                break;
+
+            wait(1);
+        }
+
+        done += numSamples;
+        progress = (double)done / (double)totalSamples;
+
+        const double elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        if (elapsedSeconds > 0.0)
+            realtimeFactor = ((double)done / settings.sampleRate) / elapsedSeconds;
+
+        // Looping decks never finish, so this only ends early when nothing is left playing
+        bool allFinished = true;
+        for (auto* deck : decks)
+            allFinished = allFinished && deck->hasStreamFinished();
+
+        if (allFinished)
+            break;
+    }
+
+    // Flushes whatever is still queued and closes the file
+    threadedWriter.reset();
+    writerThread.stopThread(2000);
+
+    const double renderedSeconds = progress.load() * lengthSeconds;
+    const double elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    if (elapsedSeconds > 0.0)
+        realtimeFactor = renderedSeconds / elapsedSeconds;
+
+    if (cancelled)
+    {
+        settings.outputFile.deleteFile();
+        return juce::Result::fail("Export cancelled.");
+    }
+
+    progress = 1.0;
+    return juce::Result::ok();
+}
+
+void OfflineMixRenderer::applyDither(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    if (settings.dither == ExportDither::none || settings.bitsPerSample >= 32)
+        return;
+
+    // Quantise to the target depth here. The writer scales floats by INT_MAX, a hair short of
+    // full scale, then drops the low bits, so each level goes out as the middle of its step
+    // where neither can move it onto the next one
+    const float scale = (float)(1 << (settings.bitsPerSample - 1));
+    const float step = 1.0f / scale;
+    const bool shaped = settings.dither == ExportDither::shapedTpdf;
+
+    for (int channel = 0; channel < juce::jmin(2, buffer.getNumChannels()); ++channel)
+    {
+        float* samples = buffer.getWritePointer(channel);
+        float& error = shapingError[channel];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            // First-order error feedback moves the dither noise up, away from where the ear is most sensitive
+            const float input = shaped ? samples[i] - error : samples[i];
+
+            // Triangular noise spanning +-1 LSB
+            const float noise = (random.nextFloat() - random.nextFloat()) * step;
+            const float level = juce::jlimit(-scale, scale - 1.0f, std::round((input + noise) * scale));
+
+            if (shaped)
+                error = level * step - input;
+
+            samples[i] = (level + 0.5f) * step;
+        }
+    }
+}
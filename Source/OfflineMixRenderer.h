@@ -0,0 +1,94 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include "DeckMixEngine.h"
+
+// ============ Export Dither ============
+enum class ExportDither
+{
+    none = 0,
+    tpdf,
+    shapedTpdf
+};
+
+// ============ Offline Mix Renderer ============
+// Renders the deck mix to a WAV or FLAC file without an audio device. It builds
+// its own decks and mix engine from a snapshot of the live ones, so the same
+// loop, speed, crossfade and gain logic runs, just as fast as the CPU allows:
+// decks render in parallel on the engine's pool and a background thread
+// does the file writing.
+class OfflineMixRenderer : private juce::Thread,
+    private juce::AsyncUpdater
+{
+public:
+    struct DeckSettings
+    {
+        juce::File file;
+        double startSeconds = 0.0;
+        float gain = 1.0f;
+        bool autoGain = true;
+        float speed = 1.0f;
+        bool keyLock = false;
+        StretchQuality stretchQuality = StretchQuality::balanced;
+        ResamplerQuality resamplerQuality = ResamplerQuality::medium;
+        bool loopTrack = false;
+        double abLoopStart = -1.0;
+        double abLoopEnd = -1.0;
+        float level = 1.0f;
+        DeckMixEngine::CrossfadeSide side = DeckMixEngine::CrossfadeSide::thru;
+        bool syncLeader = false;
+        bool followsLeader = false;
+    };
+
+    struct Settings
+    {
+        juce::File outputFile;
+        double sampleRate = 44100.0;
+        int bitsPerSample = 24;     // 32 writes float WAV, which is never dithered
+        ExportDither dither = ExportDither::tpdf;
+        int blockSize = 1024;
+
+        // 0 renders until the longest non-looping deck ends
+        double lengthSeconds = 0.0;
+
+        float crossfade = 0.5f;
+        CrossfadeCurve crossfadeCurve = CrossfadeCurve::linear;
+        juce::Array<DeckSettings> decks;
+    };
+
+    // Copies the state of a live deck and its mixer channel
+    static DeckSettings captureDeck(const PlayerAudio& deck, const DeckMixEngine& engine, int deckIndex);
+
+    OfflineMixRenderer();
+    ~OfflineMixRenderer() override;
+
+    // Message thread; returns false if a render is already running
+    bool start(const Settings& settings);
+    void cancel();
+    bool isRendering() const { return isThreadRunning(); }
+
+    // Any thread, while rendering or after
+    double getProgress() const { return progress.load(); }
+    double getRealtimeFactor() const { return realtimeFactor.load(); }
+
+    // Called on the message thread once the file is closed
+    std::function<void(const juce::Result&)> onFinished;
+
+private:
+    Settings settings;
+    juce::Result result{ juce::Result::ok() };
+    std::atomic<double> progress{ 0.0 };
+    std::atomic<double> realtimeFactor{ 0.0 };
+
+    // Dither state, per output channel
+    juce::Random random;
+    float shapingError[2] = { 0.0f, 0.0f };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    juce::Result render();
+    void applyDither(juce::AudioBuffer<float>& buffer, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineMixRenderer)
+};
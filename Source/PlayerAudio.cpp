@@ -1,5 +1,18 @@
 #include "PlayerAudio.h"
 
+namespace
+{
+    // Tempo sync drift correction: speed offset per beat of phase error, and its limit
+    constexpr double syncNudgeGain = 0.1;
+    constexpr double maxSyncNudge = 0.005;
+
+    // Block-to-block smoothing of the measured phase error; reads arrive in resampler-sized pieces
+    constexpr double syncErrorSmoothing = 0.05;
+
+    // Longest a play waits for the read-ahead ring before starting anyway
+    constexpr double maxStartWaitSeconds = 0.2;
+}
+
 PlayerAudio::PlayerAudio()
 {
     formatManager.registerBasicFormats();
@@ -7,18 +20,137 @@ PlayerAudio::PlayerAudio()
 
 PlayerAudio::~PlayerAudio()
 {
+    transportSource.setSource(nullptr);
+    trackSequence.setCurrentTrack(nullptr);
 }
 
 void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
     currentSampleRate = sampleRate;
+    currentBlockSize = samplesPerBlockExpected;
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     resamplingSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // The stretcher works on the file's samples, ahead of the rate conversion
+    if (sourceSampleRate > 0.0)
+        timeStretchSource.setInputSampleRate(sourceSampleRate);
+
+    applySpeed();
 }
 
 void PlayerAudio::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    // The message thread is swapping tracks; stay silent and keep the commands for next block
+    const juce::SpinLock::ScopedTryLockType sl(trackLock);
+
+    if (!sl.isLocked())
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    commandQueue.drain([this](const DeckCommand& command) { applyCommand(command); });
+
+    if (startWhenBuffered)
+        startIfBuffered(bufferToFill.numSamples);
+
+    applySpeed();
+
+    PlayheadSnapshot snapshot;
+    snapshot.position = transportSource.getNextReadPosition();
+    const double chainDelaySamples = getChainDelaySamples();
+    snapshot.timestamp = renderTimestamp > 0.0 ? renderTimestamp : juce::Time::getMillisecondCounterHiRes();
+    renderTimestamp = 0.0;
+
+    // Everything above the looping stage counts as resampling: transport gain, stretcher and resampler
+    const auto chainStart = juce::Time::getHighResolutionTicks();
+    const auto loopedTicks = stageTicks.decode + stageTicks.loop;
     resamplingSource.getNextAudioBlock(bufferToFill);
+    stageTicks.resample += juce::Time::getHighResolutionTicks() - chainStart - (stageTicks.decode + stageTicks.loop - loopedTicks);
+
+    // The stretcher and the resampler's filter hold back part of what the transport had
+    // already handed them; at the playing speed that much file takes this long to come out
+    const double fileSamplesPerSecond = playbackSpeed * sourceSampleRate;
+    snapshot.playing = transportSource.isPlaying();
+    snapshot.streamFinished = transportSource.hasStreamFinished();
+    snapshot.samplesPerSecond = snapshot.playing ? fileSamplesPerSecond : 0.0;
+    snapshot.latencySeconds = outputLatencySeconds.load()
+        + (fileSamplesPerSecond > 0.0 ? chainDelaySamples / fileSamplesPerSecond : 0.0);
+    playhead.publish(snapshot);
+}
+
+DeckStageTicks PlayerAudio::takeStageTicks()
+{
+    const auto ticks = stageTicks;
+    stageTicks = {};
+    return ticks;
+}
+
+void PlayerAudio::applyCommand(const DeckCommand& command)
+{
+    switch (command.type)
+    {
+        case DeckCommand::Type::play:
+            startWhenBuffered = true;
+            startWaitSamples = 0;
+            break;
+
+        case DeckCommand::Type::stop:
+            startWhenBuffered = false;
+            transportSource.stop();
+            break;
+
+        case DeckCommand::Type::setGain:
+            transportSource.setGain(command.gain);
+            break;
+
+        case DeckCommand::Type::seek:
+            transportSource.setNextReadPosition(command.start);
+            timeStretchSource.reset();
+            resamplingSource.reset();
+            ++seeksApplied;
+            break;
+
+        case DeckCommand::Type::setLoopRegion:
+            // trackSequence only ever holds the tracks' looping stages
+            if (auto* track = static_cast<LoopingAudioSource*>(trackSequence.getCurrentTrack()))
+            {
+                if (command.end > command.start)
+                    track->setLoopRegion(command.start, command.end);
+                else
+                    track->clearLoopRegion();
+            }
+            break;
+
+        case DeckCommand::Type::setBeatGrid:
+            beatOrigin = command.start;
+            beatLength = command.length;
+            break;
+    }
+}
+
+void PlayerAudio::startIfBuffered(int numSamples)
+{
+    // A freshly loaded track starts from its first sample once the read-ahead thread has a
+    // couple of blocks in, rather than the transport running on over silence while the disk catches up
+    const auto* readAhead = currentTrack != nullptr ? currentTrack->readAheadSource.get() : nullptr;
+    const bool buffered = readAhead == nullptr
+        || readAhead->getNumBufferedSamples() >= juce::jmin(currentBlockSize * 2, readAhead->getNumSamplesToBuffer());
+
+    if (buffered || startWaitSamples >= maxStartWaitSeconds * currentSampleRate)
+    {
+        transportSource.start();
+        startWhenBuffered = false;
+        return;
+    }
+
+    startWaitSamples += numSamples;
+}
+
+bool PlayerAudio::postCommand(const DeckCommand& command)
+{
+    // Only fills up if the audio device has stopped calling us; the command is dropped then
+    return commandQueue.push(command);
 }
 
 void PlayerAudio::releaseResources()
@@ -29,60 +161,487 @@ void PlayerAudio::releaseResources()
 
 bool PlayerAudio::loadFile(const juce::File& file)
 {
-    if (file.existsAsFile())
+    if (auto track = createTrack(file))
     {
-        auto* reader = formatManager.createReaderFor(file);
-        if (reader != nullptr)
+        std::unique_ptr<DeckTrack> oldTrack, oldQueuedTrack;
+
         {
-            transportSource.stop();
+            const juce::SpinLock::ScopedLockType sl(trackLock);
             transportSource.setSource(nullptr);
-            readerSource.reset();
+            trackSequence.takeFinishedTrack();
+            cancelQueuedFile();
+            oldQueuedTrack = std::move(queuedTrack);
+            oldTrack = std::move(currentTrack);
 
-            readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
-            transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate);
-
-            return true;
+            currentTrack = std::move(track);
+            attachCurrentTrack();
+            timeStretchSource.reset();
+            resamplingSource.reset();
         }
+
+        // Tear the old chain down; the new one buffers in the background, and a play waits for it on the audio thread
+        oldTrack.reset();
+        oldQueuedTrack.reset();
+
+        // Measured files are levelled straight away; others as soon as their analysis lands
+        trackAnalyzer->requestAnalysis(file);
+        updateNormalisationGain();
+        updateBeatGrid();
+
+        return true;
     }
     return false;
 }
 
 void PlayerAudio::play()
 {
-    transportSource.start();
+    postCommand({ DeckCommand::Type::play });
+
+    // A seek made while stopped is only picked up by the read-ahead thread's slow poll
+    if (currentTrack != nullptr)
+        currentTrack->readAheadSource->expectJump();
+
+    // The meters' thread sleeps while everything is silent; play() never runs on the audio thread, so it is woken here
+    analysisThread->wake();
 }
 
 void PlayerAudio::stop()
 {
-    transportSource.stop();
+    postCommand({ DeckCommand::Type::stop });
 }
 
 void PlayerAudio::setGain(float gain)
 {
-    transportSource.setGain(gain);
+    currentGain = gain;
+    postGain();
+}
+
+void PlayerAudio::postGain()
+{
+    DeckCommand command{ DeckCommand::Type::setGain };
+    command.gain = currentGain * normalisationGain;
+    postCommand(command);
+}
+
+void PlayerAudio::setAutoGain(bool shouldNormalise)
+{
+    autoGainEnabled = shouldNormalise;
+    updateNormalisationGain();
+}
+
+void PlayerAudio::updateNormalisationGain()
+{
+    LoudnessInfo info;
+    const float newGain = autoGainEnabled && getLoudnessInfo(info)
+        ? juce::Decibels::decibelsToGain((float)info.getNormalisationGainDb()) : 1.0f;
+
+    if (newGain != normalisationGain)
+    {
+        normalisationGain = newGain;
+        postGain();
+    }
+}
+
+bool PlayerAudio::getLoudnessInfo(LoudnessInfo& info) const
+{
+    return currentTrack != nullptr && trackAnalyzer->findLoudness(currentTrack->file, info);
+}
+
+void PlayerAudio::updateBeatGrid()
+{
+    BeatGrid grid;
+    DeckCommand command{ DeckCommand::Type::setBeatGrid };
+
+    if (getBeatGrid(grid) && grid.isValid())
+    {
+        command.start = (juce::int64)std::llround(grid.firstBeatSeconds * currentTrack->sampleRate);
+        command.length = grid.getBeatLengthSeconds() * currentTrack->sampleRate;
+    }
+
+    if (command.start != postedBeatOrigin || command.length != postedBeatLength)
+    {
+        if (postCommand(command))
+        {
+            postedBeatOrigin = command.start;
+            postedBeatLength = command.length;
+        }
+    }
+}
+
+bool PlayerAudio::getBeatGrid(BeatGrid& grid) const
+{
+    return currentTrack != nullptr && trackAnalyzer->findBeatGrid(currentTrack->file, grid);
+}
+
+bool PlayerAudio::getBeatClock(double& beatPosition, double& beatsPerOutputSample)
+{
+    const juce::SpinLock::ScopedTryLockType sl(trackLock);
+
+    if (!sl.isLocked() || beatLength <= 0.0 || !transportSource.isPlaying())
+        return false;
+
+    // The sample being heard, not the one the transport reads next: a key-locked deck's
+    // stretcher and either deck's resampler hold back different amounts
+    const double playedPosition = (double)transportSource.getNextReadPosition() - getChainDelaySamples();
+    beatPosition = (playedPosition - (double)beatOrigin) / beatLength;
+    beatsPerOutputSample = playbackSpeed * (sourceSampleRate / currentSampleRate) / beatLength;
+    return true;
+}
+
+void PlayerAudio::followBeatClock(double leaderBeat, double leaderBeatsPerOutputSample)
+{
+    const juce::SpinLock::ScopedTryLockType sl(trackLock);
+
+    if (!sl.isLocked())
+        return;
+
+    if (beatLength <= 0.0 || sourceSampleRate <= 0.0 || !transportSource.isPlaying())
+    {
+        releaseTempoSync();
+        return;
+    }
+
+    // The speed at which this deck's beats last exactly as long as the leader's
+    double speed = leaderBeatsPerOutputSample * beatLength * currentSampleRate / sourceSampleRate;
+
+    const double playedPosition = (double)transportSource.getNextReadPosition() - getChainDelaySamples();
+    double phaseError = leaderBeat - (playedPosition - (double)beatOrigin) / beatLength;
+    phaseError -= std::round(phaseError);
+
+    if (syncSpeed <= 0.0)
+    {
+        // Engaging: jump onto the leader's phase, to the sample, at this block boundary. The
+        // resets below empty the resampler, so only the stretcher's delay is read ahead again.
+        const auto target = (juce::int64)std::llround(playedPosition + phaseError * beatLength)
+            + timeStretchSource.getLatencySamples();
+
+        if (target >= 0 && target < transportSource.getTotalLength())
+        {
+            transportSource.setNextReadPosition(target);
+            timeStretchSource.reset();
+            resamplingSource.reset();
+        }
+
+        syncPhaseError = 0.0;
+    }
+    else
+    {
+        // Holding: a small speed offset pulls back whatever drift the reads have picked up
+        syncPhaseError += (phaseError - syncPhaseError) * syncErrorSmoothing;
+        speed *= 1.0 + juce::jlimit(-maxSyncNudge, maxSyncNudge, syncPhaseError * syncNudgeGain);
+    }
+
+    syncSpeed = juce::jlimit(TimeStretchAudioSource::minRatio, TimeStretchAudioSource::maxRatio, speed);
+    tempoSyncedState = true;
+}
+
+void PlayerAudio::releaseTempoSync()
+{
+    // The requested speed takes over again on the next block
+    syncSpeed = 0.0;
+    tempoSyncedState = false;
 }
 
 void PlayerAudio::setSpeed(float speed)
 {
-    resamplingSource.setResamplingRatio(speed);
+    // Applied by the audio thread at the start of the next block, unless tempo sync owns the speed
+    currentSpeed = (float)juce::jlimit(TimeStretchAudioSource::minRatio, TimeStretchAudioSource::maxRatio, (double)speed);
+}
+
+void PlayerAudio::setKeyLock(bool shouldLockKey)
+{
+    keyLockEnabled = shouldLockKey;
+}
+
+void PlayerAudio::setStretchQuality(StretchQuality quality)
+{
+    timeStretchSource.setQuality(quality);
+}
+
+void PlayerAudio::setResamplerQuality(ResamplerQuality quality)
+{
+    resamplingSource.setQuality(quality);
+}
+
+void PlayerAudio::applySpeed()
+{
+    // The resampler also converts the file's rate to the device's, so it only
+    // bypasses when both match and the speed change goes through the stretcher
+    const double rateRatio = sourceSampleRate > 0.0 ? sourceSampleRate / currentSampleRate : 1.0;
+    playbackSpeed = syncSpeed > 0.0 ? syncSpeed : (double)currentSpeed.load();
+
+    if (keyLockEnabled.load())
+    {
+        timeStretchSource.setStretchRatio(playbackSpeed);
+        resamplingSource.setResamplingRatio(rateRatio);
+    }
+    else
+    {
+        timeStretchSource.setStretchRatio(1.0);
+        resamplingSource.setResamplingRatio(playbackSpeed * rateRatio);
+    }
+
+    playbackSpeedState = (float)playbackSpeed;
+}
+
+double PlayerAudio::getChainDelaySamples() const
+{
+    // In file samples: the resampler's input is the stretcher's output, which moves at the stretch ratio
+    return (double)timeStretchSource.getLatencySamples()
+        + resamplingSource.getLatencyInputSamples() * timeStretchSource.getStretchRatio();
 }
 
 void PlayerAudio::setPosition(double pos)
 {
     if (pos >= 0.0 && pos <= getLength())
     {
-        transportSource.setPosition(pos);
+        // The transport runs at the file's own rate; conversion happens in the resampler
+        DeckCommand command{ DeckCommand::Type::seek };
+        command.start = (juce::int64)(pos * sourceSampleRate);
+
+        // Report the target until the audio thread has caught up with it
+        if (postCommand(command))
+        {
+            pendingSeekPosition = pos;
+            ++seeksIssued;
+
+            // The audio thread only stores the new position; the read-ahead thread is hurried from here
+            if (currentTrack != nullptr)
+                currentTrack->readAheadSource->expectJump();
+        }
     }
 }
 
 double PlayerAudio::getPosition() const
 {
-    return transportSource.getCurrentPosition();
+    if (seeksApplied.load() != seeksIssued)
+        return pendingSeekPosition;
+
+    return sourceSampleRate > 0.0 ? (double)playhead.read().position / sourceSampleRate : 0.0;
+}
+
+double PlayerAudio::getAudiblePosition() const
+{
+    if (seeksApplied.load() != seeksIssued)
+        return pendingSeekPosition;
+
+    if (sourceSampleRate <= 0.0)
+        return 0.0;
+
+    const auto snapshot = playhead.read();
+    const double position = snapshot.getAudiblePosition(juce::Time::getMillisecondCounterHiRes()) / sourceSampleRate;
+    return juce::jlimit(0.0, getLength(), position);
 }
 
 double PlayerAudio::getLength() const
 {
-    return transportSource.getLengthInSeconds();
+    return sourceSampleRate > 0.0 ? (double)transportSource.getTotalLength() / sourceSampleRate : 0.0;
+}
+
+void PlayerAudio::setLooping(bool shouldLoop)
+{
+    wholeTrackLooping = shouldLoop;
+    updateLoopRegion();
+}
+
+void PlayerAudio::setABLoop(double startSeconds, double endSeconds)
+{
+    abLoopStart = startSeconds;
+    abLoopEnd = endSeconds;
+    updateLoopRegion();
+}
+
+void PlayerAudio::clearABLoop()
+{
+    abLoopStart = -1.0;
+    abLoopEnd = -1.0;
+    updateLoopRegion();
+}
+
+void PlayerAudio::updateLoopRegion()
+{
+    if (currentTrack == nullptr)
+        return;
+
+    const auto length = currentTrack->loopingSource->getTotalLength();
+    DeckCommand command{ DeckCommand::Type::setLoopRegion };
+
+    // An A-B loop takes priority over looping the whole track; an empty region clears it
+    if (abLoopStart >= 0.0 && abLoopEnd > abLoopStart)
+    {
+        command.start = juce::jmin(length, (juce::int64)(abLoopStart * sourceSampleRate));
+        command.end = juce::jmin(length, (juce::int64)(abLoopEnd * sourceSampleRate));
+    }
+    else if (wholeTrackLooping)
+    {
+        command.end = length;
+    }
+
+    // The audio thread sets its own loop from the command; the preroll is asked for from
+    // here, so the read-ahead thread is woken without the callback touching its lock
+    postCommand(command);
+    currentTrack->loopingSource->requestPreroll(command.start, command.end);
+}
+
+bool PlayerAudio::queueNextFile(const juce::File& file)
+{
+    cancelQueuedFile();
+
+    if (currentTrack == nullptr || queuedTrack != nullptr)
+        return false;
+
+    auto track = createTrack(file);
+
+    // The resampler converts a single source rate, so only matching files can be spliced
+    if (track == nullptr || track->sampleRate != sourceSampleRate)
+        return false;
+
+    queuedTrack = std::move(track);
+    trackSequence.queueNextTrack(queuedTrack->loopingSource.get());
+    return true;
+}
+
+void PlayerAudio::cancelQueuedFile()
+{
+    // If the audio thread already spliced it in, handleTrackChange() adopts it instead
+    if (queuedTrack != nullptr && trackSequence.unqueueNextTrack(queuedTrack->loopingSource.get()))
+        queuedTrack.reset();
+}
+
+bool PlayerAudio::handleTrackChange()
+{
+    auto* finished = trackSequence.takeFinishedTrack();
+
+    if (finished == nullptr)
+        return false;
+
+    jassert(queuedTrack != nullptr && currentTrack != nullptr
+        && finished == currentTrack->loopingSource.get());
+
+    // The audio thread has moved on, so the old track can be torn down here
+    currentTrack = std::move(queuedTrack);
+    abLoopStart = -1.0;
+    abLoopEnd = -1.0;
+    updateLoopRegion();
+    trackAnalyzer->requestAnalysis(currentTrack->file);
+    updateNormalisationGain();
+    updateBeatGrid();
+
+    return true;
+}
+
+juce::File PlayerAudio::getCurrentFile() const
+{
+    return currentTrack != nullptr ? currentTrack->file : juce::File();
+}
+
+void PlayerAudio::setReadAheadSize(int numSamples)
+{
+    if (numSamples == readAheadSamples)
+        return;
+
+    readAheadSamples = numSamples;
+
+    if (currentTrack != nullptr)
+    {
+        const bool wasPlaying = isPlaying();
+        const double pos = getPosition();
+
+        {
+            const juce::SpinLock::ScopedLockType sl(trackLock);
+            transportSource.setSource(nullptr);
+            handleTrackChange();
+            cancelQueuedFile();
+            queuedTrack.reset();
+
+            currentTrack->loopingSource.reset();
+            currentTrack->readAheadSource.reset();
+            buildTrackChain(*currentTrack);
+
+            attachCurrentTrack();
+        }
+
+        setPosition(pos);
+
+        if (wasPlaying)
+            play();
+    }
+}
+
+juce::uint32 PlayerAudio::getUnderrunCount() const
+{
+    return currentTrack != nullptr ? currentTrack->readAheadSource->getUnderrunCount() : 0;
+}
+
+void PlayerAudio::resetUnderrunCount()
+{
+    if (currentTrack != nullptr)
+        currentTrack->readAheadSource->resetUnderrunCount();
+}
+
+std::unique_ptr<PlayerAudio::DeckTrack> PlayerAudio::createTrack(const juce::File& file)
+{
+    if (!file.existsAsFile())
+        return nullptr;
+
+    auto track = std::make_unique<DeckTrack>();
+    track->file = file;
+
+    if (auto decoded = trackCache->find(file))
+    {
+        // Already decoded in RAM: no reader, no I/O when it plays or seeks
+        track->sampleRate = decoded->getSampleRate();
+        track->numChannels = juce::jmax(2, decoded->getNumChannels());
+        track->memoryResident = true;
+        track->fileSource = std::make_unique<CachedTrackSource>(decoded);
+    }
+    else
+    {
+        // Compressed files with a seek index jump straight to the right frame
+        auto* reader = seekIndexes->createReaderFor(formatManager, file);
+        if (reader == nullptr)
+            return nullptr;
+
+        track->sampleRate = reader->sampleRate;
+        track->numChannels = juce::jmax(2, (int)reader->numChannels);
+        track->fileSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+
+        // Stream this time; decode it in the background so the next load is instant
+        trackCache->requestDecode(file);
+    }
+
+    buildTrackChain(*track);
+    return track;
+}
+
+void PlayerAudio::buildTrackChain(DeckTrack& track)
+{
+    // All decoding happens on the shared read-ahead thread; the transport only sees the ring
+    track.readAheadSource = std::make_unique<DeckReadAheadSource>(track.fileSource.get(), false,
+        *readAheadThread, readAheadSamples, track.numChannels, track.memoryResident || nonRealtime);
+    track.loopingSource = std::make_unique<LoopingAudioSource>(*track.readAheadSource);
+    track.loopingSource->setStageTicks(&stageTicks);
+}
+
+bool PlayerAudio::isTrackMemoryResident() const
+{
+    return currentTrack != nullptr && currentTrack->memoryResident;
+}
+
+void PlayerAudio::attachCurrentTrack()
+{
+    sourceSampleRate = currentTrack->sampleRate;
+    timeStretchSource.setInputSampleRate(sourceSampleRate);
+    trackSequence.setCurrentTrack(currentTrack->loopingSource.get());
+    updateLoopRegion();
+
+    transportSource.setSource(&trackSequence);
+    applySpeed();
+
+    // The callback can't publish while trackLock is held, so this is the only writer
+    PlayheadSnapshot stopped;
+    stopped.timestamp = juce::Time::getMillisecondCounterHiRes();
+    playhead.publish(stopped);
 }
 
 juce::StringPairArray PlayerAudio::getMetadata(const juce::File& file)
@@ -90,7 +649,8 @@ juce::StringPairArray PlayerAudio::getMetadata(const juce::File& file)
     juce::StringPairArray data;
     if (file.existsAsFile())
     {
-        auto* reader = formatManager.createReaderFor(file);
+        // Only the header is parsed; a mapped reader maps nothing until samples are read
+        auto* reader = MappedAudioReader::createReaderFor(formatManager, file);
         if (reader != nullptr)
         {
             data = reader->metadataValues;
@@ -1,5 +1,18 @@
 #pragma once
 #include <JuceHeader.h>
+#include "DeckReadAheadSource.h"
+#include "MappedAudioReader.h"
+#include "DecodedTrackCache.h"
+#include "Mp3SeekIndex.h"
+#include "TrackAnalyzer.h"
+#include "LoopingAudioSource.h"
+#include "GaplessTrackSource.h"
+#include "DeckTransportSource.h"
+#include "DeckCommandQueue.h"
+#include "DeckPlayhead.h"
+#include "TimeStretchAudioSource.h"
+#include "PolyphaseResamplingSource.h"
+#include "SignalAnalyser.h"
 
 class PlayerAudio
 {
@@ -12,6 +25,10 @@ public:
     void releaseResources();
 
     bool loadFile(const juce::File& file);
+
+    // Transport and loop changes are queued and applied at the start of the next block (a play
+    // once the track has a couple of blocks read ahead); the state getters read what the audio
+    // thread last published
     void play();
     void stop();
     void setGain(float gain);
@@ -19,16 +36,173 @@ public:
     void setPosition(double pos);
     double getPosition() const;
     double getLength() const;
+    float getGain() const { return currentGain; }
+    float getSpeed() const { return currentSpeed; }
+    bool isPlaying() const { return playhead.read().playing; }
+    bool hasStreamFinished() const { return playhead.read().streamFinished; }
+
+    // What is coming out of the speakers right now: the last published block moved on by the
+    // time since it was rendered, less the output latency. For drawing; getPosition() for seeking.
+    double getAudiblePosition() const;
+    PlayheadSnapshot getPlayhead() const { return playhead.read(); }
+
+    // Any thread: device output latency plus one buffer, in seconds; set when the device starts
+    void setOutputLatency(double seconds) { outputLatencySeconds = seconds; }
+
+    // Audio thread, before each getNextAudioBlock(): when the block will start playing, as a
+    // juce::Time::getMillisecondCounterHiRes() value; the mixer renders long buffers in pieces
+    void setRenderTimestamp(double milliseconds) { renderTimestamp = milliseconds; }
+
+    // Key lock: speed changes tempo through the time-stretcher and leaves pitch alone
+    void setKeyLock(bool shouldLockKey);
+    bool isKeyLockEnabled() const { return keyLockEnabled.load(); }
+    void setStretchQuality(StretchQuality quality);
+    StretchQuality getStretchQuality() const { return timeStretchSource.getQuality(); }
+
+    // Resampler used for varispeed and for files at a different rate to the device
+    void setResamplerQuality(ResamplerQuality quality);
+    ResamplerQuality getResamplerQuality() const { return resamplingSource.getQuality(); }
+
+    // Looping, applied at the exact sample inside the source chain
+    void setLooping(bool shouldLoop);
+    void setABLoop(double startSeconds, double endSeconds);
+    void clearABLoop();
+    bool isLoopingTrack() const { return wholeTrackLooping; }
+    double getABLoopStart() const { return abLoopStart; }
+    double getABLoopEnd() const { return abLoopEnd; }
+
+    // Gapless playback: the next file is opened and buffered in the background,
+    // then spliced in right after the current track's last sample
+    bool queueNextFile(const juce::File& file);
+    void cancelQueuedFile();
+    bool handleTrackChange();
+    juce::File getCurrentFile() const;
+
+    // Read-ahead buffering (samples of decoded audio kept ahead of the play head)
+    void setReadAheadSize(int numSamples);
+    int getReadAheadSize() const { return readAheadSamples; }
+    juce::uint32 getUnderrunCount() const;
+    void resetUnderrunCount();
+
+    // Loudness normalisation: on load (and when the analysis of the current file
+    // arrives) the deck gain is scaled to bring the track to the reference level
+    void setAutoGain(bool shouldNormalise);
+    bool isAutoGainEnabled() const { return autoGainEnabled; }
+    void updateNormalisationGain();
+    bool getLoudnessInfo(LoudnessInfo& info) const;
+
+    // Beat grid of the current file; the audio thread gets it (in file samples) once it's analysed
+    void updateBeatGrid();
+    bool getBeatGrid(BeatGrid& grid) const;
+
+    // Loudness and beat grid analysis shared by every deck
+    TrackAnalyzer& getTrackAnalyzer() { return *trackAnalyzer; }
+
+    // Speed the deck is actually playing at, which tempo sync may have taken over
+    float getPlaybackSpeed() const { return playbackSpeedState.load(); }
+    bool isTempoSynced() const { return tempoSyncedState.load(); }
+
+    // Tempo sync, called by the mix engine on the audio thread before the deck renders a block.
+    // A follower matches the leader's beats per output sample, jumps onto its beat phase on the
+    // first block and nudges its speed to hold it after that.
+    bool getBeatClock(double& beatPosition, double& beatsPerOutputSample);
+    void followBeatClock(double leaderBeat, double leaderBeatsPerOutputSample);
+    void releaseTempoSync();
+
+    // Audio thread, after getNextAudioBlock(): the time each stage of the chain took since the last call
+    DeckStageTicks takeStageTicks();
+
+    // Offline rendering: set before loading a file so the deck reads it inline instead of
+    // through the read-ahead thread, and never plays silence while it waits for the disk
+    void setNonRealtime(bool shouldBeNonRealtime) { nonRealtime = shouldBeNonRealtime; }
+
+    // Decoded-track cache shared by every deck
+    bool isTrackMemoryResident() const;
+    DecodedTrackCache& getTrackCache() { return *trackCache; }
 
     juce::StringPairArray getMetadata(const juce::File& file);
 
 private:
+    // One opened file: reader (or cached decode) -> read-ahead ring -> looping stage
+    struct DeckTrack
+    {
+        juce::File file;
+        double sampleRate = 0.0;
+        int numChannels = 2;
+        bool memoryResident = false;
+        std::unique_ptr<juce::PositionableAudioSource> fileSource;
+        std::unique_ptr<DeckReadAheadSource> readAheadSource;
+        std::unique_ptr<LoopingAudioSource> loopingSource;
+    };
+
     juce::AudioFormatManager formatManager;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
-    juce::AudioTransportSource transportSource;
-    juce::ResamplingAudioSource resamplingSource{ &transportSource, false, 2 };
+    juce::SharedResourcePointer<DeckReadAheadThread> readAheadThread;
+    juce::SharedResourcePointer<DecodedTrackCache> trackCache;
+    juce::SharedResourcePointer<SeekIndexCache> seekIndexes;
+    juce::SharedResourcePointer<TrackAnalyzer> trackAnalyzer;
+    juce::SharedResourcePointer<SignalAnalysisThread> analysisThread;
+    std::unique_ptr<DeckTrack> currentTrack;
+    std::unique_ptr<DeckTrack> queuedTrack;
+    GaplessTrackSource trackSequence;
+    DeckTransportSource transportSource;
+    TimeStretchAudioSource timeStretchSource{ &transportSource, false, 2 };
+    PolyphaseResamplingSource resamplingSource{ &timeStretchSource, false, 2 };
 
     double currentSampleRate = 44100.0;
+    int currentBlockSize = 512;
+    int readAheadSamples = 32768;
+    double sourceSampleRate = 0.0;
+    std::atomic<float> currentSpeed{ 1.0f };
+    float currentGain = 1.0f;
+    float normalisationGain = 1.0f;
+    bool autoGainEnabled = true;
+    std::atomic<bool> keyLockEnabled{ false };
+    bool nonRealtime = false;
+
+    // GUI -> audio thread commands, and the state the audio thread publishes back
+    DeckCommandQueue commandQueue;
+    DeckPlayhead playhead;
+    std::atomic<double> outputLatencySeconds{ 0.0 };
+    double renderTimestamp = 0.0;
+    DeckStageTicks stageTicks;
+    std::atomic<juce::uint32> seeksApplied{ 0 };
+    juce::uint32 seeksIssued = 0;
+    double pendingSeekPosition = 0.0;
+
+    // Audio thread: a play command waiting for the read-ahead ring to fill
+    bool startWhenBuffered = false;
+    int startWaitSamples = 0;
+
+    // Beat grid as last posted, so repeated analysis notifications don't flood the queue
+    juce::int64 postedBeatOrigin = 0;
+    double postedBeatLength = -1.0;
+
+    // Audio thread: grid in file samples, the speed being played, and the one sync imposes (0 when free)
+    juce::int64 beatOrigin = 0;
+    double beatLength = 0.0;
+    double playbackSpeed = 1.0;
+    double syncSpeed = 0.0;
+    double syncPhaseError = 0.0;
+    std::atomic<float> playbackSpeedState{ 1.0f };
+    std::atomic<bool> tempoSyncedState{ false };
+
+    // Held by the message thread while it rewires the chain; the callback only try-locks it
+    juce::SpinLock trackLock;
+
+    bool wholeTrackLooping = false;
+    double abLoopStart = -1.0;
+    double abLoopEnd = -1.0;
+
+    std::unique_ptr<DeckTrack> createTrack(const juce::File& file);
+    void buildTrackChain(DeckTrack& track);
+    void attachCurrentTrack();
+    void updateLoopRegion();
+    bool postCommand(const DeckCommand& command);
+    void postGain();
+    void applyCommand(const DeckCommand& command);
+    void startIfBuffered(int numSamples);
+    void applySpeed();
+    double getChainDelaySamples() const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerAudio)
 };
@@ -1,14 +1,79 @@
 #include "PlayerGUI.h"
 
 // ============ WaveformDisplay Implementation ============
+namespace
+{
+    // Deepest zoom: 16 pixels per sample
+    constexpr double minSamplesPerPixel = 1.0 / 16.0;
+}
+
 WaveformDisplay::WaveformDisplay(PlayerAudio& audio)
-    : playerAudio(audio), thumbnailCache(5), thumbnail(512, formatManager, thumbnailCache)
+    : playerAudio(audio)
 {
-    formatManager.registerBasicFormats();
-    startTimer(40); // 25 FPS update
+    setOpaque(true);
 }
 
 void WaveformDisplay::paint(juce::Graphics& g)
+{
+    const auto paintStart = juce::Time::getHighResolutionTicks();
+
+    if (fullRepaint)
+    {
+        paintStaticLayers(g);
+    }
+    else
+    {
+        // Everything but the play head comes from the cached image, redrawn only when it's stale
+        const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const int imageWidth = juce::jmax(1, juce::roundToInt(getWidth() * scale));
+        const int imageHeight = juce::jmax(1, juce::roundToInt(getHeight() * scale));
+
+        if (!staticLayersValid || staticLayers.getWidth() != imageWidth || staticLayers.getHeight() != imageHeight)
+        {
+            if (staticLayers.getWidth() != imageWidth || staticLayers.getHeight() != imageHeight)
+                staticLayers = juce::Image(juce::Image::RGB, imageWidth, imageHeight, false);
+
+            juce::Graphics imageGraphics(staticLayers);
+            imageGraphics.addTransform(juce::AffineTransform::scale((float)imageWidth / juce::jmax(1, getWidth()),
+                (float)imageHeight / juce::jmax(1, getHeight())));
+            paintStaticLayers(imageGraphics);
+            staticLayersValid = true;
+        }
+
+        g.drawImage(staticLayers, getLocalBounds().toFloat());
+    }
+
+    if (getTotalLength() > 0.0)
+    {
+        const auto bounds = getLocalBounds();
+        const auto area = bounds.reduced(4);
+
+        // Progress overlay (played portion)
+        const float progressX = juce::jlimit((float)area.getX(), (float)area.getRight(), timeToX(currentPosition));
+        g.setColour(Colour(0xff00d4ff).withAlpha(0.3f));
+        g.fillRect(4.0f, 4.0f, progressX - 4.0f, (float)bounds.getHeight() - 8.0f);
+
+        // Current position line (red), unless it's scrolled out of view
+        if (currentPosition >= viewStart && currentPosition <= viewStart + getViewLength())
+        {
+            g.setColour(Colour(0xffff6b6b));
+            g.drawLine(progressX, 0, progressX, (float)bounds.getHeight(), 3.0f);
+        }
+    }
+
+    const double milliseconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - paintStart) * 1000.0;
+    auto& average = averagePaintMilliseconds[fullRepaint ? 1 : 0];
+    average = average * 0.9 + milliseconds * 0.1;
+}
+
+void WaveformDisplay::setFullRepaint(bool shouldRepaintAll)
+{
+    fullRepaint = shouldRepaintAll;
+    staticLayers = {};
+    invalidateStaticLayers();
+}
+
+void WaveformDisplay::paintStaticLayers(juce::Graphics& g)
 {
     auto bounds = getLocalBounds();
 
@@ -21,76 +86,267 @@ void WaveformDisplay::paint(juce::Graphics& g)
     g.setColour(Colours::lightgrey.withAlpha(0.3f));
     g.drawRect(bounds, 2);
 
+    if (getTotalLength() <= 0.0)
+    {
+        // No audio loaded message
+        g.setColour(Colours::grey);
+        g.setFont(16.0f);
+        g.drawText("Load an audio file to see waveform", bounds, Justification::centred);
+        return;
+    }
+
     // Waveform
-    if (thumbnail.getTotalLength() > 0.0)
+    auto area = bounds.reduced(4);
+    const double samplesPerPixel = getViewLength() * pyramid->getSampleRate() / juce::jmax(1, area.getWidth());
+
+    renderedReadyBins = pyramid->getNumReadyBins(0);
+    renderedPreviewLevel = pyramid->getPreviewLevel();
+
+    // Finer than the pyramid goes: the few samples on screen, once they've been decoded;
+    // until then the finest level stands in
+    const bool drewSamples = samplesPerPixel < WaveformPyramid::baseSamplesPerBin
+        && drawSamples(g, area, samplesPerPixel);
+
+    if (!drewSamples && (renderedReadyBins > 0 || renderedPreviewLevel >= 0))
     {
-        // Draw waveform
-        g.setColour(Colour(0xff0f3460));
-        thumbnail.drawChannels(g, bounds.reduced(4), 0.0, thumbnail.getTotalLength(), 1.0f);
+        const int level = pyramid->getLevelFor(samplesPerPixel);
+        const int laneHeight = area.getHeight() / pyramid->getNumChannels();
 
-        // Progress overlay (played portion)
-        double progress = currentPosition / thumbnail.getTotalLength();
-        int progressX = (int)(progress * bounds.getWidth());
-        g.setColour(Colour(0xff00d4ff).withAlpha(0.3f));
-        g.fillRect(4, 4, progressX - 4, bounds.getHeight() - 8);
+        for (int channel = 0; channel < pyramid->getNumChannels(); ++channel)
+            drawPeaks(g, { area.getX(), area.getY() + channel * laneHeight, area.getWidth(), laneHeight },
+                channel, level, samplesPerPixel);
+    }
+    else if (!drewSamples)
+    {
+        g.setColour(Colours::grey);
+        g.setFont(14.0f);
+        g.drawText("Building waveform...", bounds, Justification::centred);
+    }
 
-        // A-B Loop markers
-        if (hasABLoop && loopPointA >= 0 && loopPointB > loopPointA)
-        {
-            double totalLength = thumbnail.getTotalLength();
-            int xA = (int)((loopPointA / totalLength) * bounds.getWidth());
-            int xB = (int)((loopPointB / totalLength) * bounds.getWidth());
-
-            // Loop region highlight
-            g.setColour(Colours::orange.withAlpha(0.3f));
-            g.fillRect(xA, 0, xB - xA, bounds.getHeight());
-
-            // A and B markers
-            g.setColour(Colours::orange);
-            g.drawLine((float)xA, 0, (float)xA, (float)bounds.getHeight(), 2.0f);
-            g.drawLine((float)xB, 0, (float)xB, (float)bounds.getHeight(), 2.0f);
-
-            g.setFont(Font(14.0f, Font::bold));
-            g.drawText("A", xA + 5, 5, 20, 20, Justification::left);
-            g.drawText("B", xB - 25, 5, 20, 20, Justification::left);
-        }
+    // A-B Loop markers
+    if (hasABLoop && loopPointA >= 0 && loopPointB > loopPointA)
+    {
+        const float xA = timeToX(loopPointA);
+        const float xB = timeToX(loopPointB);
 
-        // Markers
-        double totalLength = thumbnail.getTotalLength();
-        for (const auto& marker : markers)
+        // Loop region highlight
+        g.setColour(Colours::orange.withAlpha(0.3f));
+        g.fillRect(xA, 0.0f, xB - xA, (float)bounds.getHeight());
+
+        // A and B markers
+        g.setColour(Colours::orange);
+        g.drawLine(xA, 0, xA, (float)bounds.getHeight(), 2.0f);
+        g.drawLine(xB, 0, xB, (float)bounds.getHeight(), 2.0f);
+
+        g.setFont(Font(14.0f, Font::bold));
+        g.drawText("A", (int)xA + 5, 5, 20, 20, Justification::left);
+        g.drawText("B", (int)xB - 25, 5, 20, 20, Justification::left);
+    }
+
+    // Markers
+    for (const auto& marker : markers)
+    {
+        const float x = timeToX(marker.timePosition);
+
+        // Marker dot
+        g.setColour(marker.colour);
+        g.fillEllipse(x - 4.0f, (float)(bounds.getHeight() / 2 - 4), 8, 8);
+
+        // Marker line
+        g.setColour(marker.colour.withAlpha(0.6f));
+        g.drawLine(x, 0, x, (float)bounds.getHeight(), 1.5f);
+    }
+}
+
+void WaveformDisplay::invalidateStaticLayers()
+{
+    staticLayersValid = false;
+    repaint();
+}
+
+void WaveformDisplay::drawPeaks(juce::Graphics& g, juce::Rectangle<int> area, int channel, int level, double samplesPerPixel)
+{
+    // The level's bins are at most a pixel wide, so each column merges one or two of them
+    const double samplesPerBin = (double)WaveformPyramid::getSamplesPerBin(level);
+    const double binsPerPixel = samplesPerPixel / samplesPerBin;
+    const double firstBin = viewStart * pyramid->getSampleRate() / samplesPerBin;
+    const float centreY = (float)area.getCentreY();
+    const float halfHeight = area.getHeight() * 0.5f;
+
+    // Still building: past the bins read so far, the preview's bins stand in, dimmed
+    const int previewLevel = pyramid->getPreviewLevel();
+    const double previewScale = previewLevel >= 0 ? samplesPerBin / (double)WaveformPyramid::getSamplesPerBin(previewLevel) : 0.0;
+
+    for (int x = 0; x < area.getWidth(); ++x)
+    {
+        const double start = firstBin + x * binsPerPixel;
+        const double end = firstBin + (x + 1) * binsPerPixel;
+        const int startBin = (int)start;
+        const int endBin = juce::jmax(startBin + 1, (int)end);
+        float low, high, rms;
+        float alpha = 1.0f;
+
+        if (!pyramid->getPeaks(level, channel, startBin, endBin, low, high, rms))
         {
-            int x = (int)((marker.timePosition / totalLength) * bounds.getWidth());
+            const int previewStart = (int)(start * previewScale);
 
-            // Marker dot
-            g.setColour(marker.colour);
-            g.fillEllipse((float)(x - 4), (float)(bounds.getHeight() / 2 - 4), 8, 8);
+            if (previewLevel < 0
+                || !pyramid->getPreviewPeaks(channel, previewStart, juce::jmax(previewStart + 1, (int)(end * previewScale)), low, high, rms))
+                continue;
 
-            // Marker line
-            g.setColour(marker.colour.withAlpha(0.6f));
-            g.drawLine((float)x, 0, (float)x, (float)bounds.getHeight(), 1.5f);
+            alpha = 0.4f;
         }
 
-        // Current position line (red)
-        g.setColour(Colour(0xffff6b6b));
-        g.drawLine((float)progressX, 0, (float)progressX, (float)bounds.getHeight(), 3.0f);
+        const float left = (float)(area.getX() + x);
+
+        g.setColour(Colour(0xff0f3460).withMultipliedAlpha(alpha));
+        g.fillRect(left, centreY - high * halfHeight, 1.0f, juce::jmax(1.0f, (high - low) * halfHeight));
+
+        g.setColour(Colour(0xff1d5c9c).withMultipliedAlpha(alpha));
+        g.fillRect(left, centreY - rms * halfHeight, 1.0f, rms * 2.0f * halfHeight);
     }
-    else
+}
+
+// False while the samples on screen are still being decoded
+bool WaveformDisplay::drawSamples(juce::Graphics& g, juce::Rectangle<int> area, double samplesPerPixel)
+{
+    const double sampleRate = pyramid->getSampleRate();
+    const double viewStartSample = viewStart * sampleRate;
+    const auto firstSample = (juce::int64)viewStartSample;
+    const auto numSamples = (int)juce::jmin((juce::int64)(area.getWidth() * samplesPerPixel) + 2,
+        pyramid->getLengthInSamples() - firstSample);
+
+    if (numSamples <= 0)
+        return true;
+
+    if (sampleWindow == nullptr || !sampleWindow->contains(firstSample, numSamples))
     {
-        // No audio loaded message
-        g.setColour(Colours::grey);
-        g.setFont(16.0f);
-        g.drawText("Load an audio file to see waveform", bounds, Justification::centred);
+        requestSamples(firstSample, numSamples);
+        return false;
+    }
+
+    const int numChannels = juce::jmin(pyramid->getNumChannels(), sampleWindow->samples.getNumChannels());
+    const int laneHeight = area.getHeight() / pyramid->getNumChannels();
+    g.setColour(Colour(0xff1d5c9c));
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* samples = sampleWindow->samples.getReadPointer(channel, (int)(firstSample - sampleWindow->start));
+        const float centreY = (float)(area.getY() + channel * laneHeight) + laneHeight * 0.5f;
+        const float halfHeight = laneHeight * 0.5f;
+
+        if (samplesPerPixel >= 1.0)
+        {
+            // Still several samples per pixel: the min/max of each column
+            for (int x = 0; x < area.getWidth(); ++x)
+            {
+                const int start = (int)(x * samplesPerPixel + (viewStartSample - (double)firstSample));
+                const int count = juce::jmin(numSamples - start, juce::jmax(1, (int)samplesPerPixel));
+
+                if (count <= 0)
+                    break;
+
+                const auto range = juce::FloatVectorOperations::findMinAndMax(samples + start, count);
+                g.fillRect((float)(area.getX() + x), centreY - range.getEnd() * halfHeight,
+                    1.0f, juce::jmax(1.0f, range.getLength() * halfHeight));
+            }
+        }
+        else
+        {
+            // Individual samples, joined up, with a dot on each once they're far enough apart
+            juce::Path path;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float x = (float)area.getX() + (float)(((double)(firstSample + i) - viewStartSample) / samplesPerPixel);
+                const float y = centreY - samples[i] * halfHeight;
+
+                if (i == 0)
+                    path.startNewSubPath(x, y);
+                else
+                    path.lineTo(x, y);
+
+                if (samplesPerPixel <= 0.25)
+                    g.fillEllipse(x - 2.0f, y - 2.0f, 4.0f, 4.0f);
+            }
+
+            g.strokePath(path, juce::PathStrokeType(1.0f));
+        }
     }
+
+    return true;
+}
+
+void WaveformDisplay::requestSamples(juce::int64 firstSample, int numSamples)
+{
+    // Already on its way
+    if (requestedSamples > 0 && firstSample >= requestedSampleStart
+        && firstSample + numSamples <= requestedSampleStart + requestedSamples)
+        return;
+
+    // A screen either side as well, so scrolling and page turns mostly find their samples decoded
+    requestedSampleStart = juce::jmax((juce::int64)0, firstSample - numSamples);
+    requestedSamples = (int)(juce::jmin(firstSample + 2 * (juce::int64)numSamples, pyramid->getLengthInSamples())
+        - requestedSampleStart);
+
+    waveformBuilder->decodeSamples(sampleFile, requestedSampleStart, requestedSamples,
+        [safeThis = juce::Component::SafePointer<WaveformDisplay>(this), file = sampleFile,
+         start = requestedSampleStart, length = requestedSamples](WaveformBuilder::SampleWindow::Ptr window)
+        {
+            // Dropped if the view has asked for another window since, or another file is loaded
+            if (safeThis == nullptr || window == nullptr || safeThis->sampleFile != file
+                || safeThis->requestedSampleStart != start || safeThis->requestedSamples != length)
+                return;
+
+            safeThis->sampleWindow = window;
+            safeThis->invalidateStaticLayers();
+        });
+}
+
+float WaveformDisplay::timeToX(double time) const
+{
+    const auto area = getLocalBounds().reduced(4);
+    const double length = getViewLength();
+
+    if (length <= 0.0)
+        return (float)area.getX();
+
+    return (float)area.getX() + (float)((time - viewStart) / length * area.getWidth());
+}
+
+void WaveformDisplay::setView(double start, double length)
+{
+    const double totalLength = getTotalLength();
+
+    if (totalLength <= 0.0)
+        return;
+
+    const double minLength = juce::jmax(1, getWidth() - 8) * minSamplesPerPixel / pyramid->getSampleRate();
+    length = juce::jlimit(juce::jmin(minLength, totalLength), totalLength, length);
+
+    viewLength = length >= totalLength ? 0.0 : length;
+    viewStart = juce::jlimit(0.0, totalLength - length, start);
+    invalidateStaticLayers();
 }
 
 void WaveformDisplay::setWaveform(const juce::File& file)
 {
-    thumbnail.clear();
+    pyramid = nullptr;
+    sampleFile = juce::File();
+    sampleWindow = nullptr;
+    requestedSamples = 0;
+    viewStart = 0.0;
+    viewLength = 0.0;
+
     if (file.existsAsFile())
     {
-        thumbnail.setSource(new juce::FileInputSource(file));
+        // Built in the background; later loads of the same file reuse it
+        pyramid = waveformBuilder->getPyramid(file);
+        sampleFile = file;
     }
-    repaint();
+    paintedPlayheadX = -1;
+    invalidateStaticLayers();
+    updateAnimation();
 }
 
 void WaveformDisplay::setPosition(double pos)
@@ -98,39 +354,152 @@ void WaveformDisplay::setPosition(double pos)
     if (currentPosition != pos)
     {
         currentPosition = pos;
+
+        // Zoomed in: turn the page when the play head runs off either edge
+        const double length = getViewLength();
+        if (viewLength > 0.0 && (pos < viewStart || pos > viewStart + length))
+            setView(pos - length * 0.05, length);
     }
+
+    refreshPlayhead();
 }
 
 void WaveformDisplay::mouseDown(const juce::MouseEvent& event)
 {
-    if (thumbnail.getTotalLength() > 0.0)
+    if (getTotalLength() > 0.0)
     {
         double clickedTime = getClickedTime(event.x);
         playerAudio.setPosition(clickedTime);
+        setPosition(clickedTime);
+
+        if (onSeek != nullptr)
+            onSeek();
     }
 }
 
+void WaveformDisplay::mouseDoubleClick(const juce::MouseEvent&)
+{
+    setView(0.0, getTotalLength());
+}
+
+void WaveformDisplay::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    if (getTotalLength() <= 0.0)
+        return;
+
+    const double length = getViewLength();
+
+    // Horizontal swipes and shift-wheel scroll
+    if (event.mods.isShiftDown() || std::abs(wheel.deltaX) > std::abs(wheel.deltaY))
+    {
+        const float delta = std::abs(wheel.deltaX) > std::abs(wheel.deltaY) ? wheel.deltaX : wheel.deltaY;
+        setView(viewStart - delta * length, length);
+        return;
+    }
+
+    // Zoom around the time under the mouse; a wheel notch halves or doubles the view
+    const double anchor = getClickedTime(event.x);
+    const double newLength = length * std::pow(2.0, -wheel.deltaY * 4.0);
+    setView(anchor - (anchor - viewStart) * newLength / length, newLength);
+}
+
 double WaveformDisplay::getClickedTime(int x) const
 {
-    double ratio = (double)x / getWidth();
-    return ratio * thumbnail.getTotalLength();
+    const auto area = getLocalBounds().reduced(4);
+    double ratio = (double)(x - area.getX()) / juce::jmax(1, area.getWidth());
+    return juce::jlimit(0.0, getTotalLength(), viewStart + ratio * getViewLength());
 }
 
-void WaveformDisplay::timerCallback()
+void WaveformDisplay::refreshPlayhead()
 {
-    repaint();
+    // Still building: redraw the waveform as more of it comes in
+    if (pyramid != nullptr && !pyramid->isComplete()
+        && (pyramid->getNumReadyBins(0) != renderedReadyBins || pyramid->getPreviewLevel() != renderedPreviewLevel))
+        invalidateStaticLayers();
+
+    // Otherwise only the strip the play head crossed since the last frame, or all of it in the old mode
+    const int playheadX = juce::roundToInt(timeToX(currentPosition));
+
+    if (playheadX != paintedPlayheadX)
+    {
+        const int left = juce::jmin(playheadX, paintedPlayheadX);
+        const int right = juce::jmax(playheadX, paintedPlayheadX);
+
+        if (fullRepaint)
+            repaint();
+        else
+            repaint(left - 3, 0, right - left + 6, getHeight());
+
+        paintedPlayheadX = playheadX;
+    }
+}
+
+void WaveformDisplay::setPlaying(bool isPlaying)
+{
+    playing = isPlaying;
+    updateAnimation();
+}
+
+bool WaveformDisplay::shouldAnimate() const
+{
+    return playing || (pyramid != nullptr && !pyramid->isComplete());
+}
+
+void WaveformDisplay::updateAnimation()
+{
+    const bool animate = shouldAnimate();
+
+    if (animate == animating)
+        return;
+
+    animating = animate;
+    vblankAttachment = animate ? juce::VBlankAttachment(this, [this] { handleVBlank(); })
+                               : juce::VBlankAttachment();
+}
+
+void WaveformDisplay::handleVBlank()
+{
+    // Some platforms keep the refresh going for minimised windows
+    if (auto* peer = getPeer(); peer != nullptr && peer->isMinimised())
+        return;
+
+    // Block timing jitter can put a fresh estimate a hair behind the last frame's; hold still rather than step back
+    double position = playerAudio.getAudiblePosition();
+    if (playing && position < currentPosition && currentPosition - position < 0.05)
+        position = currentPosition;
+
+    // Ran off the end of the file: nothing left to follow
+    if (playing && playerAudio.hasStreamFinished())
+        playing = false;
+
+    setPosition(position);
+
+    // Stopped and fully drawn: this was the last frame worth drawing. The attachment can't be
+    // replaced from inside its own callback, so it's dropped once the callback has returned.
+    if (animating && !shouldAnimate() && !detachPending)
+    {
+        detachPending = true;
+        juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<WaveformDisplay>(this)]
+            {
+                if (safeThis != nullptr)
+                {
+                    safeThis->detachPending = false;
+                    safeThis->updateAnimation();
+                }
+            });
+    }
 }
 
 void WaveformDisplay::addMarker(double time, const juce::String& name)
 {
     markers.push_back(AudioMarker(time, name, Colours::yellow));
-    repaint();
+    invalidateStaticLayers();
 }
 
 void WaveformDisplay::clearMarkers()
 {
     markers.clear();
-    repaint();
+    invalidateStaticLayers();
 }
 
 void WaveformDisplay::setABLoopPoints(double pointA, double pointB)
@@ -138,7 +507,7 @@ void WaveformDisplay::setABLoopPoints(double pointA, double pointB)
     loopPointA = pointA;
     loopPointB = pointB;
     hasABLoop = true;
-    repaint();
+    invalidateStaticLayers();
 }
 
 void WaveformDisplay::clearABLoop()
@@ -146,7 +515,7 @@ void WaveformDisplay::clearABLoop()
     hasABLoop = false;
     loopPointA = -1.0;
     loopPointB = -1.0;
-    repaint();
+    invalidateStaticLayers();
 }
 
 // ============ PlayerGUI Implementation ============
@@ -156,7 +525,8 @@ PlayerGUI::PlayerGUI() : waveformDisplay(playerAudio)
     for (auto* btn : { &loadButton, &playPauseButton, &stopButton, &prevTrackButton,
                        &nextTrackButton, &backward10Button, &forward10Button,
                        &startButton, &endButton, &muteButton, &loopButton,
-                       &setPointAButton, &setPointBButton, &clearABButton, &addMarkerButton })
+                       &setPointAButton, &setPointBButton, &clearABButton, &addMarkerButton,
+                       &gaplessButton, &keyLockButton, &autoGainButton })
     {
         btn->addListener(this);
         addAndMakeVisible(btn);
@@ -176,6 +546,9 @@ PlayerGUI::PlayerGUI() : waveformDisplay(playerAudio)
     addMarkerButton.setColour(TextButton::buttonColourId, Colour(0xfff8b500));
     muteButton.setColour(TextButton::buttonColourId, Colour(0xff6c5ce7));
     loopButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
+    gaplessButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
+    keyLockButton.setColour(TextButton::buttonColourId, Colour(0xff786fa6));
+    autoGainButton.setColour(TextButton::buttonColourId, Colour(0xff00ff88));
 
     // Volume slider
     volumeSlider.setRange(0.0, 1.0, 0.01);
@@ -186,13 +559,34 @@ PlayerGUI::PlayerGUI() : waveformDisplay(playerAudio)
     addAndMakeVisible(volumeSlider);
 
     // Speed slider
-    speedSlider.setRange(0.5, 2.0, 0.1);
+    speedSlider.setRange(0.25, 4.0, 0.01);
+    speedSlider.setSkewFactorFromMidPoint(1.0);
     speedSlider.setValue(1.0);
     speedSlider.setSliderStyle(Slider::Rotary);
     speedSlider.setTextBoxStyle(Slider::TextBoxBelow, false, 50, 20);
     speedSlider.addListener(this);
     addAndMakeVisible(speedSlider);
 
+    // Key-lock stretch quality
+    stretchQualityBox.addItem("Fast", (int)StretchQuality::fast + 1);
+    stretchQualityBox.addItem("Balanced", (int)StretchQuality::balanced + 1);
+    stretchQualityBox.addItem("High", (int)StretchQuality::high + 1);
+    stretchQualityBox.setSelectedId((int)playerAudio.getStretchQuality() + 1, dontSendNotification);
+    stretchQualityBox.onChange = [this]() {
+        playerAudio.setStretchQuality((StretchQuality)(stretchQualityBox.getSelectedId() - 1));
+        };
+    addAndMakeVisible(stretchQualityBox);
+
+    // Resampler quality
+    resamplerQualityBox.addItem("SRC Low", (int)ResamplerQuality::low + 1);
+    resamplerQualityBox.addItem("SRC Medium", (int)ResamplerQuality::medium + 1);
+    resamplerQualityBox.addItem("SRC High", (int)ResamplerQuality::high + 1);
+    resamplerQualityBox.setSelectedId((int)playerAudio.getResamplerQuality() + 1, dontSendNotification);
+    resamplerQualityBox.onChange = [this]() {
+        playerAudio.setResamplerQuality((ResamplerQuality)(resamplerQualityBox.getSelectedId() - 1));
+        };
+    addAndMakeVisible(resamplerQualityBox);
+
     // Labels setup
     volumeLabel.setText("Volume", dontSendNotification);
     volumeLabel.setJustificationType(Justification::centred);
@@ -215,6 +609,15 @@ PlayerGUI::PlayerGUI() : waveformDisplay(playerAudio)
     timeLabel.setFont(Font(16.0f));
     addAndMakeVisible(timeLabel);
 
+    loudnessLabel.setColour(Label::textColourId, Colours::lightgrey);
+    loudnessLabel.setFont(Font(13.0f));
+    addAndMakeVisible(loudnessLabel);
+
+    tempoLabel.setJustificationType(Justification::centredRight);
+    tempoLabel.setColour(Label::textColourId, Colours::lightgrey);
+    tempoLabel.setFont(Font(14.0f));
+    addAndMakeVisible(tempoLabel);
+
     markerListLabel.setText("Markers", dontSendNotification);
     markerListLabel.setColour(Label::textColourId, Colours::white);
     markerListLabel.setFont(Font(14.0f, Font::bold));
@@ -230,14 +633,23 @@ PlayerGUI::PlayerGUI() : waveformDisplay(playerAudio)
     markerListBox.setColour(ListBox::outlineColourId, Colours::lightgrey.withAlpha(0.3f));
     addAndMakeVisible(markerListBox);
 
+    // Loudness and beat grid results arrive from the shared analyzer as they finish
+    playerAudio.getTrackAnalyzer().addChangeListener(this);
+
     // Load last session
     loadSession();
+    playerAudio.getTrackAnalyzer().requestAnalysis(playlistFiles);
+    updateLoudnessDisplay();
+    updateTempoDisplay();
 
-    startTimer(100); // Update every 100ms
+    // Clicks on the waveform seek; show the new position even when stopped
+    waveformDisplay.onSeek = [this] { updatePlaybackTimers(); };
+    updatePlaybackTimers();
 }
 
 PlayerGUI::~PlayerGUI()
 {
+    playerAudio.getTrackAnalyzer().removeChangeListener(this);
     saveSession();
     stopTimer();
 }
@@ -264,6 +676,7 @@ void PlayerGUI::resized()
     // Top info bar
     fileNameLabel.setBounds(margin, margin, getWidth() - 40, 30);
     timeLabel.setBounds(margin, margin + 35, getWidth() - 40, 25);
+    tempoLabel.setBounds(getWidth() - 200, margin + 35, 180, 25);
 
     // Waveform display
     waveformDisplay.setBounds(margin, 110, getWidth() - 290, 180);
@@ -299,6 +712,12 @@ void PlayerGUI::resized()
     setPointBButton.setBounds(margin + abBtnWidth + btnSpacing, btnY, abBtnWidth, abBtnHeight);
     clearABButton.setBounds(margin + (abBtnWidth + btnSpacing) * 2, btnY, abBtnWidth, abBtnHeight);
     addMarkerButton.setBounds(margin + (abBtnWidth + btnSpacing) * 3, btnY, abBtnWidth + 20, abBtnHeight);
+    gaplessButton.setBounds(margin + (abBtnWidth + btnSpacing) * 4 + 20, btnY, btnWidth, abBtnHeight);
+
+    // Loudness normalisation
+    btnY = 480;
+    autoGainButton.setBounds(margin, btnY, abBtnWidth, abBtnHeight);
+    loudnessLabel.setBounds(margin + abBtnWidth + btnSpacing, btnY, getWidth() - 290 - abBtnWidth - btnSpacing, abBtnHeight);
 
     // Right panel - Volume and Speed
     volumeLabel.setBounds(rightPanelX, 110, 100, 20);
@@ -306,10 +725,13 @@ void PlayerGUI::resized()
 
     speedLabel.setBounds(rightPanelX + 120, 110, 100, 20);
     speedSlider.setBounds(rightPanelX + 110, 135, 100, 100);
+    keyLockButton.setBounds(rightPanelX + 120, 240, 80, 26);
+    stretchQualityBox.setBounds(rightPanelX + 120, 272, 80, 22);
+    resamplerQualityBox.setBounds(rightPanelX + 10, 298, 210, 22);
 
     // Marker list
-    markerListLabel.setBounds(rightPanelX, 310, 230, 25);
-    markerListBox.setBounds(rightPanelX, 340, 230, getHeight() - 360);
+    markerListLabel.setBounds(rightPanelX, 330, 230, 25);
+    markerListBox.setBounds(rightPanelX, 360, 230, getHeight() - 380);
 }
 
 void PlayerGUI::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
@@ -319,27 +741,8 @@ void PlayerGUI::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 
 void PlayerGUI::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    // Looping is handled sample-accurately inside PlayerAudio's source chain
     playerAudio.getNextAudioBlock(bufferToFill);
-
-    // A-B Loop handling
-    if (hasABLoop && abLoopPointB > abLoopPointA)
-    {
-        double pos = playerAudio.getPosition();
-        if (pos >= abLoopPointB)
-        {
-            playerAudio.setPosition(abLoopPointA);
-        }
-    }
-    // Normal loop
-    else if (loopEnabled)
-    {
-        double pos = playerAudio.getPosition();
-        double length = playerAudio.getLength();
-        if (length > 0 && pos >= length - 0.05)
-        {
-            playerAudio.setPosition(0.0);
-        }
-    }
 }
 
 void PlayerGUI::releaseResources()
@@ -349,12 +752,61 @@ void PlayerGUI::releaseResources()
 
 void PlayerGUI::timerCallback()
 {
+    // The audio thread spliced the queued track in; catch the UI up with it
+    if (playerAudio.handleTrackChange())
+        handleTrackAdvanced();
+
+    // Tracks that couldn't be queued (e.g. a different sample rate) still advance, just not gaplessly
+    if (gaplessEnabled && isPlaying && playerAudio.hasStreamFinished())
+        loadNextTrack();
+
+    // Ran off the end with nothing to follow: show the deck as stopped
+    if (isPlaying && playerAudio.hasStreamFinished())
+    {
+        isPlaying = false;
+        playPauseButton.setButtonText("▶");
+        waveformDisplay.setPlaying(false);
+    }
+
+    if (currentDuration > 0)
+        updateTimeDisplay();
+
+    // Tempo sync changes the speed from the audio thread
+    if (playerAudio.getPlaybackSpeed() != shownPlaybackSpeed)
+        updateTempoDisplay();
+
+    // Ran off the end, or nothing started: after a second of silence, go idle until the next click
+    idleTicks = playerAudio.isPlaying() ? 0 : idleTicks + 1;
+
+    if (idleTicks >= 10)
+    {
+        stopTimer();
+        waveformDisplay.setPlaying(false);
+    }
+}
+
+void PlayerGUI::updatePlaybackTimers()
+{
+    // Seeks and loads show straight away, playing or not
     if (currentDuration > 0)
     {
-        double currentPos = playerAudio.getPosition();
-        waveformDisplay.setPosition(currentPos);
+        waveformDisplay.setPosition(playerAudio.getAudiblePosition());
         updateTimeDisplay();
     }
+
+    // Only a playing deck needs the time display and play head kept moving
+    waveformDisplay.setPlaying(isPlaying);
+    idleTicks = 0;
+
+    if (isPlaying)
+    {
+        if (!isTimerRunning())
+            startTimer(100); // Update every 100ms
+    }
+    else
+    {
+        stopTimer();
+    }
 }
 
 void PlayerGUI::setGain(float gain)
@@ -364,11 +816,63 @@ void PlayerGUI::setGain(float gain)
 
 void PlayerGUI::updateTimeDisplay()
 {
-    double currentPos = playerAudio.getPosition();
+    double currentPos = playerAudio.getAudiblePosition();
     juce::String timeStr = formatTime(currentPos) + " / " + formatTime(currentDuration);
     timeLabel.setText(timeStr, dontSendNotification);
 }
 
+void PlayerGUI::updateLoudnessDisplay()
+{
+    LoudnessInfo info;
+
+    if (!playerAudio.getLoudnessInfo(info))
+    {
+        loudnessLabel.setText(currentFileName.isNotEmpty() ? "Measuring loudness..." : juce::String(), dontSendNotification);
+        return;
+    }
+
+    juce::String text = juce::String(info.integratedLufs, 1) + " LUFS  LRA " + juce::String(info.loudnessRange, 1)
+        + " LU  TP " + juce::String(info.truePeakDb, 1) + " dBTP";
+
+    if (autoGainEnabled)
+        text << "  Gain " << juce::String(info.getNormalisationGainDb(), 1) << " dB";
+
+    loudnessLabel.setText(text, dontSendNotification);
+}
+
+void PlayerGUI::updateTempoDisplay()
+{
+    BeatGrid grid;
+    shownPlaybackSpeed = playerAudio.getPlaybackSpeed();
+
+    if (!playerAudio.getBeatGrid(grid))
+    {
+        tempoLabel.setText(currentFileName.isNotEmpty() ? "Detecting tempo..." : juce::String(), dontSendNotification);
+        return;
+    }
+
+    if (!grid.isValid())
+    {
+        tempoLabel.setText("No steady beat", dontSendNotification);
+        return;
+    }
+
+    juce::String text = juce::String(grid.bpm * shownPlaybackSpeed, 2) + " BPM";
+    if (playerAudio.isTempoSynced())
+        text << " (Sync)";
+
+    tempoLabel.setText(text, dontSendNotification);
+}
+
+void PlayerGUI::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    // Some file finished; it may be the one on this deck
+    playerAudio.updateNormalisationGain();
+    playerAudio.updateBeatGrid();
+    updateLoudnessDisplay();
+    updateTempoDisplay();
+}
+
 juce::String PlayerGUI::formatTime(double seconds)
 {
     int mins = (int)seconds / 60;
@@ -386,6 +890,8 @@ void PlayerGUI::loadAudioFile(const juce::File& file)
         fileNameLabel.setText("♪ " + currentFileName, dontSendNotification);
         waveformDisplay.setWaveform(file);
         waveformDisplay.clearMarkers();
+        updateLoudnessDisplay();
+        updateTempoDisplay();
 
         playerAudio.play();
         isPlaying = true;
@@ -409,6 +915,9 @@ void PlayerGUI::loadAudioFile(const juce::File& file)
             playlist.add(file.getFileNameWithoutExtension());
             currentPlaylistIndex = playlistFiles.size() - 1;
         }
+
+        queueNextTrack();
+        updatePlaybackTimers();
     }
 }
 
@@ -428,6 +937,37 @@ void PlayerGUI::loadPreviousTrack()
     }
 }
 
+void PlayerGUI::queueNextTrack()
+{
+    if (gaplessEnabled && currentPlaylistIndex >= 0 && currentPlaylistIndex < playlistFiles.size() - 1)
+        playerAudio.queueNextFile(playlistFiles[currentPlaylistIndex + 1]);
+    else
+        playerAudio.cancelQueuedFile();
+}
+
+void PlayerGUI::handleTrackAdvanced()
+{
+    auto file = playerAudio.getCurrentFile();
+    currentPlaylistIndex = playlistFiles.indexOf(file);
+
+    currentFileName = file.getFileNameWithoutExtension();
+    currentDuration = playerAudio.getLength();
+    fileNameLabel.setText("♪ " + currentFileName, dontSendNotification);
+    waveformDisplay.setWaveform(file);
+    waveformDisplay.clearMarkers();
+    markerListBox.updateContent();
+    updateLoudnessDisplay();
+    updateTempoDisplay();
+
+    // PlayerAudio drops the A-B loop when the track changes
+    hasABLoop = false;
+    abLoopPointA = -1.0;
+    abLoopPointB = -1.0;
+    waveformDisplay.clearABLoop();
+
+    queueNextTrack();
+}
+
 void PlayerGUI::jumpForward(double seconds)
 {
     double newPos = playerAudio.getPosition() + seconds;
@@ -444,7 +984,7 @@ void PlayerGUI::jumpBackward(double seconds)
 
 void PlayerGUI::addMarkerAtCurrentPosition()
 {
-    double currentPos = playerAudio.getPosition();
+    double currentPos = playerAudio.getAudiblePosition();
     int markerNum = (int)waveformDisplay.getMarkers().size() + 1;
     juce::String markerName = "Marker " + juce::String(markerNum) + " (" + formatTime(currentPos) + ")";
     waveformDisplay.addMarker(currentPos, markerName);
@@ -566,6 +1106,9 @@ void PlayerGUI::buttonClicked(juce::Button* button)
                         }
                     }
 
+                    // Measure the whole playlist in the background
+                    playerAudio.getTrackAnalyzer().requestAnalysis(playlistFiles);
+
                     // Load first file
                     if (playlistFiles.size() > 0)
                     {
@@ -624,27 +1167,58 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     if (button == &loopButton)
     {
         loopEnabled = !loopEnabled;
+        playerAudio.setLooping(loopEnabled);
         loopButton.setButtonText(loopEnabled ? "Loop On" : "Loop");
         loopButton.setColour(TextButton::buttonColourId,
             loopEnabled ? Colour(0xff00ff88) : Colour(0xff786fa6));
     }
 
+    if (button == &gaplessButton)
+    {
+        gaplessEnabled = !gaplessEnabled;
+        gaplessButton.setButtonText(gaplessEnabled ? "Gapless On" : "Gapless");
+        gaplessButton.setColour(TextButton::buttonColourId,
+            gaplessEnabled ? Colour(0xff00ff88) : Colour(0xff786fa6));
+        queueNextTrack();
+    }
+
+    if (button == &autoGainButton)
+    {
+        autoGainEnabled = !autoGainEnabled;
+        playerAudio.setAutoGain(autoGainEnabled);
+        autoGainButton.setButtonText(autoGainEnabled ? "Auto Gain On" : "Auto Gain");
+        autoGainButton.setColour(TextButton::buttonColourId,
+            autoGainEnabled ? Colour(0xff00ff88) : Colour(0xff786fa6));
+        updateLoudnessDisplay();
+    }
+
+    if (button == &keyLockButton)
+    {
+        keyLockEnabled = !keyLockEnabled;
+        playerAudio.setKeyLock(keyLockEnabled);
+        keyLockButton.setButtonText(keyLockEnabled ? "Key Locked" : "Key Lock");
+        keyLockButton.setColour(TextButton::buttonColourId,
+            keyLockEnabled ? Colour(0xff00ff88) : Colour(0xff786fa6));
+    }
+
     if (button == &setPointAButton)
     {
-        abLoopPointA = playerAudio.getPosition();
+        abLoopPointA = playerAudio.getAudiblePosition();
         if (abLoopPointB > abLoopPointA)
         {
             hasABLoop = true;
+            playerAudio.setABLoop(abLoopPointA, abLoopPointB);
             waveformDisplay.setABLoopPoints(abLoopPointA, abLoopPointB);
         }
     }
 
     if (button == &setPointBButton)
     {
-        abLoopPointB = playerAudio.getPosition();
+        abLoopPointB = playerAudio.getAudiblePosition();
         if (abLoopPointB > abLoopPointA && abLoopPointA >= 0)
         {
             hasABLoop = true;
+            playerAudio.setABLoop(abLoopPointA, abLoopPointB);
             waveformDisplay.setABLoopPoints(abLoopPointA, abLoopPointB);
         }
     }
@@ -654,6 +1228,7 @@ void PlayerGUI::buttonClicked(juce::Button* button)
         hasABLoop = false;
         abLoopPointA = -1.0;
         abLoopPointB = -1.0;
+        playerAudio.clearABLoop();
         waveformDisplay.clearABLoop();
     }
 
@@ -661,6 +1236,9 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     {
         addMarkerAtCurrentPosition();
     }
+
+    // Any of the above may have started, stopped or moved playback
+    updatePlaybackTimers();
 }
 
 void PlayerGUI::sliderValueChanged(juce::Slider* slider)
@@ -717,6 +1295,8 @@ void PlayerGUI::MarkerListModel::listBoxItemClicked(int row, const juce::MouseEv
             parent.isPlaying = true;
             parent.playPauseButton.setButtonText("⏸");
         }
+
+        parent.updatePlaybackTimers();
     }
 }
 
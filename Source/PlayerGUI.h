@@ -1,6 +1,7 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PlayerAudio.h"
+#include "WaveformPyramid.h"
 
 using namespace juce;
 
@@ -17,7 +18,10 @@ struct AudioMarker
 };
 
 // ============ Waveform Display Component ============
-class WaveformDisplay : public juce::Component, public juce::Timer
+// Draws from the file's waveform pyramid, so it zooms from the whole track
+// down to single samples (the wheel zooms around the mouse, shift-wheel or
+// a horizontal swipe scrolls, double-click shows the whole track again).
+class WaveformDisplay : public juce::Component
 {
 public:
     WaveformDisplay(PlayerAudio& audio);
@@ -27,7 +31,15 @@ public:
     void setWaveform(const juce::File& file);
     void setPosition(double pos);
     void mouseDown(const juce::MouseEvent& event) override;
-    void timerCallback() override;
+    void mouseDoubleClick(const juce::MouseEvent& event) override;
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+
+    // Follows the play head on every display refresh while playing or while the
+    // waveform is still building; detached otherwise, so a stopped deck costs nothing
+    void setPlaying(bool isPlaying);
+
+    // Called after a click on the waveform has moved the play head
+    std::function<void()> onSeek;
 
     void addMarker(double time, const juce::String& name);
     void clearMarkers();
@@ -37,17 +49,64 @@ public:
     void clearABLoop();
     double getClickedTime(int x) const;
 
+    // Draws everything on every frame, as before the cached image, so the two can be timed
+    // against each other on the same track and window
+    void setFullRepaint(bool shouldRepaintAll);
+
+    // Smoothed time a paint() takes in either mode, for the performance overlay
+    double getAveragePaintMilliseconds(bool fullRepaint) const { return averagePaintMilliseconds[fullRepaint ? 1 : 0]; }
+
 private:
     PlayerAudio& playerAudio;
-    juce::AudioFormatManager formatManager;
-    juce::AudioThumbnail thumbnail;
-    juce::AudioThumbnailCache thumbnailCache;
+    juce::SharedResourcePointer<WaveformBuilder> waveformBuilder;
+    WaveformPyramid::Ptr pyramid;
+
+    // Zoomed past the finest level, the samples on screen are decoded on the builder's pool
+    // and kept here; paint only ever draws from this window, never from the file
+    juce::File sampleFile;
+    WaveformBuilder::SampleWindow::Ptr sampleWindow;
+    juce::int64 requestedSampleStart = 0;
+    int requestedSamples = 0;
+
+    // Visible part of the track, in seconds; a zero length shows all of it
+    double viewStart = 0.0;
+    double viewLength = 0.0;
+
     double currentPosition = 0.0;
     std::vector<AudioMarker> markers;
     double loopPointA = -1.0;
     double loopPointB = -1.0;
     bool hasABLoop = false;
 
+    // Background, waveform, loop and markers, drawn at the display's pixel scale; a frame
+    // only repaints the strip the play head moved across, and blits the image under it
+    juce::Image staticLayers;
+    bool staticLayersValid = false;
+    int renderedReadyBins = -1;
+    int renderedPreviewLevel = -1;
+    int paintedPlayheadX = -1;
+    bool fullRepaint = false;
+    double averagePaintMilliseconds[2] = {};
+
+    juce::VBlankAttachment vblankAttachment;
+    bool playing = false;
+    bool animating = false;
+    bool detachPending = false;
+
+    double getTotalLength() const { return pyramid != nullptr ? pyramid->getLengthInSeconds() : 0.0; }
+    double getViewLength() const { return viewLength > 0.0 ? viewLength : getTotalLength(); }
+    float timeToX(double time) const;
+    void setView(double start, double length);
+    void paintStaticLayers(juce::Graphics& g);
+    void invalidateStaticLayers();
+    void refreshPlayhead();
+    bool shouldAnimate() const;
+    void updateAnimation();
+    void handleVBlank();
+    void drawPeaks(juce::Graphics& g, juce::Rectangle<int> area, int channel, int level, double samplesPerPixel);
+    bool drawSamples(juce::Graphics& g, juce::Rectangle<int> area, double samplesPerPixel);
+    void requestSamples(juce::int64 firstSample, int numSamples);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDisplay)
 };
 
@@ -55,7 +114,8 @@ private:
 class PlayerGUI : public juce::Component,
     public juce::Button::Listener,
     public juce::Slider::Listener,
-    public juce::Timer
+    public juce::Timer,
+    private juce::ChangeListener
 {
 public:
     PlayerGUI();
@@ -69,6 +129,11 @@ public:
     void timerCallback() override;
     void setGain(float gain);
 
+    // The mixer renders the deck's audio directly
+    PlayerAudio& getPlayerAudio() { return playerAudio; }
+    double getWaveformPaintMilliseconds(bool fullRepaint) const { return waveformDisplay.getAveragePaintMilliseconds(fullRepaint); }
+    void setWaveformFullRepaint(bool shouldRepaintAll) { waveformDisplay.setFullRepaint(shouldRepaintAll); }
+
 private:
     PlayerAudio playerAudio;
     WaveformDisplay waveformDisplay;
@@ -93,6 +158,13 @@ private:
     juce::TextButton setPointBButton{ "Set B" };
     juce::TextButton clearABButton{ "Clear AB" };
     juce::TextButton addMarkerButton{ "Add Marker" };
+    juce::TextButton gaplessButton{ "Gapless" };
+    juce::TextButton keyLockButton{ "Key Lock" };
+    juce::TextButton autoGainButton{ "Auto Gain On" };
+
+    // Time-stretch quality for key lock, and resampler quality
+    juce::ComboBox stretchQualityBox;
+    juce::ComboBox resamplerQualityBox;
 
     // Sliders
     juce::Slider volumeSlider;
@@ -104,6 +176,8 @@ private:
     juce::Label volumeLabel;
     juce::Label speedLabel;
     juce::Label markerListLabel;
+    juce::Label loudnessLabel;
+    juce::Label tempoLabel;
 
     // Marker list
     juce::ListBox markerListBox;
@@ -128,7 +202,13 @@ private:
     void loadAudioFile(const juce::File& file);
     void loadNextTrack();
     void loadPreviousTrack();
+    void queueNextTrack();
+    void handleTrackAdvanced();
     void updateTimeDisplay();
+    void updateLoudnessDisplay();
+    void updateTempoDisplay();
+    void updatePlaybackTimers();
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     void jumpForward(double seconds);
     void jumpBackward(double seconds);
     void addMarkerAtCurrentPosition();
@@ -139,7 +219,12 @@ private:
     bool isPlaying = false;
     bool isMuted = false;
     bool loopEnabled = false;
+    bool gaplessEnabled = false;
+    bool keyLockEnabled = false;
+    bool autoGainEnabled = true;
     float previousVolume = 0.7f;
+    float shownPlaybackSpeed = 0.0f;
+    int idleTicks = 0;
 
     // Marker list model
     class MarkerListModel : public juce::ListBoxModel
@@ -0,0 +1,333 @@
+#include "PolyphaseResamplingSource.h"
+#include "MixKernel.h"
+#include <cstring>
+
+namespace
+{
+    // Zeroth-order modified Bessel function, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+
+            if (term < sum * 1.0e-12)
+                break;
+        }
+
+        return sum;
+    }
+}
+
+PolyphaseResamplingSource::PolyphaseResamplingSource(juce::AudioSource* s, bool deleteInputWhenDeleted, int numChannels)
+    : input(s, deleteInputWhenDeleted),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+
+    // Half-length, passband edge (fraction of Nyquist) and Kaiser beta per quality
+    kernels[(int)ResamplerQuality::low] = makeKernel(4, 0.85, 5.0);
+    kernels[(int)ResamplerQuality::medium] = makeKernel(16, 0.92, 8.0);
+    kernels[(int)ResamplerQuality::high] = makeKernel(32, 0.96, 10.0);
+}
+
+PolyphaseResamplingSource::~PolyphaseResamplingSource()
+{
+}
+
+PolyphaseResamplingSource::Kernel PolyphaseResamplingSource::makeKernel(int halfTaps, double cutoff, double kaiserBeta)
+{
+    Kernel kernel;
+    kernel.halfTaps = halfTaps;
+
+    const double windowNorm = 1.0 / besselI0(kaiserBeta);
+
+    auto evaluate = [=](double distance)
+    {
+        const double x = std::abs(distance) / (double)halfTaps;
+
+        if (x >= 1.0)
+            return 0.0;
+
+        const double arg = juce::MathConstants<double>::pi * cutoff * distance;
+        const double sinc = distance == 0.0 ? 1.0 : std::sin(arg) / arg;
+        return cutoff * sinc * besselI0(kaiserBeta * std::sqrt(1.0 - x * x)) * windowNorm;
+    };
+
+    // One extra zero past the end keeps the interpolated lookup branch-free
+    kernel.prototype.resize((size_t)(halfTaps * oversampling + 2), 0.0f);
+
+    for (int i = 0; i <= halfTaps * oversampling; ++i)
+        kernel.prototype[(size_t)i] = (float)evaluate((double)i / oversampling);
+
+    // Each phase is normalised to unity gain at DC so it adds no ripple of its own
+    const int numTaps = halfTaps * 2;
+    kernel.bank.resize((size_t)((numPhases + 1) * numTaps));
+
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        auto* taps = kernel.bank.data() + phase * numTaps;
+        const double fraction = (double)phase / numPhases;
+        double sum = 0.0;
+
+        for (int t = 0; t < numTaps; ++t)
+        {
+            const double value = evaluate((double)(t - (halfTaps - 1)) - fraction);
+            taps[t] = (float)value;
+            sum += value;
+        }
+
+        for (int t = 0; t < numTaps; ++t)
+            taps[t] = (float)(taps[t] / sum);
+    }
+
+    return kernel;
+}
+
+float PolyphaseResamplingSource::getPrototypeValue(const Kernel& kernel, double distance) const
+{
+    const double index = std::abs(distance) * oversampling;
+    const int lower = (int)index;
+
+    if (lower >= kernel.halfTaps * oversampling)
+        return 0.0f;
+
+    const float fraction = (float)(index - lower);
+    return kernel.prototype[(size_t)lower] + (kernel.prototype[(size_t)lower + 1] - kernel.prototype[(size_t)lower]) * fraction;
+}
+
+void PolyphaseResamplingSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // Room for the longest stretched kernel either side, plus a block at the fastest ratio
+    const int maxHalfTaps = kernels[(int)ResamplerQuality::high].halfTaps;
+    historyLength = (int)std::ceil(maxHalfTaps * maxRatio);
+    maxOutputPiece = juce::jmax(1, samplesPerBlockExpected);
+
+    // The most one pull can ask for: a block at the fastest ratio plus the kernel's reach, whatever
+    // the ratio is now. Its own rate is the owner's to set: this rate only holds for it at ratio 1.
+    input->prepareToPlay((int)std::ceil(maxOutputPiece * maxRatio) + historyLength, sampleRate);
+
+    inputBuffer.setSize(numberOfChannels, historyLength * 2 + (int)std::ceil(maxOutputPiece * maxRatio) + 8);
+    coefficients.allocate((size_t)(historyLength * 2 + 2), true);
+    stretchedBank.allocate((size_t)((numPhases + 1) * historyLength * 2), true);
+    stretchedQuality = -1;
+
+    resetState();
+    resetRequested = false;
+}
+
+void PolyphaseResamplingSource::releaseResources()
+{
+    input->releaseResources();
+    inputBuffer.setSize(numberOfChannels, 0);
+    coefficients.free();
+    stretchedBank.free();
+    stretchedQuality = -1;
+}
+
+void PolyphaseResamplingSource::setResamplingRatio(double samplesInPerOutputSample)
+{
+    jassert(samplesInPerOutputSample > 0.0);
+    resamplingRatio = juce::jlimit(1.0 / maxRatio, maxRatio, samplesInPerOutputSample);
+}
+
+void PolyphaseResamplingSource::setQuality(ResamplerQuality quality)
+{
+    qualityLevel = (int)quality;
+}
+
+double PolyphaseResamplingSource::getLatencyInputSamples() const
+{
+    // A pending reset restarts the filter on the next input sample
+    if (resetRequested.load())
+        return 0.0;
+
+    return juce::jmax(0.0, (double)bufferedSamples - position);
+}
+
+void PolyphaseResamplingSource::resetState()
+{
+    // Start with a full history of silence so the first outputs have taps to their left
+    inputBuffer.clear();
+    bufferedSamples = historyLength;
+    position = (double)historyLength;
+}
+
+void PolyphaseResamplingSource::discardBefore(int index)
+{
+    const int drop = juce::jlimit(0, bufferedSamples, index);
+
+    if (drop == 0)
+        return;
+
+    const int keep = bufferedSamples - drop;
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+    {
+        auto* data = inputBuffer.getWritePointer(channel);
+        std::memmove(data, data + drop, (size_t)keep * sizeof(float));
+    }
+
+    bufferedSamples = keep;
+    position -= drop;
+}
+
+void PolyphaseResamplingSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (resetRequested.exchange(false))
+        resetState();
+
+    const double ratio = resamplingRatio.load();
+
+    if (ratio == 1.0)
+    {
+        passThrough(bufferToFill);
+        return;
+    }
+
+    for (int done = 0; done < bufferToFill.numSamples;)
+    {
+        const int numSamples = juce::jmin(maxOutputPiece, bufferToFill.numSamples - done);
+        resample(juce::AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + done, numSamples), ratio);
+        done += numSamples;
+    }
+}
+
+void PolyphaseResamplingSource::passThrough(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto* dest = bufferToFill.buffer;
+    const int numSamples = bufferToFill.numSamples;
+
+    // Back at unity after varispeed: a half-sample nudge lines us up with the input again
+    position = std::round(position);
+    const int readIndex = (int)position;
+
+    // Hand out whatever lookahead the filter had already pulled, then go straight to the input
+    const int fromBuffer = juce::jlimit(0, numSamples, bufferedSamples - readIndex);
+
+    for (int channel = 0; channel < dest->getNumChannels() && fromBuffer > 0; ++channel)
+    {
+        if (channel < numberOfChannels)
+            dest->copyFrom(channel, bufferToFill.startSample, inputBuffer, channel, readIndex, fromBuffer);
+        else
+            dest->clear(channel, bufferToFill.startSample, fromBuffer);
+    }
+
+    position += fromBuffer;
+    const int direct = numSamples - fromBuffer;
+
+    if (direct <= 0)
+        return;
+
+    input->getNextAudioBlock(juce::AudioSourceChannelInfo(dest, bufferToFill.startSample + fromBuffer, direct));
+
+    // Keep the tail as history so leaving the bypass doesn't start the filter from silence
+    const int tail = juce::jmin(direct, historyLength);
+    discardBefore((int)position - (historyLength - tail));
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+    {
+        if (channel < dest->getNumChannels())
+            inputBuffer.copyFrom(channel, bufferedSamples, *dest, channel, bufferToFill.startSample + numSamples - tail, tail);
+        else
+            inputBuffer.clear(channel, bufferedSamples, tail);
+    }
+
+    bufferedSamples += tail;
+    position = (double)bufferedSamples;
+}
+
+void PolyphaseResamplingSource::updateStretchedBank(int quality, double scale)
+{
+    // Within half a percent the bank in use still serves: its cutoff is off the output Nyquist by
+    // that much at most, small beside the 4% or more every quality leaves above its passband
+    if (quality == stretchedQuality && std::abs(scale - stretchedScale) <= stretchedScale * 0.005)
+        return;
+
+    const auto& kernel = kernels[quality];
+    stretchedQuality = quality;
+    stretchedScale = scale;
+    stretchedReach = juce::jmin(historyLength, (int)std::ceil(kernel.halfTaps / scale));
+
+    const int numTaps = stretchedReach * 2;
+
+    // Same layout as the kernel's own bank, normalised the same way
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        auto* taps = stretchedBank.get() + phase * numTaps;
+        const double fraction = (double)phase / numPhases;
+        float sum = 0.0f;
+
+        for (int t = 0; t < numTaps; ++t)
+        {
+            taps[t] = getPrototypeValue(kernel, ((double)(t - (stretchedReach - 1)) - fraction) * scale);
+            sum += taps[t];
+        }
+
+        if (sum > 0.0f)
+            juce::FloatVectorOperations::multiply(taps, 1.0f / sum, numTaps);
+    }
+}
+
+void PolyphaseResamplingSource::resample(const juce::AudioSourceChannelInfo& bufferToFill, double ratio)
+{
+    const int quality = juce::jlimit(0, 2, qualityLevel.load());
+    const auto& kernel = kernels[quality];
+    const float* bank = kernel.bank.data();
+    int reach = kernel.halfTaps;
+
+    // Above unity the kernel is widened so its cutoff drops to the output Nyquist
+    if (ratio > 1.0)
+    {
+        updateStretchedBank(quality, 1.0 / ratio);
+        bank = stretchedBank.get();
+        reach = stretchedReach;
+    }
+
+    const int numTaps = reach * 2;
+    const int numSamples = bufferToFill.numSamples;
+
+    // Pull everything this piece will read in one go
+    const double lastPosition = position + (numSamples - 1) * ratio;
+    const int needed = juce::jmin((int)lastPosition + reach + 1, inputBuffer.getNumSamples());
+
+    if (needed > bufferedSamples)
+    {
+        input->getNextAudioBlock(juce::AudioSourceChannelInfo(&inputBuffer, bufferedSamples, needed - bufferedSamples));
+        bufferedSamples = needed;
+    }
+
+    auto* dest = bufferToFill.buffer;
+    const int numDestChannels = juce::jmin(dest->getNumChannels(), numberOfChannels);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int index = (int)position;
+        const double fraction = position - index;
+        const int firstTap = index - reach + 1;
+
+        // Blend the two nearest phases of the bank
+        const double phase = fraction * numPhases;
+        const int lowerPhase = juce::jmin((int)phase, numPhases - 1);
+        const float blend = (float)(phase - lowerPhase);
+        const float* lower = bank + lowerPhase * numTaps;
+
+        juce::FloatVectorOperations::copyWithMultiply(coefficients.get(), lower, 1.0f - blend, numTaps);
+        juce::FloatVectorOperations::addWithMultiply(coefficients.get(), lower + numTaps, blend, numTaps);
+
+        for (int channel = 0; channel < numDestChannels; ++channel)
+            dest->setSample(channel, bufferToFill.startSample + i,
+                MixKernel::dotProduct(inputBuffer.getReadPointer(channel, firstTap), coefficients.get(), numTaps));
+
+        position += ratio;
+    }
+
+    for (int channel = numDestChannels; channel < dest->getNumChannels(); ++channel)
+        dest->clear(channel, bufferToFill.startSample, numSamples);
+
+    discardBefore((int)position - historyLength);
+}
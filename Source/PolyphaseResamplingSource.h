@@ -0,0 +1,97 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// ============ Resampler Quality ============
+// Longer windowed-sinc kernels keep more of the top octave and reject more
+// aliasing, at a proportional cost per output sample.
+enum class ResamplerQuality
+{
+    low = 0,
+    medium,
+    high
+};
+
+// ============ Polyphase Resampling Source ============
+// Windowed-sinc (Kaiser) resampler for varispeed and sample-rate conversion.
+// At ratios up to 1 it blends two neighbouring phases of a precomputed filter
+// bank; above 1 it does the same with a bank of the kernel stretched so its
+// cutoff follows the output Nyquist, rebuilt only when the ratio has moved
+// far enough to matter. At exactly 1 the input is passed straight through.
+class PolyphaseResamplingSource : public juce::AudioSource
+{
+public:
+    PolyphaseResamplingSource(juce::AudioSource* input, bool deleteInputWhenDeleted, int numChannels = 2);
+    ~PolyphaseResamplingSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // Safe from any thread: input samples consumed per output sample
+    void setResamplingRatio(double samplesInPerOutputSample);
+    double getResamplingRatio() const { return resamplingRatio.load(); }
+
+    // Safe from any thread; every quality's kernel is built up front
+    void setQuality(ResamplerQuality quality);
+    ResamplerQuality getQuality() const { return (ResamplerQuality)qualityLevel.load(); }
+
+    // Safe from any thread: drops the buffered input, e.g. after the input was repositioned
+    void reset() { resetRequested = true; }
+
+    // Audio thread: input samples pulled in ahead of the next output sample. This is the
+    // delay the filter adds, its half-length of lookahead plus whatever else is buffered.
+    double getLatencyInputSamples() const;
+
+    static constexpr double maxRatio = 16.0;
+
+private:
+    struct Kernel
+    {
+        int halfTaps = 0;
+
+        // Continuous kernel sampled at oversampling points per input sample, from 0 outwards
+        std::vector<float> prototype;
+
+        // numPhases + 1 phases of 2 * halfTaps taps for unstretched use
+        std::vector<float> bank;
+    };
+
+    static constexpr int numPhases = 256;
+    static constexpr int oversampling = 256;
+
+    static Kernel makeKernel(int halfTaps, double cutoff, double kaiserBeta);
+    float getPrototypeValue(const Kernel& kernel, double distance) const;
+
+    juce::OptionalScopedPointer<juce::AudioSource> input;
+    const int numberOfChannels;
+
+    Kernel kernels[3];
+
+    std::atomic<double> resamplingRatio{ 1.0 };
+    std::atomic<int> qualityLevel{ (int)ResamplerQuality::medium };
+    std::atomic<bool> resetRequested{ true };
+
+    // Input history: the next output sits at fractional index position
+    juce::AudioBuffer<float> inputBuffer;
+    int bufferedSamples = 0;
+    double position = 0.0;
+    int historyLength = 0;
+    int maxOutputPiece = 0;
+
+    juce::HeapBlock<float> coefficients;
+
+    // Audio thread: the bank for ratios above 1, sized in prepareToPlay for the longest reach
+    juce::HeapBlock<float> stretchedBank;
+    double stretchedScale = 0.0;
+    int stretchedReach = 0;
+    int stretchedQuality = -1;
+
+    void resetState();
+    void updateStretchedBank(int quality, double scale);
+    void discardBefore(int index);
+    void passThrough(const juce::AudioSourceChannelInfo& bufferToFill);
+    void resample(const juce::AudioSourceChannelInfo& bufferToFill, double ratio);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResamplingSource)
+};
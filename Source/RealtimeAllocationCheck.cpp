@@ -0,0 +1,104 @@
+#include "RealtimeAllocationCheck.h"
+
+#if REALTIME_ALLOCATION_CHECK
+
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace
+{
+    thread_local int allocationCheckDepth = 0;
+
+    void checkAllocationAllowed()
+    {
+        if (allocationCheckDepth > 0)
+        {
+            // Asserting may allocate itself, so lift the check while it reports
+            const auto depth = std::exchange(allocationCheckDepth, 0);
+            jassertfalse; // heap allocation or free inside the audio callback
+            allocationCheckDepth = depth;
+        }
+    }
+
+    void* checkedAllocate(std::size_t size) noexcept
+    {
+        checkAllocationAllowed();
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* checkedAllocate(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        checkAllocationAllowed();
+
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size == 0 ? 1 : size, (std::size_t)alignment);
+       #else
+        // posix_memalign wants at least pointer alignment
+        void* ptr = nullptr;
+        const auto align = juce::jmax((std::size_t)alignment, sizeof(void*));
+        return posix_memalign(&ptr, align, size == 0 ? 1 : size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    template <typename... Alignment>
+    void* checkedAllocateOrThrow(std::size_t size, Alignment... alignment)
+    {
+        if (auto* ptr = checkedAllocate(size, alignment...))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+    void checkedFree(void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            checkAllocationAllowed();
+
+        std::free(ptr);
+    }
+
+    void checkedFree(void* ptr, std::align_val_t) noexcept
+    {
+        if (ptr != nullptr)
+            checkAllocationAllowed();
+
+       #if JUCE_WINDOWS
+        _aligned_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+}
+
+void* operator new(std::size_t size) { return checkedAllocateOrThrow(size); }
+void* operator new[](std::size_t size) { return checkedAllocateOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return checkedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return checkedAllocate(size); }
+void operator delete(void* ptr) noexcept { checkedFree(ptr); }
+void operator delete[](void* ptr) noexcept { checkedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { checkedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { checkedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { checkedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { checkedFree(ptr); }
+
+// Over-aligned types and aligned SIMD buffers
+void* operator new(std::size_t size, std::align_val_t alignment) { return checkedAllocateOrThrow(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return checkedAllocateOrThrow(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return checkedAllocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return checkedAllocate(size, alignment); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { checkedFree(ptr, alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { checkedFree(ptr, alignment); }
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept { checkedFree(ptr, alignment); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept { checkedFree(ptr, alignment); }
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { checkedFree(ptr, alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { checkedFree(ptr, alignment); }
+
+ScopedRealtimeAllocationCheck::ScopedRealtimeAllocationCheck() { ++allocationCheckDepth; }
+ScopedRealtimeAllocationCheck::~ScopedRealtimeAllocationCheck() { --allocationCheckDepth; }
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Realtime Allocation Check ============
+// While one of these is alive on a thread, debug builds assert on any heap
+// allocation or free made from that thread. Release builds do nothing.
+
+// The check replaces the global operator new and delete. The benchmarks set
+// this to 0, because nothing they run is in a realtime scope.
+#ifndef REALTIME_ALLOCATION_CHECK
+ #define REALTIME_ALLOCATION_CHECK JUCE_DEBUG
+#endif
+
+class ScopedRealtimeAllocationCheck
+{
+public:
+#if REALTIME_ALLOCATION_CHECK
+    ScopedRealtimeAllocationCheck();
+    ~ScopedRealtimeAllocationCheck();
+#else
+    ScopedRealtimeAllocationCheck() {}
+    ~ScopedRealtimeAllocationCheck() {}
+#endif
+
+private:
+    JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeAllocationCheck)
+};
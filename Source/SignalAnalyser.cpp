@@ -0,0 +1,267 @@
+#include "SignalAnalyser.h"
+#include "MixKernel.h"
+#include <cstring>
+
+namespace
+{
+    constexpr double analysisIntervalMs = 20.0;
+    constexpr double silentIntervalMs = 250.0;      // all quiet, but the device is still feeding silence
+    constexpr double inputTimeoutMs = 500.0;        // nothing pushed for this long: the device has stopped
+    constexpr float releaseDbPerSecond = 20.0f;     // how fast meters and spectrum fall back
+    constexpr double peakHoldMs = 1500.0;
+    constexpr float silenceThreshold = 1.0e-5f;     // -100 dBFS
+}
+
+// ============ SignalAnalysisThread Implementation ============
+SignalAnalysisThread::SignalAnalysisThread() : juce::Thread("Signal Analysis")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+SignalAnalysisThread::~SignalAnalysisThread()
+{
+    stopThread(2000);
+}
+
+void SignalAnalysisThread::addAnalyser(SignalAnalyser* analyser)
+{
+    const juce::ScopedLock sl(lock);
+    analysers.addIfNotAlreadyThere(analyser);
+}
+
+void SignalAnalysisThread::removeAnalyser(SignalAnalyser* analyser)
+{
+    // Waits for a pass in progress, so the analyser is never processed after this returns
+    const juce::ScopedLock sl(lock);
+    analysers.removeFirstMatchingValue(analyser);
+}
+
+void SignalAnalysisThread::run()
+{
+    while (!threadShouldExit())
+    {
+        bool allSilent = true;
+        bool anyInput = false;
+
+        {
+            const juce::ScopedLock sl(lock);
+
+            for (auto* analyser : analysers)
+            {
+                anyInput = analyser->process() || anyInput;
+                allSilent = allSilent && analyser->isSilent();
+            }
+        }
+
+        const double now = juce::Time::getMillisecondCounterHiRes();
+
+        if (anyInput)
+            lastInputTime = now;
+
+        if (!allSilent)
+        {
+            wait((int)analysisIntervalMs);
+        }
+        else if (now - lastInputTime < inputTimeoutMs)
+        {
+            // Silence still arriving: a silent intro turning loud is picked up within this, the FIFO holds it meanwhile
+            wait((int)silentIntervalMs);
+        }
+        else if (wait(-1))
+        {
+            // Woken: give the deck or device that woke us time to push its first block
+            lastInputTime = juce::Time::getMillisecondCounterHiRes();
+        }
+    }
+}
+
+// ============ SignalAnalyser Implementation ============
+SignalAnalyser::SignalAnalyser(bool computeSpectrum)
+    : spectrumEnabled(computeSpectrum),
+      history((size_t)fftSize, 0.0f),
+      fftData((size_t)(2 * fftSize), 0.0f)
+{
+    state.spectrumDb.fill(floorDb);
+
+    for (auto& frame : frames)
+        frame = state;
+
+    analysisThread->addAnalyser(this);
+}
+
+SignalAnalyser::~SignalAnalyser()
+{
+    analysisThread->removeAnalyser(this);
+}
+
+void SignalAnalyser::prepare(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    analysisThread->wake();
+}
+
+void SignalAnalyser::resetClip()
+{
+    clipResetRequested = true;
+    analysisThread->wake();
+}
+
+void SignalAnalyser::pushSamples(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    pushedChannels.store(numChannels, std::memory_order_relaxed);
+
+    // Never waits: if the analysis thread has fallen behind, the overflow is simply not shown
+    const auto scope = fifo.write(juce::jmin(numSamples, fifo.getFreeSpace()));
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        const float* source = buffer.getReadPointer(juce::jmin(channel, numChannels - 1), startSample);
+
+        if (scope.blockSize1 > 0)
+            fifoBuffer.copyFrom(channel, scope.startIndex1, source, scope.blockSize1);
+
+        if (scope.blockSize2 > 0)
+            fifoBuffer.copyFrom(channel, scope.startIndex2, source + scope.blockSize1, scope.blockSize2);
+    }
+}
+
+bool SignalAnalyser::readFrame(Frame& result)
+{
+    const bool fresh = (middle.load(std::memory_order_acquire) & freshBit) != 0;
+
+    if (fresh)
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & 3;
+
+    result = frames[(size_t)readIndex];
+    return fresh;
+}
+
+void SignalAnalyser::publish()
+{
+    ++state.serial;
+    frames[(size_t)writeIndex] = state;
+    writeIndex = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & 3;
+    sendChangeMessage();
+}
+
+bool SignalAnalyser::process()
+{
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    const double elapsedSeconds = lastProcessTime > 0.0 ? juce::jlimit(0.0, 1.0, (now - lastProcessTime) * 0.001) : 0.0;
+    lastProcessTime = now;
+
+    const float releaseDb = -releaseDbPerSecond * (float)elapsedSeconds;
+    const float release = juce::Decibels::decibelsToGain(releaseDb);
+    const int numChannels = juce::jlimit(1, maxChannels, pushedChannels.load(std::memory_order_relaxed));
+    bool changed = false;
+
+    if (clipResetRequested.exchange(false))
+    {
+        state.clipped = false;
+        changed = true;
+    }
+
+    // Take everything the audio thread has pushed since the last pass
+    const int numNew = fifo.getNumReady();
+
+    if (numNew > 0)
+    {
+        const auto scope = fifo.read(numNew);
+
+        for (int channel = 0; channel < maxChannels; ++channel)
+        {
+            if (scope.blockSize1 > 0)
+                drainBuffer.copyFrom(channel, 0, fifoBuffer, channel, scope.startIndex1, scope.blockSize1);
+
+            if (scope.blockSize2 > 0)
+                drainBuffer.copyFrom(channel, scope.blockSize1, fifoBuffer, channel, scope.startIndex2, scope.blockSize2);
+        }
+    }
+
+    bool nowSilent = true;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float low = 0.0f, high = 0.0f, sumSquares = 0.0f;
+
+        if (numNew > 0)
+            MixKernel::findPeaks(drainBuffer.getReadPointer(channel), numNew, low, high, sumSquares);
+
+        const float peak = juce::jmax(-low, high);
+        const float rms = numNew > 0 ? std::sqrt(sumSquares / (float)numNew) : 0.0f;
+
+        state.peak[channel] = juce::jmax(peak, state.peak[channel] * release);
+        state.rms[channel] = juce::jmax(rms, state.rms[channel] * release);
+
+        if (peak >= state.peakHold[channel])
+        {
+            state.peakHold[channel] = peak;
+            holdStartTimes[channel] = now;
+        }
+        else if (now - holdStartTimes[channel] > peakHoldMs)
+        {
+            state.peakHold[channel] = state.peak[channel];
+        }
+
+        // Summed decks over full scale: stays lit until the meter is clicked
+        state.clipped = state.clipped || peak >= 1.0f;
+        nowSilent = nowSilent && state.peakHold[channel] < silenceThreshold;
+    }
+
+    if (spectrumEnabled)
+    {
+        updateSpectrum(numNew, numChannels, releaseDb);
+        nowSilent = nowSilent && juce::FloatVectorOperations::findMaximum(state.spectrumDb.data(), numSpectrumBins) <= floorDb;
+    }
+
+    state.numChannels = numChannels;
+    state.sampleRate = currentSampleRate.load();
+
+    // A silent signal is drawn once, then nothing more is sent until it changes
+    if (nowSilent && silent && !changed)
+        return numNew > 0;
+
+    silent = nowSilent;
+    publish();
+    return numNew > 0;
+}
+
+void SignalAnalyser::updateSpectrum(int numNew, int numChannels, float releaseDb)
+{
+    if (numNew > 0)
+    {
+        // Slide the newest samples, mixed to mono, into the window's history
+        const int numTaken = juce::jmin(numNew, fftSize);
+        const int numKept = fftSize - numTaken;
+        const int firstTaken = numNew - numTaken;
+
+        std::memmove(history.data(), history.data() + numTaken, (size_t)numKept * sizeof(float));
+        float* destination = history.data() + numKept;
+
+        juce::FloatVectorOperations::copy(destination, drainBuffer.getReadPointer(0, firstTaken), numTaken);
+
+        for (int channel = 1; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::add(destination, drainBuffer.getReadPointer(channel, firstTaken), numTaken);
+
+        juce::FloatVectorOperations::multiply(destination, 1.0f / (float)numChannels, numTaken);
+
+        std::copy(history.begin(), history.end(), fftData.begin());
+        window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+        fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+        // A full-scale sine reads 0 dB: the Hann window halves the fftSize / 2 a bin would hold
+        const float scale = 4.0f / (float)fftSize;
+        juce::FloatVectorOperations::multiply(fftData.data(), scale, numSpectrumBins);
+    }
+
+    for (int bin = 0; bin < numSpectrumBins; ++bin)
+    {
+        const float newDb = numNew > 0 ? juce::Decibels::gainToDecibels(fftData[(size_t)bin], floorDb) : floorDb;
+        state.spectrumDb[(size_t)bin] = juce::jmax(newDb, state.spectrumDb[(size_t)bin] + releaseDb, floorDb);
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+class SignalAnalyser;
+
+// ============ Signal Analysis Thread ============
+// One low-priority thread that processes every analyser about 50 times a second.
+// Once every analyser is silent it backs off, and when no samples have come in
+// for a while (the device stopped) it sleeps until wake() is called.
+// Analysers register themselves; they get it through juce::SharedResourcePointer.
+class SignalAnalysisThread : public juce::Thread
+{
+public:
+    SignalAnalysisThread();
+    ~SignalAnalysisThread() override;
+
+    void addAnalyser(SignalAnalyser* analyser);
+    void removeAnalyser(SignalAnalyser* analyser);
+
+    // Never from the audio thread: a deck starting, the device starting, a clip reset
+    void wake() { notify(); }
+
+private:
+    juce::CriticalSection lock;
+    juce::Array<SignalAnalyser*> analysers;
+    double lastInputTime = 0.0;
+
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalAnalysisThread)
+};
+
+// ============ Signal Analyser ============
+// Levels (and optionally a spectrum) of one point in the mix: a deck's output
+// or the master bus. The audio thread only copies samples into a wait-free
+// FIFO; the shared analysis thread drains it, runs the meter ballistics and
+// the FFT, and publishes finished frames through a triple buffer. Listeners
+// are told on the message thread when a new frame is in, and nothing is sent
+// while the signal stays silent, so an idle mixer draws nothing.
+class SignalAnalyser : public juce::ChangeBroadcaster
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numSpectrumBins = fftSize / 2;
+    static constexpr float floorDb = -90.0f;
+
+    struct Frame
+    {
+        int numChannels = 0;
+        float peak[maxChannels] = {};           // linear, falling back at the meter's release rate
+        float rms[maxChannels] = {};
+        float peakHold[maxChannels] = {};
+        bool clipped = false;                   // latched until resetClip()
+        double sampleRate = 44100.0;
+        std::array<float, numSpectrumBins> spectrumDb{};
+        juce::uint32 serial = 0;
+    };
+
+    explicit SignalAnalyser(bool computeSpectrum);
+    ~SignalAnalyser() override;
+
+    // Any thread, before audio starts
+    void prepare(double sampleRate);
+
+    // Audio thread, one producer at a time: copies the samples in, dropping what doesn't fit
+    void pushSamples(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Message thread: copies the newest published frame; false if it is the same one as last time
+    bool readFrame(Frame& result);
+    void resetClip();
+
+    bool hasSpectrum() const { return spectrumEnabled; }
+
+    // Analysis thread: drains the FIFO and publishes a frame if anything changed;
+    // returns whether any samples came in
+    bool process();
+    bool isSilent() const { return silent; }
+
+private:
+    juce::SharedResourcePointer<SignalAnalysisThread> analysisThread;
+    const bool spectrumEnabled;
+
+    // Audio -> analysis thread
+    juce::AbstractFifo fifo{ 1 << 15 };
+    juce::AudioBuffer<float> fifoBuffer{ maxChannels, 1 << 15 };
+    std::atomic<int> pushedChannels{ 0 };
+    std::atomic<double> currentSampleRate{ 44100.0 };
+    std::atomic<bool> clipResetRequested{ false };
+
+    // Analysis thread only
+    juce::AudioBuffer<float> drainBuffer{ maxChannels, 1 << 15 };
+    juce::dsp::FFT fft{ fftOrder };
+    juce::dsp::WindowingFunction<float> window{ (size_t)fftSize, juce::dsp::WindowingFunction<float>::hann };
+    std::vector<float> history;                 // last fftSize mono samples, oldest first
+    std::vector<float> fftData;
+    double lastProcessTime = 0.0;
+    double holdStartTimes[maxChannels] = {};
+    bool silent = true;
+    Frame state;
+
+    // Triple buffer: the analysis thread fills frames[writeIndex] and swaps it into the middle;
+    // the reader swaps the middle out when the fresh bit is set
+    static constexpr int freshBit = 4;
+    std::array<Frame, 3> frames;
+    int writeIndex = 0;
+    int readIndex = 1;
+    std::atomic<int> middle{ 2 };
+
+    void updateSpectrum(int numNew, int numChannels, float releaseDb);
+    void publish();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalAnalyser)
+};
@@ -0,0 +1,425 @@
+#include "TimeStretchAudioSource.h"
+#include "MixKernel.h"
+#include <cstring>
+
+TimeStretchAudioSource::TimeStretchAudioSource(juce::AudioSource* s, bool deleteInputWhenDeleted, int numChannels)
+    : input(s, deleteInputWhenDeleted),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+}
+
+TimeStretchAudioSource::~TimeStretchAudioSource()
+{
+}
+
+TimeStretchAudioSource::TierSettings TimeStretchAudioSource::getTierSettings(StretchQuality quality)
+{
+    switch (quality)
+    {
+        case StretchQuality::fast:      return { 0.030, 0.008, 4 };
+        case StretchQuality::high:      return { 0.070, 0.016, 1 };
+        case StretchQuality::balanced:
+        default:                        return { 0.046, 0.012, 2 };
+    }
+}
+
+void TimeStretchAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    preparedBlockSize = samplesPerBlockExpected;
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    allocateFor(sampleRate);
+}
+
+void TimeStretchAudioSource::setInputSampleRate(double sampleRate)
+{
+    if (sampleRate > 0.0 && sampleRate != currentSampleRate && preparedBlockSize > 0)
+        allocateFor(sampleRate);
+}
+
+void TimeStretchAudioSource::allocateFor(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    const int samplesPerBlockExpected = preparedBlockSize;
+
+    // Size everything for the most expensive tier at the fastest ratio
+    const auto largest = getTierSettings(StretchQuality::high);
+    const int maxFrame = (int)(largest.frameSeconds * sampleRate) / 2 * 2;
+    const int maxHop = maxFrame / 2;
+    const int maxRadius = (int)(largest.searchSeconds * sampleRate);
+    const int inputCapacity = maxFrame + maxHop + 2 * maxRadius + (int)std::ceil(maxRatio * maxHop) + 64;
+
+    inputBuffer.setSize(numberOfChannels, inputCapacity);
+    inputMono.allocate((size_t)inputCapacity, true);
+    pullBuffer.setSize(numberOfChannels, maxFrame);
+    outputBuffer.setSize(numberOfChannels, samplesPerBlockExpected + maxFrame + maxHop);
+    window.allocate((size_t)maxFrame, true);
+
+    configureTier((StretchQuality)qualityLevel.load());
+    resetState();
+    resetRequested = false;
+}
+
+void TimeStretchAudioSource::releaseResources()
+{
+    input->releaseResources();
+    preparedBlockSize = 0;
+
+    inputBuffer.setSize(numberOfChannels, 0);
+    pullBuffer.setSize(numberOfChannels, 0);
+    outputBuffer.setSize(numberOfChannels, 0);
+    inputMono.free();
+    window.free();
+}
+
+void TimeStretchAudioSource::setStretchRatio(double ratio)
+{
+    stretchRatio = juce::jlimit(minRatio, maxRatio, ratio);
+}
+
+void TimeStretchAudioSource::setQuality(StretchQuality quality)
+{
+    qualityLevel = (int)quality;
+}
+
+int TimeStretchAudioSource::getLatencySamples() const
+{
+    if (stretching)
+        return frameSize / 2 + searchRadius;
+
+    return outputReady + (int)(inputStart + inputLength - bypassPosition);
+}
+
+void TimeStretchAudioSource::configureTier(StretchQuality quality)
+{
+    const auto settings = getTierSettings(quality);
+
+    activeQuality = quality;
+    frameSize = juce::jmax(64, (int)(settings.frameSeconds * currentSampleRate) / 2 * 2);
+    synthesisHop = frameSize / 2;
+    searchRadius = (int)(settings.searchSeconds * currentSampleRate);
+    searchStep = settings.searchStep;
+
+    // Periodic Hann: frames at half-frame hops sum to exactly one
+    for (int i = 0; i < frameSize; ++i)
+        window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i / (float)frameSize);
+}
+
+void TimeStretchAudioSource::resetState()
+{
+    inputBuffer.clear();
+    outputBuffer.clear();
+    outputReady = 0;
+
+    // Start on a bed of silence so the first search window has somewhere to look back into
+    inputStart = 0;
+    inputLength = juce::jmin(searchRadius, inputBuffer.getNumSamples());
+    juce::FloatVectorOperations::clear(inputMono.get(), inputBuffer.getNumSamples());
+
+    analysisPosition = (double)searchRadius;
+    previousFrameStart = searchRadius - synthesisHop;
+    bypassPosition = inputLength;
+}
+
+void TimeStretchAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const bool qualityChanged = qualityLevel.load() != (int)activeQuality;
+
+    if (qualityChanged)
+        configureTier((StretchQuality)qualityLevel.load());
+
+    const double ratio = stretchRatio.load();
+
+    // Unity ratio costs nothing; either way across it carries on from where the audio got to
+    if (std::abs(ratio - 1.0) < 1.0e-6)
+    {
+        if (stretching)
+        {
+            stretching = false;
+            bypassPosition = previousFrameStart + synthesisHop;
+        }
+
+        passThrough(bufferToFill);
+        return;
+    }
+
+    if (resetRequested.exchange(false) || (stretching && qualityChanged))
+        resetState();
+    else if (!stretching)
+        resumeFromBypass(qualityChanged);
+
+    stretching = true;
+
+    const int maxPiece = outputBuffer.getNumSamples() - frameSize - synthesisHop;
+
+    for (int done = 0; done < bufferToFill.numSamples && maxPiece > 0;)
+    {
+        const int numSamples = juce::jmin(maxPiece, bufferToFill.numSamples - done);
+
+        while (outputReady < numSamples)
+            synthesiseFrame();
+
+        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        {
+            if (channel < numberOfChannels)
+                bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + done, outputBuffer, channel, 0, numSamples);
+            else
+                bufferToFill.buffer->clear(channel, bufferToFill.startSample + done, numSamples);
+        }
+
+        // Slide the finished samples out; the tail of the last frame keeps accumulating
+        const int remaining = outputReady - numSamples + frameSize - synthesisHop;
+
+        for (int channel = 0; channel < numberOfChannels; ++channel)
+        {
+            auto* data = outputBuffer.getWritePointer(channel);
+            std::memmove(data, data + numSamples, (size_t)remaining * sizeof(float));
+            juce::FloatVectorOperations::clear(data + remaining, numSamples);
+        }
+
+        outputReady -= numSamples;
+        done += numSamples;
+    }
+}
+
+void TimeStretchAudioSource::passThrough(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int numSamples = bufferToFill.numSamples;
+
+    if (resetRequested.exchange(false))
+    {
+        outputReady = 0;
+        inputStart += inputLength;
+        inputLength = 0;
+        bypassPosition = inputStart;
+    }
+
+    // First the frames the stretcher had finished...
+    const int fromOutput = juce::jmin(numSamples, outputReady);
+
+    if (fromOutput > 0)
+    {
+        copyToOutput(bufferToFill, 0, outputBuffer, 0, fromOutput);
+
+        for (int channel = 0; channel < numberOfChannels; ++channel)
+        {
+            auto* data = outputBuffer.getWritePointer(channel);
+            std::memmove(data, data + fromOutput, (size_t)(outputReady - fromOutput) * sizeof(float));
+        }
+
+        outputReady -= fromOutput;
+    }
+
+    // ...then the input it had pulled past its last frame
+    const int fromInput = outputReady > 0 ? 0
+        : (int)juce::jlimit((juce::int64)0, (juce::int64)(numSamples - fromOutput), inputStart + inputLength - bypassPosition);
+
+    if (fromInput > 0)
+    {
+        copyToOutput(bufferToFill, fromOutput, inputBuffer, (int)(bypassPosition - inputStart), fromInput);
+        bypassPosition += fromInput;
+    }
+
+    const int done = fromOutput + fromInput;
+    const int direct = numSamples - done;
+
+    if (direct <= 0)
+        return;
+
+    auto* dest = bufferToFill.buffer;
+    input->getNextAudioBlock(juce::AudioSourceChannelInfo(dest, bufferToFill.startSample + done, direct));
+
+    // Keep the newest search radius of input, so stretching again has somewhere to look back into
+    const auto end = bypassPosition + direct;
+    const int tail = juce::jmin(direct, searchRadius);
+    discardInputBefore(end - searchRadius);
+
+    if (inputLength == 0)
+        inputStart = end - tail;
+
+    auto* mono = inputMono.get() + inputLength;
+    juce::FloatVectorOperations::clear(mono, tail);
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+    {
+        if (channel < dest->getNumChannels())
+        {
+            inputBuffer.copyFrom(channel, inputLength, *dest, channel, bufferToFill.startSample + numSamples - tail, tail);
+            juce::FloatVectorOperations::add(mono, inputBuffer.getReadPointer(channel, inputLength), tail);
+        }
+        else
+        {
+            inputBuffer.clear(channel, inputLength, tail);
+        }
+    }
+
+    inputLength += tail;
+    bypassPosition = end;
+}
+
+void TimeStretchAudioSource::resumeFromBypass(bool qualityChanged)
+{
+    // Still inside what the stretcher produced: its frames and input are as it left them
+    if (outputReady > 0 && !qualityChanged)
+        return;
+
+    // Otherwise the next sample due out starts the fading half of a notional last frame,
+    // which the first new frame is matched against and overlapped with as usual
+    const auto resumeAt = bypassPosition;
+
+    outputBuffer.clear();
+    outputReady = 0;
+    analysisPosition = (double)resumeAt;
+    previousFrameStart = resumeAt - synthesisHop;
+
+    discardInputBefore(resumeAt - searchRadius);
+    ensureInput(resumeAt + synthesisHop);
+
+    const int offset = (int)(resumeAt - inputStart);
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+        juce::FloatVectorOperations::multiply(outputBuffer.getWritePointer(channel),
+            inputBuffer.getReadPointer(channel, offset), window.get() + synthesisHop, synthesisHop);
+}
+
+void TimeStretchAudioSource::copyToOutput(const juce::AudioSourceChannelInfo& bufferToFill, int offset,
+    const juce::AudioBuffer<float>& source, int sourceStart, int numSamples)
+{
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+    {
+        if (channel < numberOfChannels)
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + offset, source, channel, sourceStart, numSamples);
+        else
+            bufferToFill.buffer->clear(channel, bufferToFill.startSample + offset, numSamples);
+    }
+}
+
+void TimeStretchAudioSource::synthesiseFrame()
+{
+    const double ratio = juce::jlimit(minRatio, maxRatio, stretchRatio.load());
+    const auto nominalStart = (juce::int64)std::llround(analysisPosition);
+    const auto naturalStart = previousFrameStart + synthesisHop;
+
+    ensureInput(juce::jmax(nominalStart + searchRadius + frameSize, naturalStart + synthesisHop));
+
+    const auto frameStart = nominalStart + findBestOffset(nominalStart, naturalStart);
+    const int offset = (int)(frameStart - inputStart);
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+        juce::FloatVectorOperations::addWithMultiply(outputBuffer.getWritePointer(channel, outputReady),
+            inputBuffer.getReadPointer(channel, offset), window.get(), frameSize);
+
+    outputReady += synthesisHop;
+    previousFrameStart = frameStart;
+    analysisPosition += ratio * synthesisHop;
+
+    discardInputBefore(juce::jmin((juce::int64)std::llround(analysisPosition) - searchRadius,
+        previousFrameStart + synthesisHop));
+}
+
+int TimeStretchAudioSource::findBestOffset(juce::int64 nominalStart, juce::int64 naturalStart) const
+{
+    // Compare candidates with what would have followed the previous frame over the overlap
+    const int overlap = synthesisHop;
+    const float* natural = inputMono.get() + (naturalStart - inputStart);
+    const int lowest = (int)juce::jmax(-(juce::int64)searchRadius, inputStart - nominalStart);
+    const float* base = inputMono.get() + (nominalStart - inputStart);
+
+    int bestOffset = 0;
+    float bestScore = -std::numeric_limits<float>::max();
+
+    for (int candidate = lowest; candidate <= searchRadius; candidate += searchStep)
+    {
+        const float score = correlate(base + candidate, natural, overlap, searchStep);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestOffset = candidate;
+        }
+    }
+
+    // A coarse search is refined sample by sample around its winner
+    if (searchStep > 1)
+    {
+        const int coarseBest = bestOffset;
+        const int from = juce::jmax(lowest, coarseBest - searchStep + 1);
+        const int to = juce::jmin(searchRadius, coarseBest + searchStep - 1);
+
+        for (int candidate = from; candidate <= to; ++candidate)
+        {
+            const float score = correlate(base + candidate, natural, overlap, 1) * (float)searchStep;
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestOffset = candidate;
+            }
+        }
+    }
+
+    return bestOffset;
+}
+
+float TimeStretchAudioSource::correlate(const float* a, const float* b, int numSamples, int step) const
+{
+    if (step == 1)
+        return MixKernel::dotProduct(a, b, numSamples);
+
+    float sum = 0.0f;
+
+    for (int i = 0; i < numSamples; i += step)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+bool TimeStretchAudioSource::ensureInput(juce::int64 endSample)
+{
+    while (inputStart + inputLength < endSample)
+    {
+        const int toPull = (int)juce::jmin((juce::int64)pullBuffer.getNumSamples(), endSample - (inputStart + inputLength));
+
+        if (inputLength + toPull > inputBuffer.getNumSamples())
+        {
+            jassertfalse; // the capacity worked out in prepareToPlay should always cover a frame
+            return false;
+        }
+
+        input->getNextAudioBlock(juce::AudioSourceChannelInfo(&pullBuffer, 0, toPull));
+
+        auto* mono = inputMono.get() + inputLength;
+        juce::FloatVectorOperations::clear(mono, toPull);
+
+        for (int channel = 0; channel < numberOfChannels; ++channel)
+        {
+            inputBuffer.copyFrom(channel, inputLength, pullBuffer, channel, 0, toPull);
+            juce::FloatVectorOperations::add(mono, pullBuffer.getReadPointer(channel), toPull);
+        }
+
+        inputLength += toPull;
+    }
+
+    return true;
+}
+
+void TimeStretchAudioSource::discardInputBefore(juce::int64 sample)
+{
+    const int drop = (int)juce::jlimit((juce::int64)0, (juce::int64)inputLength, sample - inputStart);
+
+    if (drop == 0)
+        return;
+
+    const int keep = inputLength - drop;
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+    {
+        auto* data = inputBuffer.getWritePointer(channel);
+        std::memmove(data, data + drop, (size_t)keep * sizeof(float));
+    }
+
+    std::memmove(inputMono.get(), inputMono.get() + drop, (size_t)keep * sizeof(float));
+
+    inputStart += drop;
+    inputLength = keep;
+}
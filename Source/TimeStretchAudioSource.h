@@ -0,0 +1,116 @@
+#pragma once
+#include <JuceHeader.h>
+
+// ============ Time-Stretch Quality ============
+// Trades CPU for quality: longer frames and a wider, finer similarity search
+// cost more per frame but smear transients and phase less.
+enum class StretchQuality
+{
+    fast = 0,
+    balanced,
+    high
+};
+
+// ============ Time-Stretch Audio Source ============
+// WSOLA (waveform-similarity overlap-add) tempo change without a pitch change.
+// Each output frame is cut from the input near where the stretch ratio says it
+// should be, nudged to the offset that best continues the previous frame, and
+// Hann-windowed into the output at a fixed hop. At ratio 1 it passes the input
+// straight through, after handing out what it had already produced and pulled,
+// and it keeps a little of that input as history to search into when it
+// stretches again, so crossing 1 neither skips ahead nor drops out.
+class TimeStretchAudioSource : public juce::AudioSource
+{
+public:
+    TimeStretchAudioSource(juce::AudioSource* input, bool deleteInputWhenDeleted, int numChannels = 2);
+    ~TimeStretchAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // Safe from any thread: input samples consumed per output sample (0.25 to 4)
+    void setStretchRatio(double ratio);
+    double getStretchRatio() const { return stretchRatio.load(); }
+
+    // Safe from any thread; buffers are sized for the highest tier, so switching never allocates
+    void setQuality(StretchQuality quality);
+    StretchQuality getQuality() const { return (StretchQuality)qualityLevel.load(); }
+
+    // Safe from any thread: drops buffered audio, e.g. after the input was repositioned
+    void reset() { resetRequested = true; }
+
+    // Output delay of the active tier, in samples; while bypassed, what is still to be handed out
+    int getLatencySamples() const;
+
+    // The frame and search lengths are times, so they're sized for the rate of the input
+    // rather than the device's. Reallocates: only while the audio thread is kept out.
+    void setInputSampleRate(double sampleRate);
+
+    static constexpr double minRatio = 0.25;
+    static constexpr double maxRatio = 4.0;
+
+private:
+    struct TierSettings
+    {
+        double frameSeconds;
+        double searchSeconds;
+        int searchStep;
+    };
+
+    static TierSettings getTierSettings(StretchQuality quality);
+
+    juce::OptionalScopedPointer<juce::AudioSource> input;
+    const int numberOfChannels;
+
+    std::atomic<double> stretchRatio{ 1.0 };
+    std::atomic<int> qualityLevel{ (int)StretchQuality::balanced };
+    std::atomic<bool> resetRequested{ true };
+
+    double currentSampleRate = 44100.0;
+    int preparedBlockSize = 0;
+
+    // Audio thread state for the tier in use
+    StretchQuality activeQuality = StretchQuality::balanced;
+    int frameSize = 0;
+    int synthesisHop = 0;
+    int searchRadius = 0;
+    int searchStep = 1;
+    bool stretching = false;
+
+    // Input history: inputBuffer sample 0 is absolute input sample inputStart
+    juce::AudioBuffer<float> inputBuffer;
+    juce::HeapBlock<float> inputMono;
+    juce::int64 inputStart = 0;
+    int inputLength = 0;
+
+    // Where the next frame is nominally taken from, and where the last one really was
+    double analysisPosition = 0.0;
+    juce::int64 previousFrameStart = 0;
+
+    // Overlap-add accumulator; the first outputReady samples are finished
+    juce::AudioBuffer<float> outputBuffer;
+    int outputReady = 0;
+
+    // Bypassed: the next input sample due out. Past the last frame that is where the
+    // frame's fading half starts, and that half plus the next frame's rising one is just the input.
+    juce::int64 bypassPosition = 0;
+
+    juce::HeapBlock<float> window;
+    juce::AudioBuffer<float> pullBuffer;
+
+    void allocateFor(double sampleRate);
+    void configureTier(StretchQuality quality);
+    void resetState();
+    void passThrough(const juce::AudioSourceChannelInfo& bufferToFill);
+    void resumeFromBypass(bool qualityChanged);
+    void copyToOutput(const juce::AudioSourceChannelInfo& bufferToFill, int offset,
+        const juce::AudioBuffer<float>& source, int sourceStart, int numSamples);
+    bool ensureInput(juce::int64 endSample);
+    void discardInputBefore(juce::int64 sample);
+    void synthesiseFrame();
+    int findBestOffset(juce::int64 nominalStart, juce::int64 naturalStart) const;
+    float correlate(const float* a, const float* b, int numSamples, int step) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretchAudioSource)
+};
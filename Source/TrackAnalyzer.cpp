@@ -0,0 +1,253 @@
+#include "TrackAnalyzer.h"
+#include "BackgroundJob.h"
+#include "MappedAudioReader.h"
+
+namespace
+{
+    constexpr int analysisChunkSamples = 65536;
+}
+
+// ============ Analysis Job ============
+class TrackAnalyzer::AnalysisJob : public juce::ThreadPoolJob
+{
+public:
+    AnalysisJob(TrackAnalyzer& a, const juce::File& f)
+        : juce::ThreadPoolJob("Analyse " + f.getFileName()), analyzer(a), file(f)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        // Readers are per job, so every core decodes its own file
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        // Results of an earlier session, possibly only one half of them, come off the disk here
+        if (!analyzer.loadFromCache(file))
+        {
+            TrackAnalysis known;
+            analyzer.find(file, known);
+
+            TrackAnalysis measured;
+            if (analyse(formatManager, file, !known.hasLoudness, !known.hasBeatGrid, measured))
+                analyzer.store(file, measured);
+        }
+
+        const juce::ScopedLock sl(analyzer.lock);
+        analyzer.pendingPaths.removeString(file.getFullPathName());
+        return jobHasFinished;
+    }
+
+private:
+    TrackAnalyzer& analyzer;
+    const juce::File file;
+};
+
+// ============ TrackAnalyzer Implementation ============
+TrackAnalyzer::TrackAnalyzer()
+{
+}
+
+TrackAnalyzer::~TrackAnalyzer()
+{
+    analysisPool.removeAllJobs(true, 5000);
+}
+
+bool TrackAnalyzer::analyse(juce::AudioFormatManager& formatManager, const juce::File& file,
+    bool measureLoudness, bool measureBeatGrid, TrackAnalysis& result)
+{
+    if (!measureLoudness && !measureBeatGrid)
+        return false;
+
+    std::unique_ptr<juce::AudioFormatReader> reader(MappedAudioReader::createReaderFor(formatManager, file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+        return false;
+
+    const int numChannels = juce::jlimit(1, 8, (int)reader->numChannels);
+    juce::AudioBuffer<float> buffer(numChannels, analysisChunkSamples);
+
+    // The beat detector listens to the front pair only, straight out of the same buffer
+    juce::AudioBuffer<float> frontChannels(buffer.getArrayOfWritePointers(), juce::jmin(2, numChannels), analysisChunkSamples);
+
+    std::unique_ptr<LoudnessMeter> meter;
+    std::unique_ptr<BeatDetector> detector;
+
+    if (measureLoudness)
+        meter = std::make_unique<LoudnessMeter>(reader->sampleRate, numChannels);
+
+    if (measureBeatGrid)
+        detector = std::make_unique<BeatDetector>(reader->sampleRate);
+
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += analysisChunkSamples)
+    {
+        if (shouldStopWork())
+            return false;
+
+        const int numSamples = (int)juce::jmin((juce::int64)analysisChunkSamples, reader->lengthInSamples - position);
+        reader->read(&buffer, 0, numSamples, position, true, numChannels > 1);
+
+        if (meter != nullptr)
+            meter->process(buffer, numSamples);
+
+        if (detector != nullptr)
+            detector->process(frontChannels, numSamples);
+    }
+
+    if (meter != nullptr)
+    {
+        result.loudness = meter->getResult();
+        result.hasLoudness = true;
+    }
+
+    // Files without a steady pulse are stored too, as invalid grids, so they aren't analysed again
+    if (detector != nullptr)
+    {
+        result.grid = detector->getResult();
+        result.hasBeatGrid = !shouldStopWork();
+    }
+
+    return result.hasLoudness || result.hasBeatGrid;
+}
+
+bool TrackAnalyzer::findLoudness(const juce::File& file, LoudnessInfo& result)
+{
+    TrackAnalysis analysis;
+    if (!find(file, analysis) || !analysis.hasLoudness)
+        return false;
+
+    result = analysis.loudness;
+    return true;
+}
+
+bool TrackAnalyzer::findBeatGrid(const juce::File& file, BeatGrid& result)
+{
+    TrackAnalysis analysis;
+    if (!find(file, analysis) || !analysis.hasBeatGrid)
+        return false;
+
+    result = analysis.grid;
+    return true;
+}
+
+bool TrackAnalyzer::find(const juce::File& file, TrackAnalysis& result)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        const auto& entry = entries.getReference(i);
+
+        if (entry.file != file)
+            continue;
+
+        if (entry.fileSize != file.getSize() || entry.modificationTime != file.getLastModificationTime())
+        {
+            entries.remove(i);
+            break;
+        }
+
+        result = entry.analysis;
+        return true;
+    }
+
+    return false;
+}
+
+bool TrackAnalyzer::loadFromCache(const juce::File& file)
+{
+    TrackAnalysis known;
+    find(file, known);
+
+    if (known.isComplete())
+        return true;
+
+    // Read without the lock, so finds on other threads never wait for the disk
+    TrackAnalysis stored;
+    stored.hasLoudness = !known.hasLoudness && analysisCache->loadLoudness(file, stored.loudness);
+    stored.hasBeatGrid = !known.hasBeatGrid && analysisCache->loadBeatGrid(file, stored.grid);
+
+    if (stored.hasLoudness || stored.hasBeatGrid)
+        publish(file, stored);
+
+    return (known.hasLoudness || stored.hasLoudness) && (known.hasBeatGrid || stored.hasBeatGrid);
+}
+
+void TrackAnalyzer::requestAnalysis(const juce::File& file)
+{
+    TrackAnalysis existing;
+    if (!file.existsAsFile() || (find(file, existing) && existing.isComplete()))
+        return;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (pendingPaths.contains(file.getFullPathName()))
+            return;
+
+        pendingPaths.add(file.getFullPathName());
+    }
+
+    analysisPool.addJob(new AnalysisJob(*this, file), true);
+}
+
+void TrackAnalyzer::requestAnalysis(const juce::Array<juce::File>& files)
+{
+    for (const auto& file : files)
+        requestAnalysis(file);
+}
+
+void TrackAnalyzer::publish(const juce::File& file, const TrackAnalysis& known)
+{
+    const auto fileSize = file.getSize();
+    const auto modificationTime = file.getLastModificationTime();
+
+    {
+        const juce::ScopedLock sl(lock);
+        Entry* entry = nullptr;
+
+        for (auto& existing : entries)
+            if (existing.file == file)
+                entry = &existing;
+
+        if (entry == nullptr)
+        {
+            entries.add({});
+            entry = &entries.getReference(entries.size() - 1);
+            entry->file = file;
+        }
+
+        // A file changed since its other half was measured keeps nothing of the old one
+        if (entry->fileSize != fileSize || entry->modificationTime != modificationTime)
+            entry->analysis = {};
+
+        entry->fileSize = fileSize;
+        entry->modificationTime = modificationTime;
+
+        if (known.hasLoudness)
+        {
+            entry->analysis.loudness = known.loudness;
+            entry->analysis.hasLoudness = true;
+        }
+
+        if (known.hasBeatGrid)
+        {
+            entry->analysis.grid = known.grid;
+            entry->analysis.hasBeatGrid = true;
+        }
+    }
+
+    // Delivered asynchronously on the message thread
+    sendChangeMessage();
+}
+
+void TrackAnalyzer::store(const juce::File& file, const TrackAnalysis& measured)
+{
+    publish(file, measured);
+
+    if (measured.hasLoudness)
+        analysisCache->storeLoudness(file, measured.loudness);
+
+    if (measured.hasBeatGrid)
+        analysisCache->storeBeatGrid(file, measured.grid);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AnalysisCache.h"
+#include "LoudnessAnalyzer.h"
+#include "BeatGridAnalyzer.h"
+
+// ============ Track Analysis ============
+// What is known about one file; either half may still be missing
+struct TrackAnalysis
+{
+    LoudnessInfo loudness;
+    BeatGrid grid;
+    bool hasLoudness = false;
+    bool hasBeatGrid = false;
+
+    bool isComplete() const { return hasLoudness && hasBeatGrid; }
+};
+
+// ============ Track Analyzer ============
+// The one background analysis service: files are measured on a thread pool
+// with one thread per core, each decoded once with the chunks fed to both the
+// loudness meter and the beat detector. Results are kept per file (path, size
+// and date), in memory and in the analysis cache on disk, and listeners hear
+// about each finished file on the message thread. Decks get it through
+// juce::SharedResourcePointer.
+class TrackAnalyzer : public juce::ChangeBroadcaster
+{
+public:
+    TrackAnalyzer();
+    ~TrackAnalyzer() override;
+
+    // Any thread; they only look in memory, so the message thread never waits on the disk.
+    // What an earlier session stored is read in by the analysis jobs.
+    bool findLoudness(const juce::File& file, LoudnessInfo& result);
+    bool findBeatGrid(const juce::File& file, BeatGrid& result);
+    void requestAnalysis(const juce::File& file);
+    void requestAnalysis(const juce::Array<juce::File>& files);
+
+    // Worker threads (the jobs, offline renders): brings what the disk cache holds for the
+    // file into memory, and returns whether both halves are known now
+    bool loadFromCache(const juce::File& file);
+
+    // Decodes one file on the calling thread, measuring only the halves asked for; used by the jobs
+    static bool analyse(juce::AudioFormatManager& formatManager, const juce::File& file,
+        bool measureLoudness, bool measureBeatGrid, TrackAnalysis& result);
+
+private:
+    class AnalysisJob;
+
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 fileSize = 0;
+        juce::Time modificationTime;
+        TrackAnalysis analysis;
+    };
+
+    juce::CriticalSection lock;
+    juce::Array<Entry> entries;
+    juce::StringArray pendingPaths;
+    juce::SharedResourcePointer<AnalysisCache> analysisCache;
+    juce::ThreadPool analysisPool{ juce::jmax(1, juce::SystemStats::getNumCpus()), 0, juce::Thread::Priority::low };
+
+    bool find(const juce::File& file, TrackAnalysis& result);
+    void publish(const juce::File& file, const TrackAnalysis& known);
+    void store(const juce::File& file, const TrackAnalysis& measured);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackAnalyzer)
+};
@@ -0,0 +1,571 @@
+#include "WaveformPyramid.h"
+#include "BackgroundJob.h"
+#include "MappedAudioReader.h"
+#include "MixKernel.h"
+#include <cmath>
+
+namespace
+{
+    constexpr int buildChunkSamples = 1 << 16;     // a whole number of level-0 bins
+    constexpr int maxPreviewBins = 512;
+    constexpr int previewReadSamples = 1024;        // read around the middle of each preview bin
+
+    juce::int8 toPeak(float value)
+    {
+        return (juce::int8)juce::jlimit(-127, 127, juce::roundToInt(value * 127.0f));
+    }
+
+    juce::uint8 toLevel(float value)
+    {
+        return (juce::uint8)juce::jlimit(0, 255, juce::roundToInt(value * 255.0f));
+    }
+
+    WaveformPyramid::Bin makeBin(const float* samples, int count)
+    {
+        float low, high, sumSquares;
+        MixKernel::findPeaks(samples, count, low, high, sumSquares);
+
+        WaveformPyramid::Bin bin;
+        bin.min = toPeak(low);
+        bin.max = toPeak(high);
+        bin.rms = toLevel(std::sqrt(sumSquares / (float)count));
+        return bin;
+    }
+}
+
+// ============ WaveformPyramid Implementation ============
+WaveformPyramid::WaveformPyramid(int channels, double rate, juce::int64 length)
+    : WaveformPyramid(channels, rate, length, true)
+{
+}
+
+WaveformPyramid::WaveformPyramid(int channels, double rate, juce::int64 length, bool allocate)
+    : numChannels(juce::jlimit(1, maxChannels, channels)),
+    sampleRate(rate),
+    lengthInSamples(juce::jmax((juce::int64)0, length))
+{
+    auto numBins = juce::jmax((juce::int64)1, (lengthInSamples + baseSamplesPerBin - 1) >> baseBinShift);
+    size_t start = 0;
+
+    for (;;)
+    {
+        levelStarts.push_back(start);
+        levelBins.push_back((int)numBins);
+        start += (size_t)(numBins * numChannels);
+
+        if (numBins == 1)
+            break;
+
+        numBins = (numBins + 1) / 2;
+    }
+
+    while (levelBins[(size_t)previewLevel] > maxPreviewBins)
+        ++previewLevel;
+
+    if (allocate)
+    {
+        storage.resize(start);
+        bins = storage.data();
+        previewBins.resize((size_t)(levelBins[(size_t)previewLevel] * numChannels));
+    }
+}
+
+WaveformPyramid::Ptr WaveformPyramid::createMapped(std::unique_ptr<juce::MemoryMappedFile> mappedFile, size_t dataOffset,
+    int channels, double rate, juce::int64 length)
+{
+    if (mappedFile == nullptr || mappedFile->getData() == nullptr || channels < 1 || channels > maxChannels || length <= 0)
+        return nullptr;
+
+    Ptr pyramid = new WaveformPyramid(channels, rate, length, false);
+
+    if (dataOffset + pyramid->getRawDataSize() > mappedFile->getSize())
+        return nullptr;
+
+    // Bins are plain bytes, so they can be read at any offset in the mapping
+    pyramid->bins = reinterpret_cast<const Bin*>(static_cast<const char*>(mappedFile->getData()) + dataOffset);
+    pyramid->mapping = std::move(mappedFile);
+    pyramid->markComplete();
+    return pyramid;
+}
+
+int WaveformPyramid::getLevelFor(double samplesPerPixel) const
+{
+    int level = 0;
+
+    while (level + 1 < getNumLevels() && (double)getSamplesPerBin(level + 1) <= samplesPerPixel)
+        ++level;
+
+    return level;
+}
+
+int WaveformPyramid::getNumReadyBins(int level) const
+{
+    if (isComplete())
+        return getNumBins(level);
+
+    return readyBaseBins.load(std::memory_order_acquire) >> level;
+}
+
+bool WaveformPyramid::getPeaks(int level, int channel, int firstBin, int endBin,
+    float& minValue, float& maxValue, float& rms) const
+{
+    return combinePeaks(getLevel(level), getNumReadyBins(level), channel, firstBin, endBin, minValue, maxValue, rms);
+}
+
+bool WaveformPyramid::getPreviewPeaks(int channel, int firstBin, int endBin, float& minValue, float& maxValue, float& rms) const
+{
+    if (getPreviewLevel() < 0)
+        return false;
+
+    return combinePeaks(previewBins.data(), getNumBins(previewLevel), channel, firstBin, endBin, minValue, maxValue, rms);
+}
+
+bool WaveformPyramid::combinePeaks(const Bin* levelBinData, int numBins, int channel, int firstBin, int endBin,
+    float& minValue, float& maxValue, float& rms) const
+{
+    firstBin = juce::jmax(0, firstBin);
+    endBin = juce::jmin(numBins, endBin);
+
+    if (firstBin >= endBin)
+        return false;
+
+    int low = 127, high = -127;
+    float sumSquares = 0.0f;
+
+    for (int bin = firstBin; bin < endBin; ++bin)
+    {
+        const auto& peak = levelBinData[bin * numChannels + channel];
+        low = juce::jmin(low, (int)peak.min);
+        high = juce::jmax(high, (int)peak.max);
+
+        const float value = peak.rms / 255.0f;
+        sumSquares += value * value;
+    }
+
+    minValue = low / 127.0f;
+    maxValue = high / 127.0f;
+    rms = std::sqrt(sumSquares / (float)(endBin - firstBin));
+    return true;
+}
+
+void WaveformPyramid::addSamples(const juce::AudioBuffer<float>& buffer, int numSamples, juce::int64 startSample)
+{
+    jassert((startSample & (baseSamplesPerBin - 1)) == 0);
+
+    jassert(mapping == nullptr);
+
+    Bin* levelZero = getWritableLevel(0);
+    const int firstBin = (int)(startSample >> baseBinShift);
+    const int numBins = juce::jmin(getNumBins(0) - firstBin, (numSamples + baseSamplesPerBin - 1) >> baseBinShift);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        // Mono files draw the same data in every lane
+        const float* samples = buffer.getReadPointer(juce::jmin(channel, buffer.getNumChannels() - 1));
+
+        for (int i = 0; i < numBins; ++i)
+        {
+            const int offset = i << baseBinShift;
+            const int count = juce::jmin(baseSamplesPerBin, numSamples - offset);
+            levelZero[(firstBin + i) * numChannels + channel] = makeBin(samples + offset, count);
+        }
+    }
+}
+
+void WaveformPyramid::buildUpperLevels()
+{
+    mergeUpperLevels(0, getNumBins(0));
+}
+
+void WaveformPyramid::mergeUpperLevels(int firstBin, int endBin)
+{
+    for (int level = 1; level < getNumLevels(); ++level)
+    {
+        const Bin* children = getWritableLevel(level - 1);
+        Bin* parents = getWritableLevel(level);
+        const int numChildren = endBin;     // filled so far at the level below
+
+        firstBin >>= 1;
+        endBin = (endBin + 1) >> 1;
+
+        for (int bin = firstBin; bin < endBin; ++bin)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const auto& left = children[2 * bin * numChannels + channel];
+                auto& parent = parents[bin * numChannels + channel];
+
+                // An odd bin out at the end, or one whose partner isn't read yet
+                if (2 * bin + 1 >= numChildren)
+                {
+                    parent = left;
+                    continue;
+                }
+
+                const auto& right = children[(2 * bin + 1) * numChannels + channel];
+                parent.min = juce::jmin(left.min, right.min);
+                parent.max = juce::jmax(left.max, right.max);
+                parent.rms = (juce::uint8)juce::roundToInt(std::sqrt(0.5f * ((float)left.rms * left.rms + (float)right.rms * right.rms)));
+            }
+        }
+    }
+}
+
+bool WaveformPyramid::buildPreview(juce::AudioFormatReader& reader, WaveformPyramid& pyramid)
+{
+    const int level = pyramid.previewLevel;
+    const auto samplesPerBin = getSamplesPerBin(level);
+
+    // Short enough that the full build is about as quick
+    if (samplesPerBin < 8 * previewReadSamples)
+        return true;
+
+    const int channels = juce::jlimit(1, maxChannels, (int)reader.numChannels);
+    const auto length = pyramid.getLengthInSamples();
+    juce::AudioBuffer<float> buffer(channels, previewReadSamples);
+
+    for (int bin = 0; bin < pyramid.getNumBins(level); ++bin)
+    {
+        // Stopped, or the real peaks got there first
+        if (shouldStopWork() || pyramid.isComplete())
+            return false;
+
+        const auto start = juce::jlimit((juce::int64)0, juce::jmax((juce::int64)0, length - previewReadSamples),
+            bin * samplesPerBin + (samplesPerBin - previewReadSamples) / 2);
+        const int numSamples = (int)juce::jmin((juce::int64)previewReadSamples, length - start);
+        reader.read(&buffer, 0, numSamples, start, true, channels > 1);
+
+        for (int channel = 0; channel < pyramid.numChannels; ++channel)
+            pyramid.previewBins[(size_t)(bin * pyramid.numChannels + channel)]
+                = makeBin(buffer.getReadPointer(juce::jmin(channel, channels - 1)), numSamples);
+    }
+
+    pyramid.previewReady.store(true, std::memory_order_release);
+    return true;
+}
+
+bool WaveformPyramid::buildRange(juce::AudioFormatReader& reader, WaveformPyramid& pyramid,
+    juce::int64 startSample, juce::int64 endSample)
+{
+    const int channels = juce::jlimit(1, maxChannels, (int)reader.numChannels);
+    juce::AudioBuffer<float> buffer(channels, buildChunkSamples);
+    endSample = juce::jmin(endSample, pyramid.getLengthInSamples());
+
+    for (juce::int64 position = startSample; position < endSample; position += buildChunkSamples)
+    {
+        if (shouldStopWork())
+            return false;
+
+        const int numSamples = (int)juce::jmin((juce::int64)buildChunkSamples, endSample - position);
+        reader.read(&buffer, 0, numSamples, position, true, channels > 1);
+        pyramid.addSamples(buffer, numSamples, position);
+    }
+
+    return true;
+}
+
+void WaveformPyramid::publishReadyBins(int endBin)
+{
+    const int firstBin = readyBaseBins.load(std::memory_order_relaxed);
+    endBin = juce::jmin(getNumBins(0), endBin);
+
+    if (endBin <= firstBin)
+        return;
+
+    mergeUpperLevels(firstBin, endBin);
+    readyBaseBins.store(endBin, std::memory_order_release);
+}
+
+bool WaveformPyramid::build(juce::AudioFormatReader& reader, WaveformPyramid& pyramid)
+{
+    const int channels = juce::jlimit(1, maxChannels, (int)reader.numChannels);
+    juce::AudioBuffer<float> buffer(channels, buildChunkSamples);
+
+    for (juce::int64 position = 0; position < pyramid.getLengthInSamples(); position += buildChunkSamples)
+    {
+        if (shouldStopWork())
+            return false;
+
+        const int numSamples = (int)juce::jmin((juce::int64)buildChunkSamples, pyramid.getLengthInSamples() - position);
+        reader.read(&buffer, 0, numSamples, position, true, channels > 1);
+        pyramid.addSamples(buffer, numSamples, position);
+
+        // Publish the chunk: the bins under it are final at every level
+        pyramid.publishReadyBins((int)((position + numSamples + baseSamplesPerBin - 1) >> baseBinShift));
+    }
+
+    pyramid.markComplete();
+    return true;
+}
+
+// ============ Build Task ============
+// One pyramid being built by several jobs at once: a preview job, then one job
+// per range of the file, each with its own reader. The pool hands ranges out in
+// order to whichever thread is free, and finished ranges are published as soon
+// as every range before them is in, so the display still fills from the start.
+class WaveformBuilder::BuildTask : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<BuildTask>;
+
+    BuildTask(juce::AudioFormatManager& manager, const juce::File& f, WaveformPyramid* p, AnalysisCache* c)
+        : formatManager(manager), file(f), pyramid(p), cache(c),
+        rangeDone((size_t)getNumRanges(*p), false),
+        rangesLeft(getNumRanges(*p))
+    {
+    }
+
+    static int getNumRanges(const WaveformPyramid& pyramid)
+    {
+        return (int)((pyramid.getLengthInSamples() + rangeSamples - 1) / rangeSamples);
+    }
+
+    // Dropped from the builder's list: nobody will draw it
+    bool isAbandoned() const { return pyramid->getReferenceCount() <= 1; }
+
+    void rangeFinished(int index, bool succeeded)
+    {
+        bool last = false, succeededAll = false;
+
+        {
+            const juce::ScopedLock sl(lock);
+            rangeDone[(size_t)index] = true;
+            failed = failed || !succeeded;
+
+            if (!failed)
+            {
+                int end = firstUnpublished;
+                while (end < (int)rangeDone.size() && rangeDone[(size_t)end])
+                    ++end;
+
+                if (end > firstUnpublished)
+                {
+                    firstUnpublished = end;
+                    pyramid->publishReadyBins((int)(((juce::int64)end * rangeSamples) >> WaveformPyramid::baseBinShift));
+                }
+            }
+
+            last = --rangesLeft == 0;
+            succeededAll = last && !failed;
+        }
+
+        if (succeededAll)
+        {
+            pyramid->markComplete();
+
+            if (cache != nullptr)
+                cache->storeWaveform(file, *pyramid);
+        }
+
+        if (last)
+            finished.signal();
+    }
+
+    static constexpr juce::int64 rangeSamples = 1 << 20;    // ~24 s at 44.1 kHz
+
+    juce::AudioFormatManager& formatManager;
+    const juce::File file;
+    const WaveformPyramid::Ptr pyramid;
+    AnalysisCache* const cache;
+    juce::WaitableEvent finished;
+
+private:
+    juce::CriticalSection lock;
+    std::vector<bool> rangeDone;
+    int firstUnpublished = 0;
+    int rangesLeft;
+    bool failed = false;
+};
+
+class WaveformBuilder::PreviewJob : public juce::ThreadPoolJob
+{
+public:
+    PreviewJob(BuildTask* t, juce::AudioFormatReader* r)
+        : juce::ThreadPoolJob("Waveform preview"), task(t), reader(r)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        if (!task->isAbandoned())
+            WaveformPyramid::buildPreview(*reader, *task->pyramid);
+
+        return jobHasFinished;
+    }
+
+private:
+    BuildTask::Ptr task;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+};
+
+class WaveformBuilder::RangeJob : public juce::ThreadPoolJob
+{
+public:
+    RangeJob(BuildTask* t, int rangeIndex)
+        : juce::ThreadPoolJob("Waveform range"), task(t), index(rangeIndex)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        bool succeeded = false;
+
+        if (!task->isAbandoned())
+        {
+            // Each range decodes through its own reader, so ranges never wait on each other
+            std::unique_ptr<juce::AudioFormatReader> reader(MappedAudioReader::createReaderFor(task->formatManager, task->file));
+            const auto start = index * BuildTask::rangeSamples;
+
+            succeeded = reader != nullptr
+                && WaveformPyramid::buildRange(*reader, *task->pyramid, start, start + BuildTask::rangeSamples);
+        }
+
+        task->rangeFinished(index, succeeded);
+        return jobHasFinished;
+    }
+
+private:
+    BuildTask::Ptr task;
+    const int index;
+};
+
+class WaveformBuilder::SampleJob : public juce::ThreadPoolJob
+{
+public:
+    SampleJob(juce::AudioFormatManager& manager, const juce::File& f, juce::int64 firstSample, int length,
+        std::function<void(SampleWindow::Ptr)> callback)
+        : juce::ThreadPoolJob("Waveform samples"), formatManager(manager), file(f), start(firstSample),
+          numSamples(length), onDecoded(std::move(callback))
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        SampleWindow::Ptr window;
+        std::unique_ptr<juce::AudioFormatReader> reader(MappedAudioReader::createReaderFor(formatManager, file));
+
+        if (reader != nullptr)
+        {
+            const int numChannels = (int)reader->numChannels;
+            window = new SampleWindow();
+            window->start = start;
+            window->samples.setSize(numChannels, numSamples);
+            reader->read(&window->samples, 0, numSamples, start, true, numChannels > 1);
+        }
+
+        juce::MessageManager::callAsync([callback = std::move(onDecoded), window]
+            {
+                callback(window);
+            });
+
+        return jobHasFinished;
+    }
+
+private:
+    juce::AudioFormatManager& formatManager;
+    const juce::File file;
+    const juce::int64 start;
+    const int numSamples;
+    std::function<void(SampleWindow::Ptr)> onDecoded;
+};
+
+// ============ WaveformBuilder Implementation ============
+WaveformBuilder::WaveformBuilder()
+{
+    formatManager.registerBasicFormats();
+}
+
+WaveformBuilder::~WaveformBuilder()
+{
+    buildPool.removeAllJobs(true, 5000);
+}
+
+void WaveformBuilder::addRangeJobs(juce::ThreadPool& pool, BuildTask* task)
+{
+    for (int i = 0; i < BuildTask::getNumRanges(*task->pyramid); ++i)
+        pool.addJob(new RangeJob(task, i), true);
+}
+
+WaveformPyramid::Ptr WaveformBuilder::buildNow(juce::AudioFormatManager& manager, const juce::File& file, int numThreads)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(MappedAudioReader::createReaderFor(manager, file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+        return nullptr;
+
+    WaveformPyramid::Ptr pyramid = new WaveformPyramid((int)reader->numChannels, reader->sampleRate, reader->lengthInSamples);
+    BuildTask::Ptr task = new BuildTask(manager, file, pyramid.get(), nullptr);
+
+    juce::ThreadPool pool(juce::jmax(1, numThreads));
+    addRangeJobs(pool, task.get());
+    task->finished.wait();
+
+    return pyramid->isComplete() ? pyramid : nullptr;
+}
+
+WaveformPyramid::Ptr WaveformBuilder::getPyramid(const juce::File& file)
+{
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        auto entry = entries.getReference(i);
+
+        if (entry.file != file)
+            continue;
+
+        entries.remove(i);
+
+        if (entry.fileSize == file.getSize() && entry.modificationTime == file.getLastModificationTime())
+        {
+            entries.add(entry);
+            return entry.pyramid;
+        }
+
+        break;
+    }
+
+    Entry entry;
+    entry.file = file;
+    entry.fileSize = file.getSize();
+    entry.modificationTime = file.getLastModificationTime();
+
+    auto addEntry = [this, &entry]
+        {
+            entries.add(entry);
+            while (entries.size() > maxEntries)
+                entries.remove(0);
+        };
+
+    // Built in an earlier session: mapped from the cache, ready to draw
+    entry.pyramid = analysisCache->loadWaveform(file);
+
+    if (entry.pyramid != nullptr)
+    {
+        addEntry();
+        return entry.pyramid;
+    }
+
+    // Only the header is read here; the preview job reads through the same reader
+    auto* reader = MappedAudioReader::createReaderFor(formatManager, file);
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+    {
+        delete reader;
+        return nullptr;
+    }
+
+    entry.pyramid = new WaveformPyramid((int)reader->numChannels, reader->sampleRate, reader->lengthInSamples);
+    addEntry();
+
+    // A rough outline of the whole file first, then the real peaks, range by range from the start
+    BuildTask::Ptr task = new BuildTask(formatManager, file, entry.pyramid.get(), analysisCache.get());
+    buildPool.addJob(new PreviewJob(task.get(), reader), true);
+    addRangeJobs(buildPool, task.get());
+
+    return entry.pyramid;
+}
+
+void WaveformBuilder::decodeSamples(const juce::File& file, juce::int64 start, int numSamples,
+    std::function<void(SampleWindow::Ptr)> onDecoded)
+{
+    buildPool.addJob(new SampleJob(formatManager, file, start, numSamples, std::move(onDecoded)), true);
+}
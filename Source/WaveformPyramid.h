@@ -0,0 +1,185 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AnalysisCache.h"
+#include <vector>
+
+// ============ Waveform Pyramid ============
+// Min/max/RMS peaks of a file at 2^n samples per bin: level 0 has 64 samples
+// per bin and every level above merges pairs of bins, up to a single bin.
+// Peaks are 8-bit, like juce::AudioThumbnail's, so all the levels of a
+// ten-minute stereo track come to about 5 MB. A view draws from the level
+// whose bins are just narrower than a pixel, so a paint costs the same at
+// any zoom: one or two bins per visible pixel. All levels sit back to back in
+// one block, which is either owned or a mapping of the on-disk cache.
+class WaveformPyramid : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<WaveformPyramid>;
+
+    struct Bin
+    {
+        juce::int8 min = 0;
+        juce::int8 max = 0;
+        juce::uint8 rms = 0;
+    };
+
+    static constexpr int baseBinShift = 6;
+    static constexpr int baseSamplesPerBin = 1 << baseBinShift;
+    static constexpr int maxChannels = 2;
+
+    WaveformPyramid(int numChannels, double sampleRate, juce::int64 lengthInSamples);
+
+    // Reads the bins in place from a mapped cache file; nullptr if the mapping is too short for them
+    static Ptr createMapped(std::unique_ptr<juce::MemoryMappedFile> mappedFile, size_t dataOffset,
+        int numChannels, double sampleRate, juce::int64 lengthInSamples);
+
+    int getNumChannels() const { return numChannels; }
+    double getSampleRate() const { return sampleRate; }
+    juce::int64 getLengthInSamples() const { return lengthInSamples; }
+    double getLengthInSeconds() const { return sampleRate > 0.0 ? (double)lengthInSamples / sampleRate : 0.0; }
+
+    int getNumLevels() const { return (int)levelBins.size(); }
+    int getNumBins(int level) const { return levelBins[(size_t)level]; }
+    static juce::int64 getSamplesPerBin(int level) { return (juce::int64)baseSamplesPerBin << level; }
+
+    // Coarsest level whose bins are no wider than samplesPerPixel (level 0 below that)
+    int getLevelFor(double samplesPerPixel) const;
+
+    // Combined peaks of bins [firstBin, endBin) of one channel, as -1..1; false if none of them is ready
+    bool getPeaks(int level, int channel, int firstBin, int endBin, float& minValue, float& maxValue, float& rms) const;
+
+    // While building, bins fill in from the start of the file; a bin is ready once all
+    // the samples under it have been read, and from then on it doesn't change
+    int getNumReadyBins(int level) const;
+
+    // Rough peaks of the whole file, sampled from short reads spread over it, for the
+    // parts the build hasn't reached yet. previewLevel is -1 until they're in.
+    int getPreviewLevel() const { return previewReady.load(std::memory_order_acquire) ? previewLevel : -1; }
+    bool getPreviewPeaks(int channel, int firstBin, int endBin, float& minValue, float& maxValue, float& rms) const;
+
+    // Builders: fill level 0 from samples that start on a bin boundary, then merge the levels above
+    void addSamples(const juce::AudioBuffer<float>& buffer, int numSamples, juce::int64 startSample);
+    void buildUpperLevels();
+
+    // Set once every level is filled
+    void markComplete() { complete = true; }
+    bool isComplete() const { return complete.load(); }
+
+    // Fills the preview from a handful of short reads; skipped for short files
+    static bool buildPreview(juce::AudioFormatReader& reader, WaveformPyramid& pyramid);
+
+    // Fills level 0 for samples [startSample, endSample), startSample on a bin boundary.
+    // Ranges don't share bins, so several threads can fill different ones at once.
+    static bool buildRange(juce::AudioFormatReader& reader, WaveformPyramid& pyramid,
+        juce::int64 startSample, juce::int64 endSample);
+
+    // Merges the levels above level-0 bins up to endBin and makes them ready; every
+    // bin before endBin must be filled. One thread at a time.
+    void publishReadyBins(int endBin);
+
+    // Fills the whole pyramid from a reader on the calling thread, publishing each
+    // chunk's bins as it goes; false if the job was stopped
+    static bool build(juce::AudioFormatReader& reader, WaveformPyramid& pyramid);
+
+    // Every level's bins as one block, for the cache to write out
+    const void* getRawData() const { return bins; }
+    size_t getRawDataSize() const { return getTotalBins() * sizeof(Bin); }
+
+private:
+    const int numChannels;
+    const double sampleRate;
+    const juce::int64 lengthInSamples;
+
+    // Per level: where its bins start in the block, and how many there are per channel.
+    // Bins are interleaved by channel; only owned pyramids are ever written to.
+    std::vector<size_t> levelStarts;
+    std::vector<int> levelBins;
+    std::vector<Bin> storage;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    const Bin* bins = nullptr;
+    std::atomic<bool> complete{ false };
+    std::atomic<int> readyBaseBins{ 0 };
+
+    // Kept apart from the levels, so the build never writes over bins being drawn
+    std::vector<Bin> previewBins;
+    int previewLevel = 0;
+    std::atomic<bool> previewReady{ false };
+
+    WaveformPyramid(int numChannels, double sampleRate, juce::int64 lengthInSamples, bool allocate);
+
+    size_t getTotalBins() const { return levelStarts.back() + (size_t)(levelBins.back() * numChannels); }
+    Bin* getWritableLevel(int level) { return storage.data() + levelStarts[(size_t)level]; }
+    const Bin* getLevel(int level) const { return bins + levelStarts[(size_t)level]; }
+
+    // Re-merges every upper bin over level-0 bins [firstBin, endBin), given level 0 is filled up to endBin
+    void mergeUpperLevels(int firstBin, int endBin);
+    bool combinePeaks(const Bin* levelBinData, int numBins, int channel, int firstBin, int endBin,
+        float& minValue, float& maxValue, float& rms) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramid)
+};
+
+// ============ Waveform Builder ============
+// Builds pyramids on a thread pool with one thread per core: each file is
+// split into ranges of about 24 s, decoded in parallel through a reader per
+// range. The most recent pyramids are kept in memory; finished ones go to the
+// analysis cache, and a file seen before is mapped back from it instead of
+// being decoded again. Displays get it through juce::SharedResourcePointer and
+// draw whatever part of a pyramid is ready, so a file can play while its
+// waveform fills in.
+class WaveformBuilder
+{
+public:
+    WaveformBuilder();
+    ~WaveformBuilder();
+
+    // Message thread: the finished or in-progress pyramid of a file, nullptr if it can't be read
+    WaveformPyramid::Ptr getPyramid(const juce::File& file);
+
+    // Builds a whole pyramid with numThreads threads and waits for it; no preview and no cache
+    static WaveformPyramid::Ptr buildNow(juce::AudioFormatManager& formatManager, const juce::File& file, int numThreads);
+
+    // Decoded samples of part of a file, for zooms finer than a pyramid goes
+    struct SampleWindow : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<SampleWindow>;
+
+        juce::int64 start = 0;
+        juce::AudioBuffer<float> samples;
+
+        bool contains(juce::int64 first, int numSamples) const
+        {
+            return first >= start && first + numSamples <= start + samples.getNumSamples();
+        }
+    };
+
+    // Message thread: decodes numSamples from start on the build pool, then passes them to
+    // onDecoded on the message thread, or nullptr if the file can't be read
+    void decodeSamples(const juce::File& file, juce::int64 start, int numSamples,
+        std::function<void(SampleWindow::Ptr)> onDecoded);
+
+private:
+    class BuildTask;
+    class PreviewJob;
+    class RangeJob;
+    class SampleJob;
+
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 fileSize = 0;
+        juce::Time modificationTime;
+        WaveformPyramid::Ptr pyramid;
+    };
+
+    static constexpr int maxEntries = 8;
+
+    juce::AudioFormatManager formatManager;
+    juce::Array<Entry> entries;     // least recently used first
+    juce::SharedResourcePointer<AnalysisCache> analysisCache;
+    juce::ThreadPool buildPool{ juce::jmax(1, juce::SystemStats::getNumCpus()), 0, juce::Thread::Priority::low };
+
+    static void addRangeJobs(juce::ThreadPool& pool, BuildTask* task);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformBuilder)
+};